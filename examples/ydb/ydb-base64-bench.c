@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64.h"
+
+static const char *level_str[] = {"scalar", "ssse3", "avx2"};
+
+static const struct
+{
+    const char *src;
+    const char *b64;
+} expected[] = {
+    {"", ""},
+    {"f", "Zg=="},
+    {"fo", "Zm8="},
+    {"foo", "Zm9v"},
+    {"foobar", "Zm9vYmFy"},
+    {"The quick brown fox jumps over the lazy dog",
+     "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZw=="},
+};
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+// check the encoded and decoded data of all levels are the same with the scalar codec.
+static int check_levels(int max, unsigned char *src, size_t len, int lf)
+{
+    int level, failed = 0;
+    size_t olen, dlen, slen;
+    unsigned char *scalar, *enc, *dec;
+    base64_simd_level(BASE64_SCALAR);
+    scalar = lf ? base64_encode_lf(src, len, &slen) : base64_encode(src, len, &slen);
+    for (level = BASE64_SCALAR; level <= max; level++)
+    {
+        base64_simd_level(level);
+        enc = lf ? base64_encode_lf(src, len, &olen) : base64_encode(src, len, &olen);
+        dec = base64_decode(enc, olen, &dlen);
+        if (olen != slen || memcmp(enc, scalar, olen) != 0 ||
+            (len > 0 && (!dec || dlen != len || memcmp(dec, src, len) != 0)))
+        {
+            printf("failed: %s len=%zu lf=%d\n", level_str[level], len, lf);
+            failed++;
+        }
+        free(enc);
+        free(dec);
+    }
+    free(scalar);
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, level, max;
+    int loop = 200;
+    int failed = 0;
+    size_t len = 1024 * 1024;
+    size_t olen, dlen;
+    unsigned char *src, *enc, *dec;
+    struct timespec start;
+    double ns;
+
+    if (argc >= 2)
+        loop = atoi(argv[1]);
+    max = base64_simd_level(-1);
+
+    for (i = 0; i < (int)(sizeof(expected) / sizeof(expected[0])); i++)
+    {
+        enc = base64_encode((const unsigned char *)expected[i].src, strlen(expected[i].src), &olen);
+        if (!enc || strcmp((char *)enc, expected[i].b64) != 0)
+        {
+            printf("failed: %s -> %s\n", expected[i].src, enc ? (char *)enc : "(null)");
+            failed++;
+        }
+        free(enc);
+    }
+
+    src = malloc(len);
+    srand(1);
+    for (i = 0; i < (int)len; i++)
+        src[i] = rand();
+    for (i = 0; i < 300; i++)
+    {
+        failed += check_levels(max, src + (i % 7), i, 0);
+        failed += check_levels(max, src + (i % 7), i, 1);
+    }
+    failed += check_levels(max, src, len, 0);
+    failed += check_levels(max, src, len, 1);
+
+    for (level = BASE64_SCALAR; level <= max; level++)
+    {
+        base64_simd_level(level);
+        enc = malloc(base64_encode_len(len, 0));
+        dec = malloc(base64_decode_len(base64_encode_len(len, 0)));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loop; i++)
+            olen = base64_encode_to(src, len, enc, 0);
+        ns = elapsed_ns(&start);
+        printf("%s encode: %.1f MB/s\n", level_str[level], (double)len * loop / (ns / 1e9) / 1e6);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loop; i++)
+            base64_decode_to(enc, olen, dec, &dlen);
+        ns = elapsed_ns(&start);
+        printf("%s decode: %.1f MB/s\n", level_str[level], (double)len * loop / (ns / 1e9) / 1e6);
+        if (dlen != len || memcmp(dec, src, len) != 0)
+            failed++;
+        free(enc);
+        free(dec);
+    }
+    free(src);
+    printf("%s\n", failed ? "failed" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+// count the changes of the binary leaf.
+static int hooked;
+
+void blob_hook(ydb *datablock, char op, ynode *base, ynode *cur, ynode *_new)
+{
+    hooked++;
+}
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int loop = 10000;
+    size_t len = 4096;
+    size_t blen, b64len;
+    unsigned char *image;
+    const void *blob;
+    char *b64, *dump = NULL;
+    size_t dumplen = 0;
+    char *readbuf;
+    FILE *fp;
+    ydb *datablock, *copied;
+    ydb_res res = YDB_OK;
+    struct timespec start;
+
+    if (argc >= 2)
+        loop = atoi(argv[1]);
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    copied = ydb_open("copied");
+    if (!datablock || !copied)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    image = malloc(len);
+    for (i = 0; i < (int)len; i++)
+        image[i] = (unsigned char)(i * 7 + 3);
+
+    ydb_write_hook_add(datablock, "/firmware/image", 0, (ydb_write_hook)blob_hook, 0);
+    hooked = 0;
+
+    // the binary data is kept without base64 encoding.
+    res = ydb_blob_write(datablock, "/firmware/image", image, len);
+    if (res == YDB_OK)
+        res = ydb_blob_read(datablock, "/firmware/image", &blob, &blen);
+    if (res || blen != len || memcmp(blob, image, len) != 0)
+    {
+        fprintf(stderr, "ydb_blob_read failed. (%s)\n", ydb_res_str(res));
+        res = YDB_E_FUNC;
+    }
+    // the binary leaf is read as the base64 string.
+    b64 = binary_to_base64(image, len, &b64len);
+    if (!b64 || !ydb_path_read(datablock, "/firmware/image") ||
+        strcmp(ydb_path_read(datablock, "/firmware/image"), b64) != 0)
+    {
+        fprintf(stderr, "ydb_path_read failed.\n");
+        res = YDB_E_FUNC;
+    }
+    // the base64 string is released by the next change and encoded again.
+    ydb_path_write(datablock, "/firmware/version=1");
+    if (!ydb_path_read(datablock, "/firmware/image") ||
+        strcmp(ydb_path_read(datablock, "/firmware/image"), b64) != 0)
+    {
+        fprintf(stderr, "ydb_path_read failed after the change.\n");
+        res = YDB_E_FUNC;
+    }
+    free(b64);
+
+    // the same data doesn't change the leaf.
+    ydb_blob_write(datablock, "/firmware/image", image, len);
+    image[0]++;
+    ydb_blob_write(datablock, "/firmware/image", image, len);
+    printf("hooks: %d\n", hooked);
+    if (hooked != 2)
+        res = YDB_E_FUNC;
+
+    // the binary leaf is printed as !!binary and parsed to the binary leaf again.
+    fp = open_memstream(&dump, &dumplen);
+    ydb_dump(datablock, fp);
+    fclose(fp);
+    if (!strstr(dump, "!!binary"))
+        res = YDB_E_FUNC;
+    ydb_parses(copied, dump, dumplen);
+    if (ydb_blob_read(copied, "/firmware/image", &blob, &blen) ||
+        blen != len || memcmp(blob, image, len) != 0)
+    {
+        fprintf(stderr, "the binary leaf is not copied.\n");
+        res = YDB_E_FUNC;
+    }
+    free(dump);
+
+    // ydb_read gets the base64 string of the binary leaf.
+    b64 = binary_to_base64(image, len, &b64len);
+    readbuf = calloc(1, b64len + 1);
+    ydb_read(datablock, "firmware: {image: %s}\n", readbuf);
+    if (strcmp(readbuf, b64) != 0)
+    {
+        fprintf(stderr, "ydb_read failed.\n");
+        res = YDB_E_FUNC;
+    }
+    free(readbuf);
+
+    // compare the access with the base64 string leaf.
+    ydb_write(datablock, "firmware: {encoded: %s}\n", b64);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loop; i++)
+    {
+        const char *v = ydb_path_read(datablock, "/firmware/encoded");
+        unsigned char *bin = base64_to_binary((char *)v, 0, &blen);
+        free(bin);
+    }
+    printf("base64 leaf: %.1f ns/read\n", elapsed_ns(&start) / loop);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loop; i++)
+        ydb_blob_read(datablock, "/firmware/image", &blob, &blen);
+    printf("binary leaf: %.1f ns/read\n", elapsed_ns(&start) / loop);
+    free(b64);
+
+    free(image);
+    ydb_close(copied);
+    ydb_close(datablock);
+    printf("%s\n", res ? "failed" : "ok");
+    return res ? 1 : 0;
+}
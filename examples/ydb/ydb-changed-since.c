@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+char *example_yaml =
+    "interfaces:\n"
+    " ge1:\n"
+    "  enabled: true\n"
+    "  mtu: 1500\n"
+    " ge2:\n"
+    "  enabled: true\n"
+    "  mtu: 1500\n"
+    " ge3:\n"
+    "  enabled: true\n"
+    "  mtu: 1500\n";
+
+ydb_res print_changed(ydb *datablock, ynode *cur, void *U1)
+{
+    int *num = U1;
+    char *path = ydb_path(datablock, cur, NULL);
+    printf(" %s %s\n", path ? path : "unknown", ydb_value(cur) ? ydb_value(cur) : "");
+    if (path)
+        free(path);
+    (*num)++;
+    return YDB_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    ydb *datablock, *other;
+    ydb_res res;
+    unsigned long gen, other_gen;
+    int changed = 0, all = 0;
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    if (!datablock)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    res = ydb_parses(datablock, example_yaml, strlen(example_yaml));
+    if (res)
+        goto _done;
+
+    gen = ydb_generation(datablock);
+    printf("generation: %lu\n", gen);
+    ydb_write(datablock, "interfaces: {ge1: {mtu: 9000}, ge2: {enabled: false}}\n");
+    ydb_delete(datablock, "interfaces: {ge3: {mtu: }}\n");
+    printf("generation: %lu\n", ydb_generation(datablock));
+
+    // the changes of other datablock don't increase the generation.
+    other_gen = ydb_generation(datablock);
+    other = ydb_open("other");
+    ydb_write(other, "system: {hostname: other}\n");
+    ydb_close(other);
+    if (ydb_generation(datablock) != other_gen)
+    {
+        fprintf(stderr, "generation changed by other datablock.\n");
+        res = YDB_E_CTRL;
+        goto _done;
+    }
+
+    printf("changed values since %lu:\n", gen);
+    res = ydb_changed_since(datablock, "/interfaces", gen,
+                            (ydb_traverse_callback)print_changed, "val-only", &changed);
+    if (res)
+        goto _done;
+    printf("changed nodes since %lu:\n", gen);
+    res = ydb_changed_since(datablock, NULL, gen,
+                            (ydb_traverse_callback)print_changed, NULL, &all);
+_done:
+    if (res)
+        fprintf(stderr, "ydb_changed_since failed. (%s)\n", ydb_res_str(res));
+    ydb_close(datablock);
+    // ge1/mtu and ge2/enabled are changed values.
+    // top, interfaces, ge1, ge1/mtu, ge2, ge2/enabled and ge3 (deleted mtu) are changed nodes.
+    if (res || changed != 2 || all != 7)
+        return 1;
+    return 0;
+}
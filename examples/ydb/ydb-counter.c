@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+// count the changes logged for the datablock.
+static int changes;
+
+void count_change(ydb *datablock, int started, void *user)
+{
+    if (started)
+        changes++;
+}
+
+// count the counter replaced in place.
+static int hooked;
+
+void counter_hook(ydb *datablock, char op, ynode *base, ynode *cur, ynode *_new)
+{
+    if (op == 'r' && cur == _new)
+        hooked++;
+}
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static int check_value(ydb *datablock, const char *path, const char *expected)
+{
+    const char *value = ydb_path_read(datablock, "%s", path);
+    if (!value || strcmp(value, expected) != 0)
+    {
+        printf("failed: %s=%s (expected %s)\n", path, value ? value : "(null)", expected);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int loop = 100000;
+    int failed = 0;
+    char expected[64];
+    char *dump = NULL;
+    size_t dumplen = 0;
+    FILE *fp;
+    ydb *datablock, *copied;
+    struct timespec start;
+    double ns;
+
+    if (argc >= 2)
+        loop = atoi(argv[1]);
+    if (loop <= 0)
+    {
+        fprintf(stderr, "usage: %s [LOOP]\n", argv[0]);
+        return 1;
+    }
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("stats");
+    copied = ydb_open("copied");
+    if (!datablock || !copied)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    ydb_onchange_hook_add(datablock, count_change, NULL);
+
+    // the string counter updated by read, parse, format and write.
+    ydb_path_write(datablock, "/interfaces/ge1/out-octets=0");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loop / 10; i++)
+    {
+        unsigned long long v = strtoull(ydb_path_read(datablock, "/interfaces/ge1/out-octets"), NULL, 10);
+        ydb_path_write(datablock, "/interfaces/ge1/out-octets=%llu", v + 64);
+    }
+    ns = elapsed_ns(&start);
+    printf("ydb_path_read/write: %.1f ns/increment\n", ns / (loop / 10));
+
+    // the counter created by the first increment is published at once.
+    changes = 0;
+    ydb_counter_add(datablock, "/interfaces/ge1/in-octets", 64);
+    failed += (changes != 1);
+    ydb_write_hook_add(datablock, "/interfaces/ge1/in-octets", 0, (ydb_write_hook)counter_hook, 0);
+    changes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 1; i < loop; i++)
+        ydb_counter_add(datablock, "/interfaces/ge1/in-octets", 64);
+    ns = elapsed_ns(&start);
+    printf("ydb_counter_add: %.1f ns/increment\n", ns / (loop - 1));
+
+    // the increments are logged and hooked once at the flush.
+    failed += (changes != 0 || hooked != 0);
+    snprintf(expected, sizeof(expected), "%lld", 64LL * loop);
+    failed += check_value(datablock, "/interfaces/ge1/in-octets", expected);
+    ydb_counter_flush(datablock);
+    ydb_counter_flush(datablock);
+    printf("changes: %d, hooks: %d\n", changes, hooked);
+    failed += (changes != 1 || hooked != 1);
+
+    // a string leaf having an integer is converted to the counter.
+    snprintf(expected, sizeof(expected), "%d", 64 * (loop / 10) - 1);
+    ydb_counter_add(datablock, "/interfaces/ge1/out-octets", -1);
+    failed += check_value(datablock, "/interfaces/ge1/out-octets", expected);
+    ydb_write(datablock, "interfaces: {ge1: {speed: !!float 2.5, name: ge1}}\n");
+    ydb_counter_add(datablock, "/interfaces/ge1/speed", 1);
+    failed += check_value(datablock, "/interfaces/ge1/speed", "3.5");
+    failed += (ydb_counter_add(datablock, "/interfaces/ge1/name", 1) != YDB_E_TYPE_ERR);
+    ydb_txn_begin(datablock);
+    failed += (ydb_counter_add(datablock, "/interfaces/ge1/in-octets", 1) != YDB_E_CTRL);
+    ydb_txn_abort(datablock);
+
+    // the number leaf not changed by the counter keeps the original text.
+    ydb_write(datablock, "port: {id: !!int 007, mtu: !!float 1.50, rate: !!float 1e3}\n");
+    failed += check_value(datablock, "/port/id", "007");
+    failed += check_value(datablock, "/port/mtu", "1.50");
+    failed += check_value(datablock, "/port/rate", "1e3");
+    ydb_counter_add(datablock, "/port/id", 1);
+    failed += check_value(datablock, "/port/id", "8");
+    ydb_counter_add(datablock, "/port/mtu", 1);
+    failed += check_value(datablock, "/port/mtu", "2.5");
+
+    // the counter is printed as !!int and parsed to the counter again.
+    fp = open_memstream(&dump, &dumplen);
+    ydb_dump(datablock, fp);
+    fclose(fp);
+    failed += (strstr(dump, "!!int") == NULL);
+    ydb_parses(copied, dump, dumplen);
+    free(dump);
+    ydb_counter_add(copied, "/interfaces/ge1/in-octets", 1);
+    snprintf(expected, sizeof(expected), "%lld", 64LL * loop + 1);
+    failed += check_value(copied, "/interfaces/ge1/in-octets", expected);
+
+    ydb_close(copied);
+    ydb_close(datablock);
+    printf("%s\n", failed ? "failed" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+static int suppressed;
+static int batched;
+static int changes;
+static int deleted;
+
+void count_suppressed(ydb *datablock, char op, ynode *base, void *U1)
+{
+    suppressed++;
+}
+
+void count_batch(ydb *datablock, ynode *base, ydb_write_change *c, int num, void *user)
+{
+    int i;
+    batched++;
+    changes += num;
+    for (i = 0; i < num; i++)
+    {
+        if (c[i].op == 'd' && c[i].cur && ydb_value(c[i].cur))
+            deleted++;
+    }
+}
+
+static double elapsed_ms(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1000.0 +
+           (end.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int ifnum = 5000;
+    char *buf = NULL;
+    size_t buflen = 0;
+    FILE *fp;
+    ydb *datablock;
+    ydb_res res = YDB_OK;
+    struct timespec start;
+
+    if (argc >= 2)
+        ifnum = atoi(argv[1]);
+    if (ifnum <= 0)
+    {
+        fprintf(stderr, "usage: %s [INTERFACE_NUM]\n", argv[0]);
+        return 1;
+    }
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    if (!datablock)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    for (i = 0; i < ifnum; i++)
+    {
+        char path[64];
+        sprintf(path, "/interfaces/ge%d", i);
+        ydb_write_hook_add(datablock, path, 1, (ydb_write_hook)count_suppressed, 0);
+    }
+    ydb_write_batch_hook_add(datablock, "/statistics", count_batch, NULL);
+
+    fp = open_memstream(&buf, &buflen);
+    if (!fp)
+    {
+        ydb_close(datablock);
+        return 1;
+    }
+    fprintf(fp, "interfaces:\n");
+    for (i = 0; i < ifnum; i++)
+        fprintf(fp, " ge%d:\n  enabled: true\n  mtu: 1500\n", i);
+    fprintf(fp, "statistics:\n");
+    for (i = 0; i < ifnum; i++)
+        fprintf(fp, " ge%d: %d\n", i, i);
+    fclose(fp);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    res = ydb_parses(datablock, buf, buflen);
+    printf("merge: hooks=%d suppressed=%d batch=%d changes=%d (%.3f ms)\n",
+           ifnum, suppressed, batched, changes, elapsed_ms(&start));
+    free(buf);
+    if (res || suppressed != ifnum || batched != 1 || changes != ifnum)
+        res = YDB_E_FUNC;
+
+    batched = changes = 0;
+    ydb_path_delete(datablock, "/statistics");
+    printf("delete: batch=%d changes=%d deleted=%d\n", batched, changes, deleted);
+    if (batched != 1 || deleted != ifnum)
+        res = YDB_E_FUNC;
+
+    ydb_close(datablock);
+    printf("%s\n", ydb_res_str(res));
+    return res ? 1 : 0;
+}
@@ -98,7 +98,7 @@ int test_hook()
             goto _done;
     }
 
-    ydb_read_hook_add(datablock, "interface[name=1/1]", (ydb_read_hook)update_hook, 0);
+    ydb_read_hook_add(datablock, "interface[name=1/1]", 0, (ydb_read_hook)update_hook, 0);
 
     char enabled[32] = {0};
     ydb_read(datablock, "interface[name=1/1]: {enabled: %s}\n", enabled);
@@ -144,7 +144,7 @@ int test_remote_hook(int n)
 
     char path[64];
     sprintf(path, "/interfaces/interface[name=ge%d]", n);
-    ydb_read_hook_add(datablock, path, (ydb_read_hook)update_hook1, 1, n);
+    ydb_read_hook_add(datablock, path, 0, (ydb_read_hook)update_hook1, 1, n);
 
     // ignore SIGPIPE.
     signal(SIGPIPE, SIG_IGN);
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+static int oper;
+static int counters;
+static int suppressed;
+
+void oper_status(ydb *datablock, char op, ynode *base, ynode *cur, ynode *_new, void *U1)
+{
+    char *path = ydb_path(datablock, _new ? _new : cur, NULL);
+    printf(" HOOK (%c) %s %s\n", op, path ? path : "unknown",
+           ydb_value(_new ? _new : cur) ? ydb_value(_new ? _new : cur) : "");
+    if (path)
+        free(path);
+    oper++;
+}
+
+void count_counters(ydb *datablock, char op, ynode *base, ynode *cur, ynode *_new, void *U1)
+{
+    counters++;
+}
+
+void count_suppressed(ydb *datablock, char op, ynode *base, void *U1)
+{
+    suppressed++;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    ydb *datablock;
+    ydb_res res = YDB_OK;
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    if (!datablock)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    ydb_write_hook_add(datablock, "/interfaces/*/state/oper-status", 0, (ydb_write_hook)oper_status, 0);
+    ydb_write_hook_add(datablock, "/interfaces/**/in", 0, (ydb_write_hook)count_counters, 0);
+    ydb_write_hook_add(datablock, "/interfaces/*", 1, (ydb_write_hook)count_suppressed, 0);
+    // the hook registered to a node doesn't hide the wildcard hooks.
+    ydb_write_hook_add(datablock, "/interfaces/ge1", 0, (ydb_write_hook)count_counters, 0);
+    counters = 0;
+
+    for (i = 0; i < 3; i++)
+    {
+        ydb_write(datablock,
+                  "interfaces:\n"
+                  " ge%d:\n"
+                  "  state:\n"
+                  "   oper-status: up\n"
+                  "   admin-status: up\n"
+                  "   counters:\n"
+                  "    in: %d\n"
+                  "    out: %d\n",
+                  i, i, i);
+    }
+    // the suppressed hook runs once for each write.
+    printf("create: oper=%d suppressed=%d\n", oper, suppressed);
+    if (oper != 3 || suppressed != 3)
+        res = YDB_E_FUNC;
+
+    oper = counters = 0;
+    ydb_path_write(datablock, "/interfaces/ge2/state/oper-status=down");
+    ydb_path_write(datablock, "/interfaces/ge2/state/admin-status=down");
+    ydb_path_write(datablock, "/interfaces/ge0/state/counters/in=100");
+    printf("replace: oper=%d counters=%d\n", oper, counters);
+    if (oper != 1 || counters != 1)
+        res = YDB_E_FUNC;
+
+    oper = 0;
+    ydb_path_delete(datablock, "/interfaces/ge1");
+    printf("delete: oper=%d\n", oper);
+    if (oper != 1)
+        res = YDB_E_FUNC;
+
+    oper = 0;
+    ydb_write_hook_delete(datablock, "/interfaces/*/state/oper-status");
+    ydb_path_write(datablock, "/interfaces/ge0/state/oper-status=down");
+    printf("unregistered: oper=%d\n", oper);
+    if (oper != 0)
+        res = YDB_E_FUNC;
+
+    ydb_close(datablock);
+    printf("%s\n", ydb_res_str(res));
+    return res ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ytree.h"
+#include "ydb.h"
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+// the comparison parsing the integer keys every time.
+static int atoi_cmp(char *a, char *b)
+{
+    int res = atoi(a) - atoi(b);
+    if (res < 0 || res > 0)
+        return res;
+    return strcmp(a, b);
+}
+
+// check the imap children are ordered by the integer keys.
+static int check_order(ynode *vlan, int num)
+{
+    int count = 0, prev = -1;
+    ynode *node;
+    for (node = ydb_down(vlan); node; node = ydb_next(node))
+    {
+        int cur = atoi(ydb_key(node));
+        if (cur < prev)
+            return 1;
+        if (atoi(ydb_value(node)) != cur)
+            return 1;
+        prev = cur;
+        count++;
+    }
+    return count != num;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, num = 4094, repeat = 100, r, failed = 0;
+    int *order;
+    char **keys;
+    char *buf;
+    size_t len = 0;
+    double imap_ns = 0, atoi_ns = 0;
+    struct timespec start;
+    ytree *tree;
+    ynode *vlan, *node;
+    ydb *datablock;
+
+    if (argc >= 2)
+        num = atoi(argv[1]);
+    if (num <= 0)
+    {
+        fprintf(stderr, "usage: %s [KEY_NUM]\n", argv[0]);
+        return 1;
+    }
+    // the vlan ids 2, 4, 6, ... in the shuffled order.
+    keys = malloc(sizeof(char *) * num);
+    order = malloc(sizeof(int) * num);
+    for (i = 0; i < num; i++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "%d", (i + 1) * 2);
+        keys[i] = strdup(key);
+        order[i] = i;
+    }
+    srand(1);
+    for (i = num - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    buf = malloc(32 * (num + 2));
+    len += sprintf(buf + len, "vlan: !!imap\n");
+    for (i = 0; i < num; i++)
+        len += sprintf(buf + len, "  %s: %s\n", keys[order[i]], keys[order[i]]);
+
+    datablock = ydb_open("imap");
+    if (ydb_parses(datablock, buf, len))
+        failed++;
+    vlan = ydb_search(datablock, "/vlan");
+    if (!vlan || check_order(vlan, num))
+        failed++;
+
+    // the nearby search of the missing (odd) keys.
+    for (i = 0; i < num; i++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "%d", i * 2 + 1);
+        node = ydb_find_child_by_prefix(vlan, key);
+        if (i + 1 < num && (!node || atoi(ydb_key(node)) != i * 2 + 2))
+            failed++;
+    }
+
+    tree = ytree_create((ytree_cmp)atoi_cmp, NULL);
+    for (i = 0; i < num; i++)
+        ytree_insert(tree, keys[order[i]], keys[order[i]]);
+
+    for (r = 0; r < repeat; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num; i++)
+        {
+            node = ydb_find_child(vlan, keys[i]);
+            if (!node || strcmp(ydb_value(node), keys[i]))
+                failed++;
+        }
+        imap_ns += elapsed_ns(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num; i++)
+        {
+            if (ytree_search(tree, keys[i]) != keys[i])
+                failed++;
+        }
+        atoi_ns += elapsed_ns(&start);
+    }
+    printf("imap keys %d: find_child %.1f ns, ytree with atoi cmp %.1f ns%s\n",
+           num, imap_ns / repeat / num, atoi_ns / repeat / num,
+           failed ? " (failed)" : "");
+
+    ytree_destroy(tree);
+    ydb_close(datablock);
+    for (i = 0; i < num; i++)
+        free(keys[i]);
+    free(keys);
+    free(order);
+    free(buf);
+    return failed ? 1 : 0;
+}
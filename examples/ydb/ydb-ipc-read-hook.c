@@ -57,7 +57,7 @@ int main(int argc, char *argv[])
             fprintf(stderr, "ydb_open failed.\n");
             goto _done;
         }
-        ydb_read_hook_add(datablock, "/system/interface", (ydb_read_hook)read_hook, 0);
+        ydb_read_hook_add(datablock, "/system/interface", 0, (ydb_read_hook)read_hook, 0);
         res = ydb_connect(datablock, "us:///tmp/test", "pub");
         if (res)
             goto _done;
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+#define PARALLEL_NUM 4
+#define SERIAL_NUM 2
+#define HOOK_NUM (PARALLEL_NUM + SERIAL_NUM)
+#define HOOK_DELAY_US 50000
+
+// count the changes logged for the datablock.
+static int changes;
+
+void count_change(ydb *datablock, int started, void *user)
+{
+    if (started)
+        changes++;
+}
+
+// the slow read hook (e.g. reading the hardware).
+ydb_res slow_hook(ydb *datablock, char *path, FILE *fp, void *U1)
+{
+    long n = (long)U1;
+    usleep(HOOK_DELAY_US);
+    fprintf(fp, "ports:\n port%ld: {status: up-%ld}\n", n, n);
+    return YDB_OK;
+}
+
+// the serial read hooks must not be run at the same time.
+static int serial_running;
+static int serial_overlapped;
+
+ydb_res serial_hook(ydb *datablock, char *path, FILE *fp, void *U1)
+{
+    if (__atomic_add_fetch(&serial_running, 1, __ATOMIC_SEQ_CST) > 1)
+        __atomic_store_n(&serial_overlapped, 1, __ATOMIC_SEQ_CST);
+    slow_hook(datablock, path, fp, U1);
+    __atomic_sub_fetch(&serial_running, 1, __ATOMIC_SEQ_CST);
+    return YDB_OK;
+}
+
+static double elapsed_ms(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    long i;
+    int failed = 0;
+    char status[HOOK_NUM][32];
+    char expected[32];
+    struct timespec start;
+    double ms;
+    ydb *datablock;
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("ports");
+    if (!datablock)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    for (i = 0; i < HOOK_NUM; i++)
+    {
+        char path[64];
+        ydb_write(datablock, "ports: {port%ld: {status: down}}\n", i);
+        snprintf(path, sizeof(path), "/ports/port%ld/status", i);
+        if (i < PARALLEL_NUM)
+            ydb_read_hook_add(datablock, path, 1, (ydb_read_hook)slow_hook, 1, (void *)i);
+        else
+            ydb_read_hook_add(datablock, path, 0, (ydb_read_hook)serial_hook, 1, (void *)i);
+    }
+    ydb_onchange_hook_add(datablock, count_change, NULL);
+
+    // all read hooks are executed by a read and merged at once.
+    memset(status, 0x0, sizeof(status));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ydb_read(datablock,
+             "ports:\n"
+             " port0: {status: %s}\n"
+             " port1: {status: %s}\n"
+             " port2: {status: %s}\n"
+             " port3: {status: %s}\n"
+             " port4: {status: %s}\n"
+             " port5: {status: %s}\n",
+             status[0], status[1], status[2], status[3], status[4], status[5]);
+    ms = elapsed_ms(&start);
+    printf("%d parallel and %d serial read hooks (%d ms each): %.1f ms, changes: %d\n",
+           PARALLEL_NUM, SERIAL_NUM, HOOK_DELAY_US / 1000, ms, changes);
+    for (i = 0; i < HOOK_NUM; i++)
+    {
+        snprintf(expected, sizeof(expected), "up-%ld", i);
+        if (strcmp(status[i], expected) != 0)
+        {
+            printf("failed: port%ld status=%s (expected %s)\n", i, status[i], expected);
+            failed++;
+        }
+    }
+    failed += (changes != 1);
+    // the serial read hooks are run one by one by the reading thread
+    // while the parallel read hooks are run by the worker threads.
+    failed += serial_overlapped;
+    failed += (ms < SERIAL_NUM * HOOK_DELAY_US / 1000.0);
+    failed += (ms >= HOOK_NUM * HOOK_DELAY_US / 1000.0 * 2 / 3);
+
+    ydb_close(datablock);
+    printf("%s\n", failed ? "failed" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+// sum all in-octets counters of the interfaces.
+struct counter_sum
+{
+    unsigned long long sum;
+    unsigned long num;
+};
+
+ydb_res sum_counter(ydb *datablock, ynode *cur, void *U1)
+{
+    struct counter_sum *s = U1;
+    const char *key = ydb_key(cur);
+    if (key && strcmp(key, "in-octets") == 0)
+    {
+        s->sum += strtoull(ydb_value(cur), NULL, 10);
+        s->num++;
+    }
+    return YDB_OK;
+}
+
+static double elapsed_ms(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1000.0 +
+           (end.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int ifnum = 50000;
+    int threads = 4;
+    char *buf = NULL;
+    size_t buflen = 0;
+    FILE *fp;
+    ydb *datablock;
+    ydb_res res;
+    struct timespec start;
+    struct counter_sum single = {0, 0};
+    struct counter_sum *sums;
+    void **states;
+    struct counter_sum total = {0, 0};
+
+    if (argc >= 2)
+        ifnum = atoi(argv[1]);
+    if (argc >= 3)
+        threads = atoi(argv[2]);
+    if (ifnum <= 0 || threads <= 0)
+    {
+        fprintf(stderr, "usage: %s [INTERFACE_NUM] [THREAD_NUM]\n", argv[0]);
+        return 1;
+    }
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    fp = open_memstream(&buf, &buflen);
+    if (!datablock || !fp)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    fprintf(fp, "interfaces:\n");
+    for (i = 0; i < ifnum; i++)
+    {
+        fprintf(fp,
+                " ge%d:\n"
+                "  statistics:\n"
+                "   in-octets: %d\n"
+                "   out-octets: %d\n",
+                i, i, i * 2);
+    }
+    fclose(fp);
+    res = ydb_parses(datablock, buf, buflen);
+    free(buf);
+    if (res)
+    {
+        fprintf(stderr, "ydb_parses failed. (%s)\n", ydb_res_str(res));
+        ydb_close(datablock);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ydb_traverse(datablock, NULL, (ydb_traverse_callback)sum_counter, "val-only", 1, &single);
+    printf("ydb_traverse: sum=%llu num=%lu (%.3f ms)\n",
+           single.sum, single.num, elapsed_ms(&start));
+
+    sums = calloc(threads, sizeof(struct counter_sum));
+    states = calloc(threads, sizeof(void *));
+    for (i = 0; i < threads; i++)
+        states[i] = &sums[i];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    res = ydb_traverse_parallel(datablock, ydb_search(datablock, "/interfaces"),
+                                (ydb_traverse_callback)sum_counter, "val-only", 1, threads, states);
+    for (i = 0; i < threads; i++)
+    {
+        total.sum += sums[i].sum;
+        total.num += sums[i].num;
+    }
+    printf("ydb_traverse_parallel: sum=%llu num=%lu threads=%d (%.3f ms) %s\n",
+           total.sum, total.num, threads, elapsed_ms(&start), ydb_res_str(res));
+    free(states);
+    free(sums);
+    ydb_close(datablock);
+    if (res || total.sum != single.sum || total.num != single.num)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ylog.h"
+#include "ydb.h"
+
+// count the changes applied to the datablock and the suppressed hook runs.
+static int changes;
+static int hooked;
+
+void count_change(ydb *datablock, int started, void *user)
+{
+    if (started)
+        changes++;
+}
+
+void count_hook(ydb *datablock, char op, ynode *base, void *U1)
+{
+    hooked++;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int ifnum = 1000;
+    ydb *datablock;
+    ydb_res res = YDB_OK;
+    char mtu[32] = {0};
+
+    if (argc >= 2)
+        ifnum = atoi(argv[1]);
+    if (ifnum <= 1)
+    {
+        fprintf(stderr, "usage: %s [INTERFACE_NUM > 1]\n", argv[0]);
+        return 1;
+    }
+
+    ylog_level = YLOG_ERROR;
+    datablock = ydb_open("top");
+    if (!datablock)
+    {
+        fprintf(stderr, "ydb_open failed.\n");
+        return 1;
+    }
+    ydb_onchange_hook_add(datablock, count_change, NULL);
+    ydb_write_hook_add(datablock, "/interfaces", 1, (ydb_write_hook)count_hook, 0);
+    changes = hooked = 0;
+
+    // without a transaction, each write is applied separately.
+    for (i = 0; i < ifnum; i++)
+        ydb_path_write(datablock, "/interfaces/ge%d/mtu=1500", i);
+    printf("writes: changes=%d hooks=%d\n", changes, hooked);
+    if (changes != ifnum || hooked != ifnum)
+        res = YDB_E_FUNC;
+
+    // the writes in a transaction are applied at once.
+    changes = hooked = 0;
+    ydb_txn_begin(datablock);
+    for (i = 0; i < ifnum; i++)
+        ydb_path_write(datablock, "/interfaces/ge%d/mtu=9000", i);
+    ydb_write(datablock, "interfaces:\n ge0:\n  enabled: true\n");
+    ydb_read(datablock, "interfaces:\n ge0:\n  mtu: %s\n", mtu);
+    printf("staged: mtu=%s\n", mtu);
+    if (strcmp(mtu, "1500") != 0)
+        res = YDB_E_FUNC;
+    ydb_txn_commit(datablock);
+    ydb_read(datablock, "interfaces:\n ge1:\n  mtu: %s\n", mtu);
+    printf("txn: changes=%d hooks=%d mtu=%s\n", changes, hooked, mtu);
+    if (changes != 1 || hooked != 1 || strcmp(mtu, "9000") != 0)
+        res = YDB_E_FUNC;
+
+    // the aborted changes are discarded.
+    changes = hooked = 0;
+    ydb_txn_begin(datablock);
+    ydb_path_delete(datablock, "/interfaces/ge1");
+    ydb_txn_abort(datablock);
+    printf("abort: changes=%d\n", changes);
+    if (changes != 0 || !ydb_search(datablock, "/interfaces/ge1"))
+        res = YDB_E_FUNC;
+
+    // the deletes in a transaction are applied in order.
+    ydb_txn_begin(datablock);
+    ydb_path_delete(datablock, "/interfaces/ge0/mtu");
+    ydb_delete(datablock, "interfaces:\n ge1:\n");
+    ydb_txn_commit(datablock);
+    printf("delete: changes=%d\n", changes);
+    if (changes != 1 || ydb_search(datablock, "/interfaces/ge1") ||
+        ydb_search(datablock, "/interfaces/ge0/mtu") ||
+        !ydb_search(datablock, "/interfaces/ge0/enabled"))
+        res = YDB_E_FUNC;
+
+    // ydb_parses and ydb_rm are also staged.
+    changes = 0;
+    ydb_txn_begin(datablock);
+    ydb_add(datablock, "interfaces:\n ge2:\n  enabled: false\n");
+    ydb_rm(datablock, "interfaces:\n ge3:\n");
+    if (ydb_search(datablock, "/interfaces/ge2/enabled") ||
+        !ydb_search(datablock, "/interfaces/ge3"))
+        res = YDB_E_FUNC;
+    ydb_txn_commit(datablock);
+    printf("parses: changes=%d\n", changes);
+    if (changes != 2 || !ydb_search(datablock, "/interfaces/ge2/enabled") ||
+        ydb_search(datablock, "/interfaces/ge3"))
+        res = YDB_E_FUNC;
+
+    ydb_close(datablock);
+    printf("%s\n", ydb_res_str(res));
+    return res ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utf8.h"
+
+// the keys and values usually emitted and parsed by ydb
+static const char *corpus[] = {
+    "interfaces",
+    "interface[name=1/1]",
+    "ge1",
+    "description",
+    "Uplink to the core router in the building 3, rack 12",
+    "enabled",
+    "true",
+    "192.168.77.1",
+    "prefix-length",
+    "link-up-down-trap-enable",
+    "oper-status",
+    "in-octets",
+    "18446744073709551615",
+    "2001:db8::1/64",
+    "/interfaces/interface[name=ge1]/state/counters/in-octets",
+    "openconfig-interfaces:interfaces",
+    "Caf\xc3\xa9 \xe2\x80\x94 the network operations center",
+    "a \"quoted\" value with a \\ backslash",
+    "multiple\nline\ntext",
+};
+
+static const struct
+{
+    const char *src;
+    int extended;
+    const char *yaml;
+} expected[] = {
+    {"ge1", 0, "ge1"},
+    {"Uplink to the core router in the building 3, rack 12", 0, "Uplink to the core router in the building 3, rack 12"},
+    {"key: value", 0, "\"key: value\""},
+    {"a \"quoted\" value", 0, "\"a \\\"quoted\\\" value\""},
+    {"/interfaces/interface[name=ge1]", 1, "\"/interfaces/interface[name=ge1]\""},
+    {"tab\tin the value", 0, "\"tab\\tin the value\""},
+};
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, j;
+    int loop = 200000;
+    int num = sizeof(corpus) / sizeof(corpus[0]);
+    int failed = 0;
+    size_t bytes = 0;
+    struct timespec start;
+    double ns;
+
+    if (argc >= 2)
+        loop = atoi(argv[1]);
+
+    for (i = 0; i < (int)(sizeof(expected) / sizeof(expected[0])); i++)
+    {
+        int is_new = 0;
+        char *yaml = to_yaml(expected[i].src, -1, &is_new, expected[i].extended);
+        char *str = to_string(yaml, 0, NULL);
+        if (strcmp(yaml, expected[i].yaml) != 0 || !str || strcmp(str, expected[i].src) != 0)
+        {
+            printf("failed: %s -> %s -> %s\n", expected[i].src, yaml, str ? str : "(null)");
+            failed++;
+        }
+        if (is_new)
+            free(yaml);
+        free(str);
+    }
+
+    for (j = 0; j < num; j++)
+        bytes += strlen(corpus[j]);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loop; i++)
+    {
+        for (j = 0; j < num; j++)
+        {
+            int is_new = 0;
+            char *yaml = to_yaml(corpus[j], -1, &is_new, j & 1);
+            if (is_new)
+                free(yaml);
+        }
+    }
+    ns = elapsed_ns(&start);
+    printf("to_yaml: %.1f ns/string, %.1f MB/s\n",
+           ns / ((double)loop * num), (double)bytes * loop / (ns / 1e9) / 1e6);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loop / 10; i++)
+    {
+        for (j = 0; j < num; j++)
+            free(to_string(corpus[j], 0, NULL));
+    }
+    ns = elapsed_ns(&start);
+    printf("to_string: %.1f ns/string\n", ns / ((double)(loop / 10) * num));
+    printf("%s\n", failed ? "failed" : "ok");
+    return failed ? 1 : 0;
+}
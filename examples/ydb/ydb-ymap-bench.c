@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ymap.h"
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static int count_entry(void *key, void *data, void *addition)
+{
+    (*(int *)addition)++;
+    return 0;
+}
+
+static char *new_key(int n)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%07d", n);
+    return strdup(buf);
+}
+
+// the reference model of the ymap: the keys ordered by the insertion.
+struct model
+{
+    int *keys;
+    int num;
+};
+
+static int model_find(struct model *m, int n)
+{
+    int i;
+    for (i = 0; i < m->num; i++)
+    {
+        if (m->keys[i] == n)
+            return i;
+    }
+    return -1;
+}
+
+static void model_remove(struct model *m, int i)
+{
+    memmove(&m->keys[i], &m->keys[i + 1], sizeof(int) * (m->num - i - 1));
+    m->num--;
+}
+
+static void model_insert(struct model *m, int i, int n)
+{
+    memmove(&m->keys[i + 1], &m->keys[i], sizeof(int) * (m->num - i));
+    m->keys[i] = n;
+    m->num++;
+}
+
+// compare the entries of the ymap with the model in both directions.
+static int compare_model(ymap *map, struct model *m)
+{
+    int i = 0;
+    ymap_iter *iter;
+    if (ymap_size(map) != (unsigned int)m->num)
+        return 1;
+    for (iter = ymap_first(map); iter; iter = ymap_next(map, iter), i++)
+    {
+        if (i >= m->num || (long)ymap_data(iter) != m->keys[i] + 1)
+            return 1;
+    }
+    if (i != m->num)
+        return 1;
+    for (iter = ymap_last(map); iter; iter = ymap_prev(map, iter))
+    {
+        if ((long)ymap_data(iter) != m->keys[--i] + 1)
+            return 1;
+    }
+    if (m->num > 0 && (long)ymap_data(ymap_index(map, m->num / 2)) != m->keys[m->num / 2] + 1)
+        return 1;
+    return i != 0;
+}
+
+// apply the same random operations to the ymap and the model.
+static int check_ymap(int ops, int range)
+{
+    int i, failed = 0;
+    struct model m;
+    ymap *map = ymap_create((ytree_cmp)strcmp, free);
+    m.keys = malloc(sizeof(int) * range);
+    m.num = 0;
+    srand(7);
+    for (i = 0; i < ops; i++)
+    {
+        int n = rand() % range;
+        int pos = model_find(&m, n);
+        void *data = (void *)(long)(n + 1);
+        char *key = new_key(n);
+        switch (rand() % 6)
+        {
+        case 0:
+            if (ymap_insert_back(map, new_key(n), data) != (pos >= 0 ? data : NULL))
+                failed++;
+            if (pos >= 0)
+                model_remove(&m, pos);
+            model_insert(&m, m.num, n);
+            break;
+        case 1:
+            if (ymap_insert_front(map, new_key(n), data) != (pos >= 0 ? data : NULL))
+                failed++;
+            if (pos >= 0)
+                model_remove(&m, pos);
+            model_insert(&m, 0, n);
+            break;
+        case 2:
+            if (ymap_delete(map, key) != (pos >= 0 ? data : NULL))
+                failed++;
+            if (pos >= 0)
+                model_remove(&m, pos);
+            break;
+        case 3:
+        {
+            ymap_iter *iter = ymap_find(map, key);
+            if (!iter != (pos < 0))
+                failed++;
+            else if (iter)
+            {
+                iter = ymap_remove(map, iter, NULL);
+                model_remove(&m, pos);
+                if (pos == 0 ? iter != NULL : (long)ymap_data(iter) != m.keys[pos - 1] + 1)
+                    failed++;
+            }
+            break;
+        }
+        case 4:
+        {
+            // insert next to the random entry found by the index or the key.
+            // ymap_find doesn't compact the deleted entries.
+            ymap_iter *iter = NULL;
+            int at = m.num > 0 ? rand() % m.num : 0;
+            if (m.num > 0 && rand() % 2)
+                iter = ymap_index(map, at);
+            else if (m.num > 0)
+            {
+                char *atkey = new_key(m.keys[at]);
+                iter = ymap_find(map, atkey);
+                free(atkey);
+            }
+            if (pos >= 0)
+            {
+                if (ymap_insert(map, iter, key, data))
+                    failed++;
+                break;
+            }
+            iter = ymap_insert(map, iter, new_key(n), data);
+            if (!iter || ymap_data(iter) != data)
+                failed++;
+            model_insert(&m, m.num > 0 ? at + 1 : 0, n);
+            break;
+        }
+        default:
+        {
+            void *k = NULL, *d = NULL;
+            if (ymap_search(map, key) != (pos >= 0 ? data : NULL))
+                failed++;
+            if (m.num > 0 && (rand() % 4) == 0)
+            {
+                int back = rand() % 2;
+                int expected = back ? m.keys[m.num - 1] : m.keys[0];
+                if (back)
+                    ymap_pop_tail(map, &k, &d);
+                else
+                    ymap_pop_front(map, &k, &d);
+                if ((long)d != expected + 1)
+                    failed++;
+                model_remove(&m, back ? m.num - 1 : 0);
+                free(k);
+            }
+            break;
+        }
+        }
+        free(key);
+        if (i % 100 == 0 && compare_model(map, &m))
+            failed++;
+    }
+    if (compare_model(map, &m))
+        failed++;
+    ymap_destroy(map);
+    free(m.keys);
+    return failed;
+}
+
+// insert and delete the new keys repeatedly.
+// The deleted slots of the index table must not fill up the table.
+static int check_churn(int cycles)
+{
+    int i, failed = 0;
+    ymap *map = ymap_create((ytree_cmp)strcmp, free);
+    ymap_insert_back(map, new_key(-1), (void *)1);
+    for (i = 0; i < cycles; i++)
+    {
+        char *key = new_key(i);
+        void *data = (void *)(long)(i + 2);
+        if (ymap_insert_back(map, new_key(i), data))
+            failed++;
+        if (ymap_search(map, key) != data || ymap_size(map) != 2)
+            failed++;
+        if (ymap_delete(map, key) != data || ymap_exist(map, key))
+            failed++;
+        free(key);
+    }
+    if (ymap_size(map) != 1 || ymap_data(ymap_first(map)) != (void *)1)
+        failed++;
+    ymap_destroy(map);
+    return failed;
+}
+
+// insert next to the iterator while the deleted entries exist.
+static int check_insert_hole(void)
+{
+    int failed = 0;
+    ymap_iter *iter;
+    ymap *map = ymap_create((ytree_cmp)strcmp, NULL);
+    ymap_insert_back(map, "a", "a");
+    ymap_insert_back(map, "b", "b");
+    ymap_insert_back(map, "c", "c");
+    ymap_delete(map, "a");
+    iter = ymap_insert(map, ymap_find(map, "b"), "x", "x");
+    if (!iter || strcmp(ymap_data(iter), "x") != 0)
+        failed++;
+    iter = ymap_first(map);
+    if (!iter || strcmp(ymap_data(iter), "b") != 0)
+        failed++;
+    iter = ymap_next(map, iter);
+    if (!iter || strcmp(ymap_data(iter), "x") != 0)
+        failed++;
+    iter = ymap_next(map, iter);
+    if (!iter || strcmp(ymap_data(iter), "c") != 0 || ymap_next(map, iter))
+        failed++;
+    ymap_destroy(map);
+    return failed;
+}
+
+static int run(char **keys, int num)
+{
+    int i, count = 0, failed = 0;
+    double insert_ns, search_ns, iter_ns, delete_ns;
+    struct timespec start;
+    ymap_iter *iter;
+    ymap *map = ymap_create((ytree_cmp)strcmp, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+        ymap_insert_back(map, keys[i], keys[i]);
+    insert_ns = elapsed_ns(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ymap_search(map, keys[i]) != keys[i])
+            failed++;
+    }
+    search_ns = elapsed_ns(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (iter = ymap_first(map); iter; iter = ymap_next(map, iter))
+        count++;
+    ymap_traverse_order(map, count_entry, &count);
+    iter_ns = elapsed_ns(&start) / 2;
+    if (count != num * 2)
+        failed++;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ymap_delete(map, keys[(i * 7919) % num]) != keys[(i * 7919) % num])
+            failed++;
+    }
+    delete_ns = elapsed_ns(&start);
+    if (ymap_size(map) != 0)
+        failed++;
+    ymap_destroy(map);
+
+    printf("ymap insert %6.1f ns, search %6.1f ns, iterate %5.1f ns, delete %6.1f ns%s\n",
+           insert_ns / num, search_ns / num, iter_ns / num, delete_ns / num,
+           failed ? " (failed)" : "");
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, num = 200000, failed = 0;
+    char **keys;
+    if (argc >= 2)
+        num = atoi(argv[1]);
+    if (num <= 0)
+    {
+        fprintf(stderr, "usage: %s [KEY_NUM]\n", argv[0]);
+        return 1;
+    }
+    failed = check_ymap(100000, 500);
+    failed += check_churn(100000);
+    failed += check_insert_hole();
+    printf("check: ymap and the model %s\n", failed ? "differ" : "are the same");
+
+    // num must not be a multiple of 7919 to delete all keys.
+    if (num % 7919 == 0)
+        num++;
+    keys = malloc(sizeof(char *) * num);
+    for (i = 0; i < num; i++)
+        keys[i] = new_key(i);
+    failed += run(keys, num);
+    for (i = 0; i < num; i++)
+        free(keys[i]);
+    free(keys);
+    return failed ? 1 : 0;
+}
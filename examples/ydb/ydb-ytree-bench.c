@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ytree.h"
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static int count_entry(void *key, void *data, void *addition)
+{
+    (*(int *)addition)++;
+    return 0;
+}
+
+static char *new_key(int n)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%07d", n);
+    return strdup(buf);
+}
+
+// compare the entries of the AVL tree and the B+tree.
+static int compare_trees(ytree *avl, ytree *bt)
+{
+    ytree_iter *a, *b;
+    if (ytree_size(avl) != ytree_size(bt))
+        return 1;
+    a = ytree_first(avl);
+    b = ytree_first(bt);
+    for (; a && b; a = ytree_next(avl, a), b = ytree_next(bt, b))
+    {
+        if (strcmp(ytree_key(a), ytree_key(b)) != 0 || ytree_data(a) != ytree_data(b))
+            return 1;
+    }
+    if (a || b)
+        return 1;
+    a = ytree_last(avl);
+    b = ytree_last(bt);
+    for (; a && b; a = ytree_prev(avl, a), b = ytree_prev(bt, b))
+    {
+        if (strcmp(ytree_key(a), ytree_key(b)) != 0)
+            return 1;
+    }
+    return (a || b) ? 1 : 0;
+}
+
+static int collect_key(void *key, void *data, void *addition)
+{
+    char ***keys = addition;
+    *((*keys)++) = key;
+    return 0;
+}
+
+// compare ytree_traverse_reverse() with the iteration by ytree_prev().
+static int compare_reverse(ytree *tree)
+{
+    int failed = 0;
+    char **keys = malloc(sizeof(char *) * (ytree_size(tree) + 1));
+    char **pos = keys;
+    ytree_iter *iter;
+    ytree_traverse_reverse(tree, collect_key, &pos);
+    pos = keys;
+    for (iter = ytree_last(tree); iter; iter = ytree_prev(tree, iter))
+    {
+        if (*pos++ != ytree_key(iter))
+            failed++;
+    }
+    free(keys);
+    return failed;
+}
+
+// apply the same random operations to the AVL tree and the B+tree.
+static int check_btree(int ops, int range)
+{
+    int i, failed = 0;
+    ytree *avl = ytree_create((ytree_cmp)strcmp, free);
+    ytree *bt = ytree_create_opt((ytree_cmp)strcmp, free, YTREE_BTREE);
+    srand(7);
+    for (i = 0; i < ops; i++)
+    {
+        int n = rand() % range;
+        void *data = (void *)(long)(n + 1);
+        char *key = new_key(n);
+        switch (rand() % 6)
+        {
+        case 0:
+        case 1:
+            if (ytree_insert(avl, new_key(n), data) != ytree_insert(bt, new_key(n), data))
+                failed++;
+            break;
+        case 2:
+            if (ytree_delete(avl, key) != ytree_delete(bt, key))
+                failed++;
+            break;
+        case 3:
+        {
+            ytree_iter *a = ytree_find(avl, key);
+            ytree_iter *b = ytree_find(bt, key);
+            void *da = NULL, *db = NULL;
+            if (!a != !b)
+                failed++;
+            else if (a)
+            {
+                a = ytree_remove(avl, a, &da);
+                b = ytree_remove(bt, b, &db);
+                if (da != db || !a != !b || (a && strcmp(ytree_key(a), ytree_key(b))))
+                    failed++;
+            }
+            break;
+        }
+        case 4:
+        {
+            void *da = NULL, *db = NULL;
+            ytree_iter *a = ytree_push(avl, new_key(n), data, &da);
+            ytree_iter *b = ytree_push(bt, new_key(n), data, &db);
+            if (da != db || strcmp(ytree_key(a), ytree_key(b)))
+                failed++;
+            break;
+        }
+        default:
+        {
+            int ca = 0, cb = 0;
+            char *high = new_key(n + range / 20);
+            int lower;
+            for (lower = 0; lower <= 1; lower++)
+            {
+                ytree_iter *a = ytree_find_nearby(avl, key, lower);
+                ytree_iter *b = ytree_find_nearby(bt, key, lower);
+                if (!a != !b || (a && ytree_data(a) != ytree_data(b)))
+                    failed++;
+            }
+            ytree_traverse_in_range(avl, key, high, count_entry, &ca);
+            ytree_traverse_in_range(bt, key, high, count_entry, &cb);
+            if (ytree_search(avl, key) && ca != cb)
+                failed++;
+            free(high);
+            break;
+        }
+        }
+        free(key);
+        if (i % 1000 == 0 && compare_trees(avl, bt))
+            failed++;
+    }
+    if (compare_trees(avl, bt))
+        failed++;
+    failed += compare_reverse(avl);
+    failed += compare_reverse(bt);
+    ytree_destroy(avl);
+    ytree_destroy(bt);
+    return failed;
+}
+
+static int run(const char *name, unsigned int opt, char **keys, int *order, int num)
+{
+    int i, count = 0, failed = 0;
+    double insert_ns, search_ns, iter_ns, delete_ns;
+    struct timespec start;
+    ytree_iter *iter;
+    ytree *tree = ytree_create_opt((ytree_cmp)strcmp, NULL, opt);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+        ytree_insert(tree, keys[order[i]], keys[order[i]]);
+    insert_ns = elapsed_ns(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ytree_search(tree, keys[i]) != keys[i])
+            failed++;
+    }
+    search_ns = elapsed_ns(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (iter = ytree_first(tree); iter; iter = ytree_next(tree, iter))
+        count++;
+    ytree_traverse(tree, count_entry, &count);
+    iter_ns = elapsed_ns(&start) / 2;
+    if (count != num * 2)
+        failed++;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ytree_delete(tree, keys[order[i]]) != keys[order[i]])
+            failed++;
+    }
+    delete_ns = elapsed_ns(&start);
+    if (ytree_size(tree) != 0)
+        failed++;
+    ytree_destroy(tree);
+
+    printf("%-6s insert %6.1f ns, search %6.1f ns, iterate %5.1f ns, delete %6.1f ns%s\n",
+           name, insert_ns / num, search_ns / num, iter_ns / num, delete_ns / num,
+           failed ? " (failed)" : "");
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, num = 200000, failed = 0;
+    char **keys;
+    int *order;
+    if (argc >= 2)
+        num = atoi(argv[1]);
+    if (num <= 0)
+    {
+        fprintf(stderr, "usage: %s [KEY_NUM]\n", argv[0]);
+        return 1;
+    }
+    failed = check_btree(200000, 5000);
+    printf("check: B+tree and AVL tree %s\n", failed ? "differ" : "are the same");
+
+    keys = malloc(sizeof(char *) * num);
+    order = malloc(sizeof(int) * num);
+    for (i = 0; i < num; i++)
+    {
+        keys[i] = new_key(i);
+        order[i] = i;
+    }
+    // shuffle the insertion order.
+    srand(1);
+    for (i = num - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    failed += run("avl", 0, keys, order, num);
+    failed += run("btree", YTREE_BTREE, keys, order, num);
+    for (i = 0; i < num; i++)
+        free(keys[i]);
+    free(keys);
+    free(order);
+    return failed ? 1 : 0;
+}
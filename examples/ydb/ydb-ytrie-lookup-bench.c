@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ytrie.h"
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static int count_entry(void *addition, const void *key, int key_len, void *value)
+{
+    (*(int *)addition)++;
+    return 0;
+}
+
+// collect the values matched by ytrie_traverse_prefix_match.
+struct prefix_match
+{
+    void **values;
+    int num;
+};
+
+static int collect_entry(void *addition, const void *key, int key_len, void *value)
+{
+    struct prefix_match *match = addition;
+    match->values[match->num++] = value;
+    return 0;
+}
+
+// read the words of ytrie-input.txt style file.
+static int read_words(const char *file, char ***words)
+{
+    char buf[256];
+    int num = 0, size = 64;
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+        return 0;
+    *words = malloc(sizeof(char *) * size);
+    while (fgets(buf, sizeof(buf), fp))
+    {
+        buf[strcspn(buf, "\r\n")] = 0;
+        if (!buf[0])
+            continue;
+        if (num >= size)
+        {
+            size *= 2;
+            *words = realloc(*words, sizeof(char *) * size);
+        }
+        (*words)[num++] = strdup(buf);
+    }
+    fclose(fp);
+    return num;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, wnum, num = 200000, failed = 0, count = 0, repeat = 5, r;
+    char **words = NULL;
+    char **keys;
+    char query[512];
+    const char *file = "ytrie-input.txt";
+    double search_ns = 0, best_ns = 0, iter_ns = 0, match_ns = 0, range_ns = 0, cursor_ns = 0;
+    int range = 0, cursor = 0;
+    struct prefix_match match;
+    struct timespec start;
+    ytrie *trie;
+
+    if (argc >= 2)
+        file = argv[1];
+    if (argc >= 3)
+        num = atoi(argv[2]);
+    wnum = read_words(file, &words);
+    if (wnum <= 0 || num <= 0)
+    {
+        fprintf(stderr, "usage: %s [ytrie-input.txt] [KEY_NUM]\n", argv[0]);
+        return 1;
+    }
+
+    // make the path keys from the words.
+    keys = malloc(sizeof(char *) * num);
+    for (i = 0; i < num; i++)
+    {
+        snprintf(query, sizeof(query), "/%s/%s/%s[%d]",
+                 words[i % wnum], words[(i / wnum) % wnum], words[(i * 7) % wnum], i);
+        keys[i] = strdup(query);
+    }
+    match.values = malloc(sizeof(void *) * num);
+    trie = ytrie_create();
+    for (i = 0; i < num; i++)
+        ytrie_insert(trie, keys[i], strlen(keys[i]), keys[i]);
+
+    for (r = 0; r < repeat; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num; i++)
+        {
+            if (ytrie_search(trie, keys[i], strlen(keys[i])) != keys[i])
+                failed++;
+        }
+        search_ns += elapsed_ns(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num; i++)
+        {
+            int len = snprintf(query, sizeof(query), "%s/leaf", keys[i]);
+            int matched_len = 0;
+            if (ytrie_best_match(trie, query, len, &matched_len) != keys[i] ||
+                matched_len != (int)strlen(keys[i]))
+                failed++;
+        }
+        best_ns += elapsed_ns(&start);
+
+        count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ytrie_traverse(trie, count_entry, &count);
+        iter_ns += elapsed_ns(&start);
+        if (count != num)
+            failed++;
+
+        // the range search of the first path segments by the callback, by ylist and by the cursor.
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < wnum; i++)
+        {
+            int len = snprintf(query, sizeof(query), "/%s/", words[i]);
+            match.num = 0;
+            ytrie_traverse_prefix_match(trie, query, len, collect_entry, &match);
+        }
+        match_ns += elapsed_ns(&start);
+        range = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < wnum; i++)
+        {
+            int len = snprintf(query, sizeof(query), "/%s/", words[i]);
+            ylist *list = ytrie_search_range(trie, query, len);
+            range += ylist_size(list);
+            ylist_destroy(list);
+        }
+        range_ns += elapsed_ns(&start);
+        cursor = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < wnum; i++)
+        {
+            ytrie_iter iter;
+            void *value;
+            int len = snprintf(query, sizeof(query), "/%s/", words[i]);
+            value = ytrie_iter_prefix_begin(trie, &iter, query, len);
+            for (; value; value = ytrie_iter_prefix_next(trie, &iter))
+                cursor++;
+        }
+        cursor_ns += elapsed_ns(&start);
+        if (range != cursor)
+            failed++;
+    }
+
+    // the cursor must visit the same entries in the same order as the callback.
+    range = cursor = 0;
+    for (i = 0; i < wnum; i++)
+    {
+        ytrie_iter iter;
+        void *value;
+        int j = 0;
+        int len = snprintf(query, sizeof(query), "/%s/", words[i]);
+        match.num = 0;
+        ytrie_traverse_prefix_match(trie, query, len, collect_entry, &match);
+        value = ytrie_iter_prefix_begin(trie, &iter, query, len);
+        for (; value; value = ytrie_iter_prefix_next(trie, &iter), j++)
+        {
+            if (j >= match.num || match.values[j] != value)
+                break;
+        }
+        if (value || j != match.num)
+        {
+            printf("failed: the cursor of %s differs at %d of %d entries\n", query, j, match.num);
+            failed++;
+        }
+        range += match.num;
+        cursor += j;
+    }
+    printf("keys %d: search %.1f ns, best_match %.1f ns, traverse %.1f ns/key%s\n",
+           num, search_ns / repeat / num, best_ns / repeat / num, iter_ns / repeat / num,
+           failed ? " (failed)" : "");
+    range = range ? range : 1;
+    printf("prefixes %d (%d entries): traverse_prefix_match %.1f ns, "
+           "search_range %.1f ns, iter_prefix %.1f ns/entry\n",
+           wnum, cursor, match_ns / repeat / range, range_ns / repeat / range,
+           cursor_ns / repeat / range);
+
+    ytrie_destroy(trie);
+    free(match.values);
+    for (i = 0; i < num; i++)
+        free(keys[i]);
+    free(keys);
+    for (i = 0; i < wnum; i++)
+        free(words[i]);
+    free(words);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "ytrie.h"
+
+static const struct
+{
+    const char *name;
+    unsigned int opt;
+} options[] = {
+    {"default", 0},
+    {"pool", YTRIE_POOL},
+    {"pool+key-ref", YTRIE_POOL | YTRIE_KEY_REF},
+};
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static size_t heap_used(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+// insert, search, delete and reinsert all keys and check the values.
+static int run(const char *name, unsigned int opt, char **keys, int num)
+{
+    int i, failed = 0;
+    size_t heap;
+    double insert_ns, search_ns, delete_ns;
+    struct timespec start;
+    ytrie *trie;
+
+    heap = heap_used();
+    trie = ytrie_create_opt(opt);
+    if (!trie)
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ytrie_insert(trie, keys[i], strlen(keys[i]), keys[i]))
+            failed++;
+    }
+    insert_ns = elapsed_ns(&start);
+    heap = heap_used() - heap;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i++)
+    {
+        if (ytrie_search(trie, keys[i], strlen(keys[i])) != keys[i])
+            failed++;
+    }
+    search_ns = elapsed_ns(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num; i += 2)
+    {
+        if (ytrie_delete(trie, keys[i], strlen(keys[i])) != keys[i])
+            failed++;
+    }
+    delete_ns = elapsed_ns(&start);
+    for (i = 0; i < num; i++)
+    {
+        void *value = ytrie_search(trie, keys[i], strlen(keys[i]));
+        if (value != ((i % 2) ? keys[i] : NULL))
+            failed++;
+    }
+    for (i = 0; i < num; i += 2)
+    {
+        if (ytrie_insert(trie, keys[i], strlen(keys[i]), keys[i]))
+            failed++;
+    }
+    if (ytrie_size(trie) != (size_t)num)
+        failed++;
+    ytrie_destroy(trie);
+
+    printf("%-13s insert %6.1f ns, search %6.1f ns, delete %6.1f ns, heap %8zu bytes%s\n",
+           name, insert_ns / num, search_ns / num, delete_ns / ((num + 1) / 2),
+           heap, failed ? " (failed)" : "");
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, num = 200000, failed = 0;
+    char **keys;
+    if (argc >= 2)
+        num = atoi(argv[1]);
+    if (num <= 0)
+    {
+        fprintf(stderr, "usage: %s [KEY_NUM]\n", argv[0]);
+        return 1;
+    }
+    keys = malloc(sizeof(char *) * num);
+    for (i = 0; i < num; i++)
+    {
+        char buf[128];
+        // the short keys and the long keys exceeding the pooled leaf size.
+        if (i % 4)
+            snprintf(buf, sizeof(buf), "ge%d", i);
+        else
+            snprintf(buf, sizeof(buf), "/interfaces/interface[name=ge%d]/statistics/in-octets", i);
+        keys[i] = strdup(buf);
+    }
+    for (i = 0; i < (int)(sizeof(options) / sizeof(options[0])); i++)
+        failed += run(options[i].name, options[i].opt, keys, num);
+    for (i = 0; i < num; i++)
+        free(keys[i]);
+    free(keys);
+    return failed ? 1 : 0;
+}
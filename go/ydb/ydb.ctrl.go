@@ -47,7 +47,7 @@ static ydb_res ydb_read_hooker(ydb *datablock, char *path, FILE *stream, void *U
 
 static ydb_res ydb_read_hook_register(ydb *datablock, char *path, void *U1)
 {
-	return ydb_read_hook_add(datablock, path, (ydb_read_hook)ydb_read_hooker, 1, U1);
+	return ydb_read_hook_add(datablock, path, 0, (ydb_read_hook)ydb_read_hooker, 1, U1);
 }
 
 static void ydb_read_hook_unregister(ydb *datablock, char *path)
@@ -0,0 +1,23 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+run_bg "ydb -n Y -r pub -a uss://test -d -f ../examples/yaml/ydb-sample.yaml > $TESTNAME.PUB.log"
+run_bg "ydb -n Y -r sub -a uss://test --subscribe /2/2-1 -d -s > $TESTNAME.SUB.log"
+run_fg "ydb -n W -r sub -w -a uss://test --write /1/1-1/1-1-4=v13 --write /2/2-1/2-1-4=v14 --write /2/2-2/2-2-4=v15 --delete /2/2-1/2-1-1 --delete /1/1-2/1-2-1 > /dev/null"
+test_deinit
+
+r1=`grep -c "2-1-4: v14" $TESTNAME.SUB.log`
+r2=`grep -c "1-1-4: v13\|2-2-4: v15\|2-1-1: v7" $TESTNAME.SUB.log`
+r3=`grep -c "1-2-1: v4" $TESTNAME.SUB.log`
+if [ "x$r1" = "x1" ] && [ "x$r2" = "x0" ] && [ "x$r3" = "x1" ];then
+    echo "ok ($r1, $r2, $r3)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2, $r3)"
+    echo
+    cat $TESTNAME.SUB.log
+    echo
+    exitcode=1
+fi
+exit $exitcode
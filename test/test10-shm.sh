@@ -0,0 +1,22 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+run_bg "ydb -n Y -r pub -a shm://test -d -s > $TESTNAME.PUB.log"
+run_bg "ydb -n Y -r sub -a shm://test -d -s > $TESTNAME.SUB.log"
+run_fg "ydb -n W -r sub -w -u -a shm://test -f ../examples/yaml/netconf-sample3.yaml -f ../examples/yaml/ydb-sample.yaml > /dev/null"
+test_deinit
+
+RESULT=`diff -q $TESTNAME.PUB.log $TESTNAME.SUB.log`
+LINES=`cat $TESTNAME.SUB.log | wc -l`
+if [ "x$RESULT" = "x" ] && [ $LINES -gt 100 ];then
+    echo "ok"
+    exitcode=0
+else
+    echo "failed"
+    echo
+    diff $TESTNAME.PUB.log $TESTNAME.SUB.log
+    echo
+    exitcode=1
+fi
+exit $exitcode
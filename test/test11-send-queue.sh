@@ -0,0 +1,40 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+
+big_yaml()
+{
+    i=0
+    echo "big:"
+    while [ $i -lt 3000 ]; do
+        echo " k$i: value-$1-$i"
+        i=`expr $i + 1`
+    done
+}
+
+run_bg "ydb -n Y -r pub -a uss://test -d -s --send-queue-limit 100000 > $TESTNAME.PUB.log 2> /dev/null"
+run_bg "ydb -n Y -r sub -a uss://test -d -s > $TESTNAME.SUB1.log"
+SLOW_PID=$LAST_PID
+run_bg "ydb -n Y -r sub -a uss://test -d -s > $TESTNAME.SUB2.log"
+# SUB1 stops reading the published data.
+kill -STOP $SLOW_PID
+for v in 1 2 3 4 5; do
+    big_yaml $v > $TESTNAME.data.log
+    run_fg "ydb -n W -r sub -w -u -a uss://test -f $TESTNAME.data.log > /dev/null"
+done
+# SUB1 is dropped by the publisher and then resynchronized.
+kill -CONT $SLOW_PID
+sleep 5
+test_deinit
+
+r1=`grep -c "value-5" $TESTNAME.SUB1.log`
+r2=`grep -c "value-5" $TESTNAME.SUB2.log`
+if [ "$r1" = "3000" ] && [ "$r2" = "3000" ];then
+    echo "ok ($r1, $r2)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2)"
+    exitcode=1
+fi
+exit $exitcode
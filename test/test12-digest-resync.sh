@@ -0,0 +1,37 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+run_bg "ydb -n Y -r pub -a uss://test -d -f ../examples/yaml/ydb-sample.yaml > $TESTNAME.PUB1.log"
+PUB_PID=$LAST_PID
+run_bg "ydb -n Y -r sub -a uss://test -d -s > $TESTNAME.SUB.log"
+SUB_PID=$LAST_PID
+# The publisher restarts with a value changed and two subtrees removed.
+kill -2 $PUB_PID
+sleep 1
+BGLIST="$SUB_PID"
+cat > $TESTNAME.data.log << EOF_DATA
+1:
+  1-1: {1-1-1: v1, 1-1-2: v2, 1-1-3: v3}
+2:
+  2-1: {2-1-1: v7-changed, 2-1-2: v8, 2-1-3: v9}
+  2-2: {2-2-1: v10, 2-2-2: v11}
+EOF_DATA
+run_bg "ydb -n Y -r pub -a uss://test -d -f $TESTNAME.data.log -v info > $TESTNAME.PUB2.log"
+# The subscriber reconnects, receives only the changed subtree
+# and deletes the subtrees removed from the publisher.
+sleep 3
+test_deinit
+
+r1=`grep -c "2-1-1: v7-changed" $TESTNAME.SUB.log`
+r2=`grep -c "1 subtrees differ from the digests" $TESTNAME.PUB2.log`
+r3=`grep -c "2 subtrees removed from the digests" $TESTNAME.PUB2.log`
+r4=`grep -c "^ *1-2:\|2-2-3" $TESTNAME.SUB.log`
+if [ "$r1" = "1" ] && [ "$r2" = "1" ] && [ "$r3" = "1" ] && [ "$r4" = "0" ];then
+    echo "ok ($r1, $r2, $r3, $r4)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2, $r3, $r4)"
+    exitcode=1
+fi
+exit $exitcode
@@ -0,0 +1,27 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+rm -rf $TESTNAME.db && mkdir $TESTNAME.db
+run_bg "ydb -n P -r pub -a uss://test -d --persistent $TESTNAME.db -f ../examples/yaml/ydb-sample.yaml > $TESTNAME.PUB1.log"
+run_fg "ydb -r sub -w -u -a uss://test --write /2/2-1/2-1-1=v7-written > /dev/null"
+run_fg "ydb -n P -r sub -w -a uss://test --delete /1/1-2/1-2-3 > /dev/null"
+test_deinit
+
+# The publisher restarts and restores the data from the journal.
+BGLIST=""
+run_bg "ydb -n P -r pub -a uss://test -d --persistent $TESTNAME.db > $TESTNAME.PUB2.log"
+r1=`ydb -r sub --unsubscribe --sync-before-read -a uss://test --read /2/2-1/2-1-1`
+r2=`ydb -r sub --unsubscribe --sync-before-read -a uss://test --read /1/1-2/1-2-1`
+r3=`ydb -r sub --unsubscribe --sync-before-read -a uss://test --read /1/1-2/1-2-3`
+test_deinit
+rm -rf $TESTNAME.db
+
+if [ "value_$r1" = "value_v7-written" ] && [ "value_$r2" = "value_v4" ] && [ "value_$r3" = "value_" ];then
+    echo "ok ($r1, $r2, $r3)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2, $r3)"
+    exitcode=1
+fi
+exit $exitcode
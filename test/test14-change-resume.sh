@@ -0,0 +1,41 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+
+big_yaml()
+{
+    i=0
+    echo "big:"
+    while [ $i -lt 3000 ]; do
+        echo " k$i: value-$1-$i"
+        i=`expr $i + 1`
+    done
+}
+
+run_bg "ydb -n Y -r pub -a uss://test -d --send-queue-limit 100000 -v info > $TESTNAME.PUB.log 2> /dev/null"
+run_bg "ydb -n Y -r sub -a uss://test -d -s > $TESTNAME.SUB.log"
+SLOW_PID=$LAST_PID
+big_yaml 0 > $TESTNAME.data.log
+run_fg "ydb -n W -r sub -w -u -a uss://test -f $TESTNAME.data.log > /dev/null"
+# SUB stops reading the published data and then it is dropped by the publisher.
+kill -STOP $SLOW_PID
+for v in 1 2 3 4 5; do
+    big_yaml $v > $TESTNAME.data.log
+    run_fg "ydb -n W -r sub -w -u -a uss://test -f $TESTNAME.data.log > /dev/null"
+done
+# SUB reconnects and receives only the changes it missed.
+kill -CONT $SLOW_PID
+sleep 5
+test_deinit
+
+r1=`grep -c "value-5" $TESTNAME.SUB.log`
+r2=`grep -c "resume [0-9]* changes from the change" $TESTNAME.PUB.log`
+if [ "$r1" = "3000" ] && [ "$r2" = "1" ];then
+    echo "ok ($r1, $r2)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2)"
+    exitcode=1
+fi
+exit $exitcode
@@ -0,0 +1,26 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+# the filtered data of both subscribers have the same length (> shm threshold).
+VA=`printf 'a%.0s' $(seq 1 700)`
+VB=`printf 'b%.0s' $(seq 1 700)`
+printf "x:\n  a:\n    v: $VA\n  b:\n    v: $VB\n" > $TESTNAME.DATA.log
+run_bg "ydb -n Y -r pub -a shm://test -d > $TESTNAME.PUB.log"
+run_bg "ydb -n Y -r sub -a shm://test --subscribe /x/a -d -s > $TESTNAME.SUBA.log"
+run_bg "ydb -n Y -r sub -a shm://test --subscribe /x/b -d -s > $TESTNAME.SUBB.log"
+run_fg "ydb -n W -r sub -w -u -a shm://test -f $TESTNAME.DATA.log > /dev/null"
+test_deinit
+
+r1=`grep -c "v: $VA" $TESTNAME.SUBA.log`
+r2=`grep -c "v: $VB" $TESTNAME.SUBB.log`
+r3=`grep -c "v: $VB" $TESTNAME.SUBA.log`
+r4=`grep -c "v: $VA" $TESTNAME.SUBB.log`
+if [ "x$r1" = "x1" ] && [ "x$r2" = "x1" ] && [ "x$r3" = "x0" ] && [ "x$r4" = "x0" ];then
+    echo "ok ($r1, $r2, $r3, $r4)"
+    exitcode=0
+else
+    echo "failed ($r1, $r2, $r3, $r4)"
+    exitcode=1
+fi
+exit $exitcode
@@ -0,0 +1,28 @@
+#!/bin/sh
+. ./util.sh
+test_init $0 $1
+echo -n "TEST: $TESTNAME : "
+# 20 writes of ~280KB wrap the shm ring (4MB) several times.
+for N in 0 1; do
+    echo "big:" > $TESTNAME.DATA$N.log
+    for K in `seq 1 4000`; do
+        echo "  k$K: xvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxvxv$N"
+    done >> $TESTNAME.DATA$N.log
+done
+run_bg "ydb -n Y -r pub -a shm://test -d -s > $TESTNAME.PUB.log"
+run_bg "ydb -n Y -r sub -a shm://test -d -s > $TESTNAME.SUB.log"
+for I in `seq 1 10`; do
+    run_fg "ydb -n W -r sub -w -u -a shm://test -f $TESTNAME.DATA0.log -f $TESTNAME.DATA1.log > /dev/null"
+done
+test_deinit
+
+RESULT=`diff -q $TESTNAME.PUB.log $TESTNAME.SUB.log`
+r1=`grep -c "k4000: .*1$" $TESTNAME.SUB.log`
+if [ "x$RESULT" = "x" ] && [ "x$r1" = "x1" ];then
+    echo "ok"
+    exitcode=0
+else
+    echo "failed"
+    exitcode=1
+fi
+exit $exitcode
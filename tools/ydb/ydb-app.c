@@ -74,6 +74,7 @@ void usage(char *argv_0)
                                         (unix socket hidden from file system)\n\
                                         tcp://IPADDR:PORT (TCP)\n\
                                         file://FILEPATH (file)\n\
+                                        shm://NAME (shared memory)\n\
   -s, --summary                    Print all data at the termination.\n\
   -c, --change-log                 print all change.\n\
   -f, --file FILE                  Read YAML file to update YDB.\n\
@@ -93,6 +94,9 @@ void usage(char *argv_0)
     , --write PATH/TO/DATA=DATA    Write data to YDB.\n\
     , --delete PATH/TO/DATA=DATA   Delete data from YDB.\n\
     , --sync PATH/TO/DATA=DATA     Send sync request to update data.\n\
+    , --subscribe PATH/TO/DATA     Subscribe only the data change under the path.\n\
+    , --send-queue-limit BYTES     Drop the subscriber not reading over BYTES queued.\n\
+    , --persistent DIR             Restore and journal the YDB data in DIR.\n\
   -h, --help                       Display help and exit\n\n\
   e.g.\n\
     ydb -n mydata -r pub -a uss://mydata -d -f example/yaml/yaml-demo.yaml &\n\
@@ -480,6 +484,9 @@ int main(int argc, char *argv[])
             {"write", required_argument, 0, 0},
             {"delete", required_argument, 0, 0},
             {"sync", required_argument, 0, 0},
+            {"subscribe", required_argument, 0, 0},
+            {"send-queue-limit", required_argument, 0, 0},
+            {"persistent", required_argument, 0, 0},
             // diagnositics
             {"no-rx", no_argument, 0, 0},
             {"no-tx", no_argument, 0, 0},
@@ -512,6 +519,24 @@ int main(int argc, char *argv[])
                           long_options[index].name,
                           optarg);
             }
+            else if (strcmp(long_options[index].name, "subscribe") == 0)
+            {
+                ydb_write(config,
+                          "config:\n"
+                          " subscribe:\n"
+                          "  - '%s'\n",
+                          optarg);
+            }
+            else if (strcmp(long_options[index].name, "send-queue-limit") == 0)
+            {
+                ydb_write(config, "config: {send-queue-limit: %s}", optarg);
+            }
+            else if (strcmp(long_options[index].name, "persistent") == 0)
+            {
+                char *yamloptstr = str2yaml(optarg);
+                ydb_write(config, "config: {persistent: %s}", yamloptstr);
+                free(yamloptstr);
+            }
             else if (strcmp(long_options[index].name, "record-to") == 0)
             {
                 char *yamloptstr = str2yaml(optarg);
@@ -680,7 +705,11 @@ int main(int argc, char *argv[])
         if (verbose)
             ylog_level = verbose;
 
-        datablock = ydb_open((char *)ydb_path_read(config, "/config/name"));
+        const char *persistent = ydb_path_read(config, "/config/persistent");
+        if (persistent)
+            datablock = ydb_open_persistent((char *)ydb_path_read(config, "/config/name"), (char *)persistent);
+        else
+            datablock = ydb_open((char *)ydb_path_read(config, "/config/name"));
         if (!datablock)
         {
             fprintf(stderr, "ydb error: %s\n", "ydb failed");
@@ -743,6 +772,9 @@ int main(int argc, char *argv[])
         {
             ynode *n;
             // ydb_connection_log(1);
+            const char *ql = ydb_path_read(config, "/config/send-queue-limit");
+            if (ql)
+                ydb_send_queue_limit(datablock, strtoul(ql, NULL, 0));
             n = ydb_search(config, "/config/connection");
             for (n = ydb_down(n); n; n = ydb_next(n))
             {
@@ -758,6 +790,19 @@ int main(int argc, char *argv[])
                     fprintf(stderr, "ydb error: %s\n", ydb_res_str(res));
                     goto end;
                 }
+                if (!ydb_empty(ydb_search(config, "/config/subscribe")))
+                {
+                    ynode *s = ydb_search(config, "/config/subscribe");
+                    for (s = ydb_down(s); s; s = ydb_next(s))
+                    {
+                        res = ydb_subscribe(datablock, (char *)a, (char *)ydb_value(s));
+                        if (res)
+                        {
+                            fprintf(stderr, "ydb error: %s\n", ydb_res_str(res));
+                            goto end;
+                        }
+                    }
+                }
             }
         }
 
@@ -8,12 +8,18 @@
 #include <assert.h>
 #include "art.h"
 
-#ifdef __i386__
-    #include <emmintrin.h>
-#else
-#ifdef __amd64__
+/**
+ * The NODE16 keys are compared by SSE2 if the target supports it
+ * (x86-64 and i386 built with -msse2), otherwise by the scalar loop.
+ */
+#ifdef __SSE2__
     #include <emmintrin.h>
 #endif
+
+#ifdef __GNUC__
+    #define PREFETCH(x) __builtin_prefetch((const void*)((uintptr_t)(x) & ~1))
+#else
+    #define PREFETCH(x) ((void)(x))
 #endif
 
 /**
@@ -23,44 +29,158 @@
 #define SET_LEAF(x) ((void*)((uintptr_t)x | 1))
 #define LEAF_RAW(x) ((art_leaf*)((void*)((uintptr_t)x & ~1)))
 
+/**
+ * The pool of the nodes and leaves (ART_POOL).
+ * The objects are carved from the chunks of POOL_CHUNK_SIZE bytes and
+ * kept in the free list of the class when freed.
+ * The classes are NODE4 - NODE256 and the leaves having the key of
+ * up to POOL_LEAF_KEY_MAX bytes by POOL_LEAF_KEY_STEP.
+ */
+#define POOL_CHUNK_SIZE    16384
+#define POOL_LEAF_KEY_STEP 16
+#define POOL_LEAF_KEY_MAX  64
+#define POOL_LEAF_CLASS    (NODE256 + 1)
+#define POOL_CLASS_NUM     (POOL_LEAF_CLASS + POOL_LEAF_KEY_MAX / POOL_LEAF_KEY_STEP + 1)
+
+struct pool_chunk {
+    struct pool_chunk *next;
+    size_t used;
+    size_t size;
+};
+
+struct art_pool {
+    void *free[POOL_CLASS_NUM];
+    struct pool_chunk *chunk;
+};
+
+static const size_t node_size[] = {
+    0,
+    sizeof(art_node4),
+    sizeof(art_node16),
+    sizeof(art_node48),
+    sizeof(art_node256),
+};
+
+static size_t pool_class_size(int cls) {
+    if (cls < POOL_LEAF_CLASS)
+        return node_size[cls];
+    return sizeof(art_leaf) + (cls - POOL_LEAF_CLASS) * POOL_LEAF_KEY_STEP;
+}
+
+static void* pool_alloc(struct art_pool *pool, int cls) {
+    void *obj = pool->free[cls];
+    size_t size = pool_class_size(cls);
+    if (obj) {
+        pool->free[cls] = *(void **)obj;
+        memset(obj, 0, size);
+        return obj;
+    }
+    // keep the objects aligned to the pointer.
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!pool->chunk || pool->chunk->used + size > pool->chunk->size) {
+        struct pool_chunk *chunk;
+        size_t chunk_size = POOL_CHUNK_SIZE;
+        if (chunk_size < sizeof(struct pool_chunk) + size)
+            chunk_size = sizeof(struct pool_chunk) + size;
+        chunk = malloc(chunk_size);
+        if (!chunk)
+            return NULL;
+        chunk->next = pool->chunk;
+        chunk->used = sizeof(struct pool_chunk);
+        chunk->size = chunk_size;
+        pool->chunk = chunk;
+    }
+    obj = (char *)pool->chunk + pool->chunk->used;
+    pool->chunk->used += size;
+    memset(obj, 0, size);
+    return obj;
+}
+
+static void pool_free(struct art_pool *pool, int cls, void *obj) {
+    *(void **)obj = pool->free[cls];
+    pool->free[cls] = obj;
+}
+
+static void pool_destroy(struct art_pool *pool) {
+    struct pool_chunk *chunk = pool->chunk;
+    while (chunk) {
+        struct pool_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(pool);
+}
+
 /**
  * Allocates a node of the given type,
  * initializes to zero and sets the type.
  */
-static art_node* alloc_node(uint8_t type) {
+static art_node* alloc_node(art_tree *t, uint8_t type) {
     art_node* n;
-    switch (type) {
-        case NODE4:
-            n = (art_node*)calloc(1, sizeof(art_node4));
-            break;
-        case NODE16:
-            n = (art_node*)calloc(1, sizeof(art_node16));
-            break;
-        case NODE48:
-            n = (art_node*)calloc(1, sizeof(art_node48));
-            break;
-        case NODE256:
-            n = (art_node*)calloc(1, sizeof(art_node256));
-            break;
-        default:
-            abort();
-    }
+    if (type < NODE4 || type > NODE256)
+        abort();
+    if (t->pool)
+        n = (art_node*)pool_alloc(t->pool, type);
+    else
+        n = (art_node*)calloc(1, node_size[type]);
     n->type = type;
     return n;
 }
 
+static void free_node(art_tree *t, art_node *n) {
+    if (t->pool)
+        pool_free(t->pool, n->type, n);
+    else
+        free(n);
+}
+
+// The pool class of the leaf or -1 if it is not pooled.
+static int leaf_class(art_tree *t, int key_len) {
+    if (!t->pool)
+        return -1;
+    if (t->options & ART_KEY_REF)
+        return POOL_LEAF_CLASS;
+    // including the trailing zero
+    if (key_len + 1 > POOL_LEAF_KEY_MAX)
+        return -1;
+    return POOL_LEAF_CLASS + (key_len + POOL_LEAF_KEY_STEP) / POOL_LEAF_KEY_STEP;
+}
+
+static void free_leaf(art_tree *t, art_leaf *l) {
+    int cls = leaf_class(t, l->key_len);
+    if (cls < 0)
+        free(l);
+    else
+        pool_free(t->pool, cls, l);
+}
+
 /**
  * Initializes an ART tree
  * @return 0 on success.
  */
 int art_tree_init(art_tree *t) {
+    return art_tree_init_opt(t, 0);
+}
+
+/**
+ * Initializes an ART tree with the options (ART_POOL, ART_KEY_REF)
+ * @return 0 on success.
+ */
+int art_tree_init_opt(art_tree *t, int options) {
     t->root = NULL;
     t->size = 0;
+    t->options = options;
+    t->pool = NULL;
+    if (options & ART_POOL) {
+        t->pool = calloc(1, sizeof(struct art_pool));
+        if (!t->pool)
+            return -1;
+    }
     return 0;
 }
 
 // Recursively destroys the tree
-static void destroy_node(art_node *n, void (*data_free)(void *)) {
+static void destroy_node(art_tree *t, art_node *n, void (*data_free)(void *)) {
     // Break if null
     if (!n) return;
 
@@ -69,7 +189,8 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
         art_leaf *l = LEAF_RAW(n);
         if(data_free)
             data_free(l->value);
-        free(LEAF_RAW(n));
+        if (leaf_class(t, l->key_len) < 0)
+            free(l);
         return;
     }
 
@@ -85,14 +206,14 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
         case NODE4:
             p.p1 = (art_node4*)n;
             for (i=0;i<n->num_children;i++) {
-                destroy_node(p.p1->children[i], data_free);
+                destroy_node(t, p.p1->children[i], data_free);
             }
             break;
 
         case NODE16:
             p.p2 = (art_node16*)n;
             for (i=0;i<n->num_children;i++) {
-                destroy_node(p.p2->children[i], data_free);
+                destroy_node(t, p.p2->children[i], data_free);
             }
             break;
 
@@ -101,7 +222,7 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
             for (i=0;i<256;i++) {
                 idx = ((art_node48*)n)->keys[i]; 
                 if (!idx) continue; 
-                destroy_node(p.p3->children[idx-1], data_free);
+                destroy_node(t, p.p3->children[idx-1], data_free);
             }
             break;
 
@@ -109,7 +230,7 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
             p.p4 = (art_node256*)n;
             for (i=0;i<256;i++) {
                 if (p.p4->children[i])
-                    destroy_node(p.p4->children[i], data_free);
+                    destroy_node(t, p.p4->children[i], data_free);
             }
             break;
 
@@ -117,8 +238,9 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
             abort();
     }
 
-    // Free ourself on the way up
-    free(n);
+    // Free ourself on the way up (the pool is freed at once.)
+    if (!t->pool)
+        free(n);
 }
 
 /**
@@ -126,12 +248,17 @@ static void destroy_node(art_node *n, void (*data_free)(void *)) {
  * @return 0 on success.
  */
 int art_tree_destroy(art_tree *t) {
-    destroy_node(t->root, NULL);
-    return 0;
+    return art_tree_destroy_custom(t, NULL);
 }
 
 int art_tree_destroy_custom(art_tree *t, void (*data_free)(void *)) {
-    destroy_node(t->root, data_free);
+    // the pooled objects are freed with the pool.
+    if (!t->pool || data_free || !(t->options & ART_KEY_REF))
+        destroy_node(t, t->root, data_free);
+    if (t->pool)
+        pool_destroy(t->pool);
+    t->root = NULL;
+    t->pool = NULL;
     return 0;
 }
  
@@ -144,8 +271,69 @@ int art_tree_destroy_custom(art_tree *t, void (*data_free)(void *)) {
 extern inline uint64_t art_size(art_tree *t);
 #endif
 
+/**
+ * Returns the bitmask of the NODE16 keys equal to c.
+ */
+static inline unsigned node16_eq_mask(const unsigned char *keys, unsigned char c) {
+#ifdef __SSE2__
+    __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(c),
+            _mm_loadu_si128((const __m128i*)keys));
+    return _mm_movemask_epi8(cmp);
+#else
+    unsigned bitfield = 0;
+    for (int i = 0; i < 16; ++i) {
+        if (keys[i] == c)
+            bitfield |= (1 << i);
+    }
+    return bitfield;
+#endif
+}
+
+/**
+ * Returns the bitmask of the NODE16 keys greater than c.
+ * The keys are compared as unsigned bytes.
+ */
+static inline unsigned node16_gt_mask(const unsigned char *keys, unsigned char c) {
+#ifdef __SSE2__
+    // flip the sign bits for the unsigned comparison by the signed compare.
+    const __m128i sign = _mm_set1_epi8((char)0x80);
+    __m128i cmp = _mm_cmplt_epi8(_mm_xor_si128(_mm_set1_epi8(c), sign),
+            _mm_xor_si128(_mm_loadu_si128((const __m128i*)keys), sign));
+    return _mm_movemask_epi8(cmp);
+#else
+    unsigned bitfield = 0;
+    for (int i = 0; i < 16; ++i) {
+        if (c < keys[i])
+            bitfield |= (1 << i);
+    }
+    return bitfield;
+#endif
+}
+
+/**
+ * Returns the index of the first different byte of a and b in len bytes.
+ */
+static inline int mismatch(const unsigned char *a, const unsigned char *b, int len) {
+    int idx = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; idx + 8 <= len; idx += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + idx, 8);
+        memcpy(&y, b + idx, 8);
+        if (x != y)
+            return idx + (__builtin_ctzll(x ^ y) >> 3);
+    }
+#endif
+    for (; idx < len; idx++) {
+        if (a[idx] != b[idx])
+            break;
+    }
+    return idx;
+}
+
 static art_node** find_child(art_node *n, unsigned char c) {
-    int i, mask, bitfield;
+    int i;
+    unsigned bitfield;
     union {
         art_node4 *p1;
         art_node16 *p2;
@@ -168,39 +356,9 @@ static art_node** find_child(art_node *n, unsigned char c) {
         case NODE16:
             p.p2 = (art_node16*)n;
 
-            // support non-86 architectures
-            #ifdef __i386__
-                // Compare the key to all 16 stored keys
-                __m128i cmp;
-                cmp = _mm_cmpeq_epi8(_mm_set1_epi8(c),
-                        _mm_loadu_si128((__m128i*)p.p2->keys));
-                
-                // Use a mask to ignore children that don't exist
-                mask = (1 << n->num_children) - 1;
-                bitfield = _mm_movemask_epi8(cmp) & mask;
-            #else
-            #ifdef __amd64__
-                // Compare the key to all 16 stored keys
-                __m128i cmp;
-                cmp = _mm_cmpeq_epi8(_mm_set1_epi8(c),
-                        _mm_loadu_si128((__m128i*)p.p2->keys));
-
-                // Use a mask to ignore children that don't exist
-                mask = (1 << n->num_children) - 1;
-                bitfield = _mm_movemask_epi8(cmp) & mask;
-            #else
-                // Compare the key to all 16 stored keys
-                bitfield = 0;
-                for (i = 0; i < 16; ++i) {
-                    if (p.p2->keys[i] == c)
-                        bitfield |= (1 << i);
-                }
-
-                // Use a mask to ignore children that don't exist
-                mask = (1 << n->num_children) - 1;
-                bitfield &= mask;
-            #endif
-            #endif
+            // Compare the key to all 16 stored keys and
+            // use a mask to ignore children that don't exist
+            bitfield = node16_eq_mask(p.p2->keys, c) & ((1 << n->num_children) - 1);
 
             /*
              * If we have a match (any bit set) then we can
@@ -242,12 +400,7 @@ static inline int min(int a, int b) {
  */
 static int check_prefix(const art_node *n, const unsigned char *key, int key_len, int depth) {
     int max_cmp = min(min(n->partial_len, MAX_PREFIX_LEN), key_len - depth);
-    int idx;
-    for (idx=0; idx < max_cmp; idx++) {
-        if (n->partial[idx] != key[depth+idx])
-            return idx;
-    }
-    return idx;
+    return mismatch(n->partial, key + depth, max_cmp);
 }
 
 /**
@@ -397,7 +550,8 @@ void* art_best_match(const art_tree *t, const unsigned char *key, int key_len, i
     art_node **child;
     art_node *n = t->root;
     int prefix_len, depth = 0;
-    art_leaf *best = NULL;
+    art_node *best_node = NULL;
+    art_leaf *best;
     int best_depth = 0;
     // printf("search key=%s key_len=%d\n", key, key_len);
     while (n) {
@@ -421,7 +575,8 @@ void* art_best_match(const art_tree *t, const unsigned char *key, int key_len, i
         }
 
         // Recursively search
-        best = minimum(n);
+        // (the minimum leaf of the deepest matched node is found at done.)
+        best_node = n;
         best_depth = depth;
         // [neoul@ymail.com] input 0 to find_child if key_len is over for exact matching
         child = find_child(n, (depth < key_len)?key[depth]:0x0);
@@ -429,6 +584,7 @@ void* art_best_match(const art_tree *t, const unsigned char *key, int key_len, i
         depth++;
     }
 done:
+    best = minimum(best_node);
     if (best)
     {
         // printf("best->key=%s, key_len=%d, best_depth=%d\n", best->key, best->key_len, best_depth);
@@ -440,23 +596,31 @@ done:
     return NULL;
 }
 
-static art_leaf* make_leaf(const unsigned char *key, int key_len, void *value) {
-    art_leaf *l = (art_leaf*)calloc(1, sizeof(art_leaf)+key_len+1); // [neoul@ymail.com] fixed search failure
+static art_leaf* make_leaf(art_tree *t, const unsigned char *key, int key_len, void *value) {
+    art_leaf *l;
+    int cls = leaf_class(t, key_len);
+    if (t->options & ART_KEY_REF) {
+        l = (cls < 0) ? (art_leaf*)calloc(1, sizeof(art_leaf)) : (art_leaf*)pool_alloc(t->pool, cls);
+        l->value = value;
+        l->key_len = key_len;
+        l->key = key;
+        return l;
+    }
+    if (cls < 0)
+        l = (art_leaf*)calloc(1, sizeof(art_leaf)+key_len+1); // [neoul@ymail.com] fixed search failure
+    else
+        l = (art_leaf*)pool_alloc(t->pool, cls);
     l->value = value;
     l->key_len = key_len;
-    memcpy(l->key, key, key_len);
-    l->key[key_len]=0; // [neoul@ymail.com] fixed search failure caused by out of range comparison.
+    memcpy(l->key_data, key, key_len);
+    l->key_data[key_len]=0; // [neoul@ymail.com] fixed search failure caused by out of range comparison.
+    l->key = l->key_data;
     return l;
 }
 
 static int longest_common_prefix(art_leaf *l1, art_leaf *l2, int depth) {
     int max_cmp = min(l1->key_len, l2->key_len) - depth;
-    int idx;
-    for (idx=0; idx < max_cmp; idx++) {
-        if (l1->key[depth+idx] != l2->key[depth+idx])
-            return idx;
-    }
-    return idx;
+    return mismatch(l1->key + depth, l2->key + depth, max_cmp);
 }
 
 static void copy_header(art_node *dest, art_node *src) {
@@ -465,13 +629,13 @@ static void copy_header(art_node *dest, art_node *src) {
     memcpy(dest->partial, src->partial, min(MAX_PREFIX_LEN, src->partial_len));
 }
 
-static void add_child256(art_node256 *n, art_node **ref, unsigned char c, void *child) {
+static void add_child256(art_tree *t, art_node256 *n, art_node **ref, unsigned char c, void *child) {
     (void)ref;
     n->n.num_children++;
     n->children[c] = (art_node*)child;
 }
 
-static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *child) {
+static void add_child48(art_tree *t, art_node48 *n, art_node **ref, unsigned char c, void *child) {
     if (n->n.num_children < 48) {
         int pos = 0;
         while (n->children[pos]) pos++;
@@ -479,7 +643,7 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         n->keys[c] = pos + 1;
         n->n.num_children++;
     } else {
-        art_node256 *new_node = (art_node256*)alloc_node(NODE256);
+        art_node256 *new_node = (art_node256*)alloc_node(t, NODE256);
         for (int i=0;i<256;i++) {
             if (n->keys[i]) {
                 new_node->children[i] = n->children[n->keys[i] - 1];
@@ -487,47 +651,18 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_node, (art_node*)n);
         *ref = (art_node*)new_node;
-        free(n);
-        add_child256(new_node, ref, c, child);
+        free_node(t, (art_node*)n);
+        add_child256(t, new_node, ref, c, child);
     }
 }
 
-static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *child) {
+static void add_child16(art_tree *t, art_node16 *n, art_node **ref, unsigned char c, void *child) {
     if (n->n.num_children < 16) {
         unsigned mask = (1 << n->n.num_children) - 1;
         
-        // support non-x86 architectures
-        #ifdef __i386__
-            __m128i cmp;
-
-            // Compare the key to all 16 stored keys
-            cmp = _mm_cmplt_epi8(_mm_set1_epi8(c),
-                    _mm_loadu_si128((__m128i*)n->keys));
-
-            // Use a mask to ignore children that don't exist
-            unsigned bitfield = _mm_movemask_epi8(cmp) & mask;
-        #else
-        #ifdef __amd64__
-            __m128i cmp;
-
-            // Compare the key to all 16 stored keys
-            cmp = _mm_cmplt_epi8(_mm_set1_epi8(c),
-                    _mm_loadu_si128((__m128i*)n->keys));
-
-            // Use a mask to ignore children that don't exist
-            unsigned bitfield = _mm_movemask_epi8(cmp) & mask;
-        #else
-            // Compare the key to all 16 stored keys
-            unsigned bitfield = 0;
-            for (short i = 0; i < 16; ++i) {
-                if (c < n->keys[i])
-                    bitfield |= (1 << i);
-            }
-
-            // Use a mask to ignore children that don't exist
-            bitfield &= mask;    
-        #endif
-        #endif
+        // Compare the key to all 16 stored keys and
+        // use a mask to ignore children that don't exist
+        unsigned bitfield = node16_gt_mask(n->keys, c) & mask;
 
         // Check if less than any
         unsigned idx;
@@ -545,7 +680,7 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
         n->n.num_children++;
 
     } else {
-        art_node48 *new_node = (art_node48*)alloc_node(NODE48);
+        art_node48 *new_node = (art_node48*)alloc_node(t, NODE48);
 
         // Copy the child pointers and populate the key map
         memcpy(new_node->children, n->children,
@@ -555,12 +690,12 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_node, (art_node*)n);
         *ref = (art_node*)new_node;
-        free(n);
-        add_child48(new_node, ref, c, child);
+        free_node(t, (art_node*)n);
+        add_child48(t, new_node, ref, c, child);
     }
 }
 
-static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *child) {
+static void add_child4(art_tree *t, art_node4 *n, art_node **ref, unsigned char c, void *child) {
     if (n->n.num_children < 4) {
         int idx;
         for (idx=0; idx < n->n.num_children; idx++) {
@@ -578,7 +713,7 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
         n->n.num_children++;
 
     } else {
-        art_node16 *new_node = (art_node16*)alloc_node(NODE16);
+        art_node16 *new_node = (art_node16*)alloc_node(t, NODE16);
 
         // Copy the child pointers and the key map
         memcpy(new_node->children, n->children,
@@ -587,21 +722,21 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
                 sizeof(unsigned char)*n->n.num_children);
         copy_header((art_node*)new_node, (art_node*)n);
         *ref = (art_node*)new_node;
-        free(n);
-        add_child16(new_node, ref, c, child);
+        free_node(t, (art_node*)n);
+        add_child16(t, new_node, ref, c, child);
     }
 }
 
-static void add_child(art_node *n, art_node **ref, unsigned char c, void *child) {
+static void add_child(art_tree *t, art_node *n, art_node **ref, unsigned char c, void *child) {
     switch (n->type) {
         case NODE4:
-            return add_child4((art_node4*)n, ref, c, child);
+            return add_child4(t, (art_node4*)n, ref, c, child);
         case NODE16:
-            return add_child16((art_node16*)n, ref, c, child);
+            return add_child16(t, (art_node16*)n, ref, c, child);
         case NODE48:
-            return add_child48((art_node48*)n, ref, c, child);
+            return add_child48(t, (art_node48*)n, ref, c, child);
         case NODE256:
-            return add_child256((art_node256*)n, ref, c, child);
+            return add_child256(t, (art_node256*)n, ref, c, child);
         default:
             abort();
     }
@@ -612,29 +747,25 @@ static void add_child(art_node *n, art_node **ref, unsigned char c, void *child)
  */
 static int prefix_mismatch(const art_node *n, const unsigned char *key, int key_len, int depth) {
     int max_cmp = min(min(MAX_PREFIX_LEN, n->partial_len), key_len - depth);
-    int idx;
-    for (idx=0; idx < max_cmp; idx++) {
-        if (n->partial[idx] != key[depth+idx])
-            return idx;
-    }
+    int idx = mismatch(n->partial, key + depth, max_cmp);
+    if (idx < max_cmp)
+        return idx;
 
     // If the prefix is short we can avoid finding a leaf
     if (n->partial_len > MAX_PREFIX_LEN) {
         // Prefix is longer than what we've checked, find a leaf
         art_leaf *l = minimum(n);
         max_cmp = min(l->key_len, key_len)- depth;
-        for (; idx < max_cmp; idx++) {
-            if (l->key[idx+depth] != key[depth+idx])
-                return idx;
-        }
+        if (idx < max_cmp)
+            idx += mismatch(l->key + depth + idx, key + depth + idx, max_cmp - idx);
     }
     return idx;
 }
 
-static void* recursive_insert(art_node *n, art_node **ref, const unsigned char *key, int key_len, void *value, int depth, int *old) {
+static void* recursive_insert(art_tree *t, art_node *n, art_node **ref, const unsigned char *key, int key_len, void *value, int depth, int *old) {
     // If we are at a NULL node, inject a leaf
     if (!n) {
-        *ref = (art_node*)SET_LEAF(make_leaf(key, key_len, value));
+        *ref = (art_node*)SET_LEAF(make_leaf(t, key, key_len, value));
         return NULL;
     }
 
@@ -651,10 +782,10 @@ static void* recursive_insert(art_node *n, art_node **ref, const unsigned char *
         }
 
         // New value, we must split the leaf into a node4
-        art_node4 *new_node = (art_node4*)alloc_node(NODE4);
+        art_node4 *new_node = (art_node4*)alloc_node(t, NODE4);
 
         // Create a new leaf
-        art_leaf *l2 = make_leaf(key, key_len, value);
+        art_leaf *l2 = make_leaf(t, key, key_len, value);
 
         // Determine longest prefix
         int longest_prefix = longest_common_prefix(l, l2, depth);
@@ -662,8 +793,8 @@ static void* recursive_insert(art_node *n, art_node **ref, const unsigned char *
         memcpy(new_node->n.partial, key+depth, min(MAX_PREFIX_LEN, longest_prefix));
         // Add the leafs to the new node4
         *ref = (art_node*)new_node;
-        add_child4(new_node, ref, l->key[depth+longest_prefix], SET_LEAF(l));
-        add_child4(new_node, ref, l2->key[depth+longest_prefix], SET_LEAF(l2));
+        add_child4(t, new_node, ref, l->key[depth+longest_prefix], SET_LEAF(l));
+        add_child4(t, new_node, ref, l2->key[depth+longest_prefix], SET_LEAF(l2));
         return NULL;
     }
 
@@ -677,28 +808,28 @@ static void* recursive_insert(art_node *n, art_node **ref, const unsigned char *
         }
 
         // Create a new node
-        art_node4 *new_node = (art_node4*)alloc_node(NODE4);
+        art_node4 *new_node = (art_node4*)alloc_node(t, NODE4);
         *ref = (art_node*)new_node;
         new_node->n.partial_len = prefix_diff;
         memcpy(new_node->n.partial, n->partial, min(MAX_PREFIX_LEN, prefix_diff));
 
         // Adjust the prefix of the old node
         if (n->partial_len <= MAX_PREFIX_LEN) {
-            add_child4(new_node, ref, n->partial[prefix_diff], n);
+            add_child4(t, new_node, ref, n->partial[prefix_diff], n);
             n->partial_len -= (prefix_diff+1);
             memmove(n->partial, n->partial+prefix_diff+1,
                     min(MAX_PREFIX_LEN, n->partial_len));
         } else {
             n->partial_len -= (prefix_diff+1);
             art_leaf *l = minimum(n);
-            add_child4(new_node, ref, l->key[depth+prefix_diff], n);
+            add_child4(t, new_node, ref, l->key[depth+prefix_diff], n);
             memcpy(n->partial, l->key+depth+prefix_diff+1,
                     min(MAX_PREFIX_LEN, n->partial_len));
         }
 
         // Insert the new leaf
-        art_leaf *l = make_leaf(key, key_len, value);
-        add_child4(new_node, ref, key[depth+prefix_diff], SET_LEAF(l));
+        art_leaf *l = make_leaf(t, key, key_len, value);
+        add_child4(t, new_node, ref, key[depth+prefix_diff], SET_LEAF(l));
         return NULL;
     }
 
@@ -708,12 +839,12 @@ RECURSE_SEARCH:;
     // [neoul@ymail.com] input 0 to find_child if key_len is over for exact matching
     art_node **child = find_child(n, (depth < key_len)?key[depth]:0x0);
     if (child) {
-        return recursive_insert(*child, child, key, key_len, value, depth+1, old);
+        return recursive_insert(t, *child, child, key, key_len, value, depth+1, old);
     }
 
     // No child, node goes within us
-    art_leaf *l = make_leaf(key, key_len, value);
-    add_child(n, ref, key[depth], SET_LEAF(l));
+    art_leaf *l = make_leaf(t, key, key_len, value);
+    add_child(t, n, ref, key[depth], SET_LEAF(l));
     return NULL;
 }
 
@@ -728,19 +859,19 @@ RECURSE_SEARCH:;
  */
 void* art_insert(art_tree *t, const unsigned char *key, int key_len, void *value) {
     int old_val = 0;
-    void *old = recursive_insert(t->root, &t->root, key, key_len, value, 0, &old_val);
+    void *old = recursive_insert(t, t->root, &t->root, key, key_len, value, 0, &old_val);
     if (!old_val) t->size++;
     return old;
 }
 
-static void remove_child256(art_node256 *n, art_node **ref, unsigned char c) {
+static void remove_child256(art_tree *t, art_node256 *n, art_node **ref, unsigned char c) {
     n->children[c] = NULL;
     n->n.num_children--;
 
     // Resize to a node48 on underflow, not immediately to prevent
     // trashing if we sit on the 48/49 boundary
     if (n->n.num_children == 37) {
-        art_node48 *new_node = (art_node48*)alloc_node(NODE48);
+        art_node48 *new_node = (art_node48*)alloc_node(t, NODE48);
         *ref = (art_node*)new_node;
         copy_header((art_node*)new_node, (art_node*)n);
 
@@ -752,18 +883,18 @@ static void remove_child256(art_node256 *n, art_node **ref, unsigned char c) {
                 pos++;
             }
         }
-        free(n);
+        free_node(t, (art_node*)n);
     }
 }
 
-static void remove_child48(art_node48 *n, art_node **ref, unsigned char c) {
+static void remove_child48(art_tree *t, art_node48 *n, art_node **ref, unsigned char c) {
     int pos = n->keys[c];
     n->keys[c] = 0;
     n->children[pos-1] = NULL;
     n->n.num_children--;
 
     if (n->n.num_children == 12) {
-        art_node16 *new_node = (art_node16*)alloc_node(NODE16);
+        art_node16 *new_node = (art_node16*)alloc_node(t, NODE16);
         *ref = (art_node*)new_node;
         copy_header((art_node*)new_node, (art_node*)n);
 
@@ -776,27 +907,27 @@ static void remove_child48(art_node48 *n, art_node **ref, unsigned char c) {
                 child++;
             }
         }
-        free(n);
+        free_node(t, (art_node*)n);
     }
 }
 
-static void remove_child16(art_node16 *n, art_node **ref, art_node **l) {
+static void remove_child16(art_tree *t, art_node16 *n, art_node **ref, art_node **l) {
     int pos = l - n->children;
     memmove(n->keys+pos, n->keys+pos+1, n->n.num_children - 1 - pos);
     memmove(n->children+pos, n->children+pos+1, (n->n.num_children - 1 - pos)*sizeof(void*));
     n->n.num_children--;
 
     if (n->n.num_children == 3) {
-        art_node4 *new_node = (art_node4*)alloc_node(NODE4);
+        art_node4 *new_node = (art_node4*)alloc_node(t, NODE4);
         *ref = (art_node*)new_node;
         copy_header((art_node*)new_node, (art_node*)n);
         memcpy(new_node->keys, n->keys, 4);
         memcpy(new_node->children, n->children, 4*sizeof(void*));
-        free(n);
+        free_node(t, (art_node*)n);
     }
 }
 
-static void remove_child4(art_node4 *n, art_node **ref, art_node **l) {
+static void remove_child4(art_tree *t, art_node4 *n, art_node **ref, art_node **l) {
     int pos = l - n->children;
     memmove(n->keys+pos, n->keys+pos+1, n->n.num_children - 1 - pos);
     memmove(n->children+pos, n->children+pos+1, (n->n.num_children - 1 - pos)*sizeof(void*));
@@ -823,26 +954,26 @@ static void remove_child4(art_node4 *n, art_node **ref, art_node **l) {
             child->partial_len += n->n.partial_len + 1;
         }
         *ref = child;
-        free(n);
+        free_node(t, (art_node*)n);
     }
 }
 
-static void remove_child(art_node *n, art_node **ref, unsigned char c, art_node **l) {
+static void remove_child(art_tree *t, art_node *n, art_node **ref, unsigned char c, art_node **l) {
     switch (n->type) {
         case NODE4:
-            return remove_child4((art_node4*)n, ref, l);
+            return remove_child4(t, (art_node4*)n, ref, l);
         case NODE16:
-            return remove_child16((art_node16*)n, ref, l);
+            return remove_child16(t, (art_node16*)n, ref, l);
         case NODE48:
-            return remove_child48((art_node48*)n, ref, c);
+            return remove_child48(t, (art_node48*)n, ref, c);
         case NODE256:
-            return remove_child256((art_node256*)n, ref, c);
+            return remove_child256(t, (art_node256*)n, ref, c);
         default:
             abort();
     }
 }
 
-static art_leaf* recursive_delete(art_node *n, art_node **ref, const unsigned char *key, int key_len, int depth) {
+static art_leaf* recursive_delete(art_tree *t, art_node *n, art_node **ref, const unsigned char *key, int key_len, int depth) {
     // Search terminated
     if (!n) return NULL;
 
@@ -874,14 +1005,14 @@ static art_leaf* recursive_delete(art_node *n, art_node **ref, const unsigned ch
     if (IS_LEAF(*child)) {
         art_leaf *l = LEAF_RAW(*child);
         if (!leaf_matches(l, key, key_len, depth)) {
-            remove_child(n, ref, key[depth], child);
+            remove_child(t, n, ref, key[depth], child);
             return l;
         }
         return NULL;
 
     // Recurse
     } else {
-        return recursive_delete(*child, child, key, key_len, depth+1);
+        return recursive_delete(t, *child, child, key, key_len, depth+1);
     }
 }
 
@@ -895,11 +1026,11 @@ static art_leaf* recursive_delete(art_node *n, art_node **ref, const unsigned ch
  */
 void* art_delete(art_tree *t, const unsigned char *key, int key_len) {
     // printf("\nart_delete(%s %d)\n", key, key_len);
-    art_leaf *l = recursive_delete(t->root, &t->root, key, key_len, 0);
+    art_leaf *l = recursive_delete(t, t->root, &t->root, key, key_len, 0);
     if (l) {
         t->size--;
         void *old = l->value;
-        free(l);
+        free_leaf(t, l);
         return old;
     }
     return NULL;
@@ -918,6 +1049,8 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
     switch (n->type) {
         case NODE4:
             for (int i=0; i < n->num_children; i++) {
+                if (i + 1 < n->num_children)
+                    PREFETCH(((art_node4*)n)->children[i+1]);
                 res = recursive_iter(((art_node4*)n)->children[i], cb, data);
                 if (res) return res;
             }
@@ -925,6 +1058,8 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
 
         case NODE16:
             for (int i=0; i < n->num_children; i++) {
+                if (i + 1 < n->num_children)
+                    PREFETCH(((art_node16*)n)->children[i+1]);
                 res = recursive_iter(((art_node16*)n)->children[i], cb, data);
                 if (res) return res;
             }
@@ -1062,6 +1197,8 @@ static int recursive_iter_leaf(art_node *n, art_callback_leaf cb, void *data) {
     switch (n->type) {
         case NODE4:
             for (int i=0; i < n->num_children; i++) {
+                if (i + 1 < n->num_children)
+                    PREFETCH(((art_node4*)n)->children[i+1]);
                 res = recursive_iter_leaf(((art_node4*)n)->children[i], cb, data);
                 if (res) return res;
             }
@@ -1069,6 +1206,8 @@ static int recursive_iter_leaf(art_node *n, art_callback_leaf cb, void *data) {
 
         case NODE16:
             for (int i=0; i < n->num_children; i++) {
+                if (i + 1 < n->num_children)
+                    PREFETCH(((art_node16*)n)->children[i+1]);
                 res = recursive_iter_leaf(((art_node16*)n)->children[i], cb, data);
                 if (res) return res;
             }
@@ -1152,4 +1291,169 @@ int art_iter_prefix_leaf(art_tree *t, const unsigned char *key, int key_len, art
         depth++;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+static int first_leaf(void *data, art_leaf *leaf) {
+    *(art_leaf **)data = leaf;
+    return 1;
+}
+
+/**
+ * Returns the first child of the node after the key byte c
+ * and sets its key byte to key.
+ */
+static art_node* next_child(const art_node *n, unsigned char c, unsigned char *key) {
+    int i;
+    switch (n->type) {
+        case NODE4:
+            for (i=0; i < n->num_children; i++) {
+                if (((const art_node4*)n)->keys[i] > c) {
+                    *key = ((const art_node4*)n)->keys[i];
+                    return ((const art_node4*)n)->children[i];
+                }
+            }
+            break;
+        case NODE16:
+            for (i=0; i < n->num_children; i++) {
+                if (((const art_node16*)n)->keys[i] > c) {
+                    *key = ((const art_node16*)n)->keys[i];
+                    return ((const art_node16*)n)->children[i];
+                }
+            }
+            break;
+        case NODE48:
+            for (i=c+1; i < 256; i++) {
+                int idx = ((const art_node48*)n)->keys[i];
+                if (idx) {
+                    *key = i;
+                    return ((const art_node48*)n)->children[idx-1];
+                }
+            }
+            break;
+        case NODE256:
+            for (i=c+1; i < 256; i++) {
+                if (((const art_node256*)n)->children[i]) {
+                    *key = i;
+                    return ((const art_node256*)n)->children[i];
+                }
+            }
+            break;
+        default:
+            abort();
+    }
+    return NULL;
+}
+
+/**
+ * Returns the leaf following the leaf l in key order.
+ * The path of l is followed from the root and the deepest
+ * next sibling on the path holds the following leaf.
+ */
+static art_leaf* successor(art_node *n, const art_leaf *l) {
+    art_node **child, *next = NULL, *sibling;
+    uint32_t depth = 0;
+    unsigned char c, key;
+    while (n && !IS_LEAF(n)) {
+        depth += n->partial_len;
+        // [neoul@ymail.com] input 0 to find_child if key_len is over for exact matching
+        c = (depth < l->key_len) ? l->key[depth] : 0x0;
+        sibling = next_child(n, c, &key);
+        if (sibling)
+            next = sibling;
+        child = find_child(n, c);
+        n = (child) ? *child : NULL;
+        depth++;
+    }
+    return minimum(next);
+}
+
+/**
+ * Pushes the path from the root to the leaf l into the stack of the iterator.
+ */
+static void iter_push_path(art_iterator *it, art_node *n, const art_leaf *l) {
+    art_node **child;
+    uint32_t depth = 0;
+    unsigned char c;
+    it->depth = 0;
+    while (n && !IS_LEAF(n)) {
+        if (it->depth >= ART_ITER_DEPTH_MAX) {
+            it->depth = -1;
+            return;
+        }
+        depth += n->partial_len;
+        c = (depth < l->key_len) ? l->key[depth] : 0x0;
+        it->stack[it->depth].node = n;
+        it->stack[it->depth].key = c;
+        it->depth++;
+        child = find_child(n, c);
+        n = (child) ? *child : NULL;
+        depth++;
+    }
+}
+
+/**
+ * Returns the minimum leaf of n pushing its path into the stack of the iterator.
+ */
+static art_leaf* iter_push_minimum(art_iterator *it, art_node *n) {
+    art_node **child;
+    unsigned char key;
+    while (n && !IS_LEAF(n)) {
+        if (it->depth >= ART_ITER_DEPTH_MAX) {
+            it->depth = -1;
+            return minimum(n);
+        }
+        child = find_child(n, 0x0);
+        key = 0x0;
+        it->stack[it->depth].node = n;
+        n = (child) ? *child : next_child(n, 0x0, &key);
+        it->stack[it->depth].key = key;
+        it->depth++;
+    }
+    return (n) ? LEAF_RAW(n) : NULL;
+}
+
+/**
+ * Starts the iteration of the leaves matching the prefix in key order.
+ * @return The first matched leaf or NULL if not found.
+ */
+art_leaf* art_iter_prefix_begin(art_tree *t, art_iterator *it, const unsigned char *prefix, int prefix_len) {
+    it->prefix = prefix;
+    it->prefix_len = prefix_len;
+    it->leaf = NULL;
+    it->depth = 0;
+    art_iter_prefix_leaf(t, prefix, prefix_len, first_leaf, &it->leaf);
+    return it->leaf;
+}
+
+/**
+ * Moves the iterator to the next matched leaf.
+ * @return The next matched leaf or NULL at the end.
+ */
+art_leaf* art_iter_prefix_next(art_tree *t, art_iterator *it) {
+    art_node *sibling = NULL;
+    unsigned char key;
+    if (!it->leaf)
+        return NULL;
+    if (it->depth == 0)
+        iter_push_path(it, t->root, it->leaf);
+    if (it->depth < 0) {
+        it->leaf = successor(t->root, it->leaf);
+    } else {
+        // go up to the deepest next sibling and then down to its minimum leaf.
+        while (it->depth > 0) {
+            sibling = next_child(it->stack[it->depth - 1].node, it->stack[it->depth - 1].key, &key);
+            if (sibling)
+                break;
+            it->depth--;
+        }
+        if (sibling) {
+            it->stack[it->depth - 1].key = key;
+            it->leaf = iter_push_minimum(it, sibling);
+        } else
+            it->leaf = NULL;
+    }
+    // The leaves matching the prefix are contiguous in key order.
+    if (it->leaf && leaf_prefix_matches(it->leaf, it->prefix, it->prefix_len))
+        it->leaf = NULL;
+    return it->leaf;
+}
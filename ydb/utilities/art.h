@@ -79,19 +79,34 @@ typedef struct {
 /**
  * Represents a leaf. These are
  * of arbitrary size, as they include the key.
+ * The key points to key_data or to the key of the caller (ART_KEY_REF).
  */
 typedef struct {
     void *value;
     uint32_t key_len;
-    unsigned char key[];
+    const unsigned char *key;
+    unsigned char key_data[];
 } art_leaf;
 
+/**
+ * The options of an ART tree
+ * ART_POOL: The nodes and leaves are allocated from the pool of the tree.
+ * ART_KEY_REF: The leaves refer to the inserted keys instead of copying them.
+ *  The key must be kept with a trailing zero byte until it is deleted.
+ */
+#define ART_POOL    0x1
+#define ART_KEY_REF 0x2
+
+struct art_pool;
+
 /**
  * Main struct, points to root.
  */
 typedef struct {
     art_node *root;
     uint64_t size;
+    int options;
+    struct art_pool *pool;
 } art_tree;
 
 /**
@@ -100,6 +115,12 @@ typedef struct {
  */
 int art_tree_init(art_tree *t);
 
+/**
+ * Initializes an ART tree with the options (ART_POOL, ART_KEY_REF)
+ * @return 0 on success.
+ */
+int art_tree_init_opt(art_tree *t, int options);
+
 /**
  * DEPRECATED
  * Initializes an ART tree
@@ -216,6 +237,38 @@ int art_iter_prefix(art_tree *t, const unsigned char *prefix, int prefix_len, ar
 typedef int(*art_callback_leaf)(void *data, art_leaf *leaf);
 int art_iter_prefix_leaf(art_tree *t, const unsigned char *key, int key_len, art_callback_leaf cb, void *data);
 
+#define ART_ITER_DEPTH_MAX 64
+
+/**
+ * The cursor of the prefix iteration.
+ * It keeps the path (the nodes and the key bytes) to the current leaf
+ * in the fixed stack, so that the iteration requires no allocation.
+ * The next leaf is found from the root if the path is deeper than the stack.
+ * The tree must not be changed during the iteration.
+ */
+typedef struct {
+    const unsigned char *prefix;
+    int prefix_len;
+    art_leaf *leaf;
+    int depth; // the depth of the stack (0: not built yet, -1: overflowed)
+    struct {
+        art_node *node;
+        unsigned char key;
+    } stack[ART_ITER_DEPTH_MAX];
+} art_iterator;
+
+/**
+ * Starts the iteration of the leaves matching the prefix in key order.
+ * @return The first matched leaf or NULL if not found.
+ */
+art_leaf* art_iter_prefix_begin(art_tree *t, art_iterator *it, const unsigned char *prefix, int prefix_len);
+
+/**
+ * Moves the iterator to the next matched leaf.
+ * @return The next matched leaf or NULL at the end.
+ */
+art_leaf* art_iter_prefix_next(art_tree *t, art_iterator *it);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,60 +9,341 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "base64.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BASE64_SIMD
+#include <immintrin.h>
+#endif
+
 #define os_malloc malloc
 #define os_memset memset
 #define os_free free
 static const unsigned char base64_table[65] =
 	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/* The input bytes of an encoded line (72 chars) with LF */
+#define BASE64_LINE 54
+
+static int base64_level = -1;
+
+#ifdef BASE64_SIMD
+/*
+ * The SIMD codec is based on the pshufb lookups of Wojciech Mula and
+ * Daniel Lemire (https://github.com/WojciechMula/base64simd).
+ * It is selected by the CPU at runtime (base64_simd_level).
+ */
+__attribute__((target("ssse3")))
+static inline __m128i enc_reshuffle_ssse3(__m128i in)
+{
+	__m128i t0, t1, t2, t3;
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+					       4, 5, 3, 4, 1, 2, 0, 1));
+	t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+	t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+	t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i enc_translate_ssse3(__m128i in)
+{
+	const __m128i lut = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+		'/' - 63, 'A', 0, 0);
+	__m128i idx = _mm_subs_epu8(in, _mm_set1_epi8(51));
+	__m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+	idx = _mm_or_si128(idx, _mm_and_si128(less, _mm_set1_epi8(13)));
+	return _mm_add_epi8(_mm_shuffle_epi8(lut, idx), in);
+}
+
+/* encode 12 bytes to 16 chars at a time. 16 bytes of the input are read. */
+__attribute__((target("ssse3")))
+static size_t enc_ssse3(const unsigned char *in, size_t len, size_t avail,
+			unsigned char *out)
+{
+	size_t i = 0;
+	for (; i + 12 <= len && i + 16 <= avail; i += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		v = enc_translate_ssse3(enc_reshuffle_ssse3(v));
+		_mm_storeu_si128((__m128i *)out, v);
+		out += 16;
+	}
+	return i;
+}
+
+/* encode 24 bytes to 32 chars at a time. 28 bytes of the input are read. */
+__attribute__((target("avx2")))
+static size_t enc_avx2(const unsigned char *in, size_t len, size_t avail,
+		       unsigned char *out)
+{
+	size_t i = 0;
+	const __m256i shuf = _mm256_set_epi8(
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i lut = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+		'/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+		'/' - 63, 'A', 0, 0);
+	for (; i + 24 <= len && i + 28 <= avail; i += 24) {
+		__m256i v, t0, t1, t2, t3, idx, less;
+		v = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+			_mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+		v = _mm256_shuffle_epi8(v, shuf);
+		t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+		t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+		t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		v = _mm256_or_si256(t1, t3);
+		idx = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+		less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+		idx = _mm256_or_si256(idx, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+		v = _mm256_add_epi8(_mm256_shuffle_epi8(lut, idx), v);
+		_mm256_storeu_si256((__m256i *)out, v);
+		out += 32;
+	}
+	return i;
+}
+
+/*
+ * decode 16 chars to 12 bytes at a time.
+ * It stops at the chars that are not in the base64 table ('=', LF, ...).
+ */
+__attribute__((target("ssse3")))
+static size_t dec_ssse3(const unsigned char *in, size_t len, unsigned char *out,
+			size_t *out_len)
+{
+	size_t i = 0, o = 0;
+	const __m128i lower = _mm_setr_epi8(1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70,
+					    1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i upper = _mm_setr_epi8(0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a,
+					    0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i shift = _mm_setr_epi8(0, 0, 0x3e - 0x2b, 0x34 - 0x30,
+					    0x00 - 0x41, 0x0f - 0x50, 0x1a - 0x61, 0x29 - 0x70,
+					    0, 0, 0, 0, 0, 0, 0, 0);
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0f));
+		__m128i eq_2f = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x2f));
+		__m128i outside = _mm_or_si128(
+			_mm_cmplt_epi8(v, _mm_shuffle_epi8(lower, hi)),
+			_mm_cmpgt_epi8(v, _mm_shuffle_epi8(upper, hi)));
+		outside = _mm_andnot_si128(eq_2f, outside);
+		if (_mm_movemask_epi8(outside))
+			break;
+		v = _mm_add_epi8(v, _mm_shuffle_epi8(shift, hi));
+		v = _mm_add_epi8(v, _mm_and_si128(eq_2f, _mm_set1_epi8(-3)));
+		/* pack 4 x 6 bits into 3 bytes */
+		v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+		v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+		v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+						      14, 13, 12, -1, -1, -1, -1));
+		_mm_storel_epi64((__m128i *)(out + o), v);
+		*(uint32_t *)(out + o + 8) = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+		o += 12;
+	}
+	*out_len = o;
+	return i;
+}
+
+/* decode 32 chars to 24 bytes at a time. */
+__attribute__((target("avx2")))
+static size_t dec_avx2(const unsigned char *in, size_t len, unsigned char *out,
+		       size_t *out_len)
+{
+	size_t i = 0, o = 0;
+	const __m256i lower = _mm256_setr_epi8(
+		1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, 1, 1, 1, 1, 1, 1, 1, 1);
+	const __m256i upper = _mm256_setr_epi8(
+		0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i shift = _mm256_setr_epi8(
+		0, 0, 0x3e - 0x2b, 0x34 - 0x30, 0x00 - 0x41, 0x0f - 0x50, 0x1a - 0x61, 0x29 - 0x70,
+		0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0x3e - 0x2b, 0x34 - 0x30, 0x00 - 0x41, 0x0f - 0x50, 0x1a - 0x61, 0x29 - 0x70,
+		0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), _mm256_set1_epi8(0x0f));
+		__m256i eq_2f = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x2f));
+		__m256i outside = _mm256_or_si256(
+			_mm256_cmpgt_epi8(_mm256_shuffle_epi8(lower, hi), v),
+			_mm256_cmpgt_epi8(v, _mm256_shuffle_epi8(upper, hi)));
+		outside = _mm256_andnot_si256(eq_2f, outside);
+		if (_mm256_movemask_epi8(outside))
+			break;
+		v = _mm256_add_epi8(v, _mm256_shuffle_epi8(shift, hi));
+		v = _mm256_add_epi8(v, _mm256_and_si256(eq_2f, _mm256_set1_epi8(-3)));
+		v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+		v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+		v = _mm256_shuffle_epi8(v, pack);
+		_mm_storeu_si128((__m128i *)(out + o), _mm256_castsi256_si128(v));
+		o += 12;
+		/* the upper lane is stored over the 4 unused bytes of the lower lane. */
+		_mm_storel_epi64((__m128i *)(out + o), _mm256_extracti128_si256(v, 1));
+		*(uint32_t *)(out + o + 8) = (uint32_t)_mm_cvtsi128_si32(
+			_mm_srli_si128(_mm256_extracti128_si256(v, 1), 8));
+		o += 12;
+	}
+	*out_len = o;
+	return i;
+}
+
+/* count the base64 chars and '=' of 32 chars at a time. */
+__attribute__((target("avx2")))
+static size_t cnt_avx2(const unsigned char *in, size_t len, size_t *count)
+{
+	size_t i = 0, c = 0;
+	const __m256i lower = _mm256_setr_epi8(
+		1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, 1, 1, 1, 1, 1, 1, 1, 1);
+	const __m256i upper = _mm256_setr_epi8(
+		0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, 0, 0, 0, 0, 0, 0, 0, 0);
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), _mm256_set1_epi8(0x0f));
+		__m256i valid = _mm256_or_si256(
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x2f)),
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x3d)));
+		__m256i outside = _mm256_or_si256(
+			_mm256_cmpgt_epi8(_mm256_shuffle_epi8(lower, hi), v),
+			_mm256_cmpgt_epi8(v, _mm256_shuffle_epi8(upper, hi)));
+		outside = _mm256_andnot_si256(valid, outside);
+		c += 32 - __builtin_popcount((unsigned int)_mm256_movemask_epi8(outside));
+	}
+	*count = c;
+	return i;
+}
+
+/* count the base64 chars and '=' of 16 chars at a time. */
+__attribute__((target("ssse3")))
+static size_t cnt_ssse3(const unsigned char *in, size_t len, size_t *count)
+{
+	size_t i = 0, c = 0;
+	const __m128i lower = _mm_setr_epi8(1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70,
+					    1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i upper = _mm_setr_epi8(0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a,
+					    0, 0, 0, 0, 0, 0, 0, 0);
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0f));
+		__m128i valid = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x2f)),
+					     _mm_cmpeq_epi8(v, _mm_set1_epi8(0x3d)));
+		__m128i outside = _mm_or_si128(
+			_mm_cmplt_epi8(v, _mm_shuffle_epi8(lower, hi)),
+			_mm_cmpgt_epi8(v, _mm_shuffle_epi8(upper, hi)));
+		outside = _mm_andnot_si128(valid, outside);
+		c += 16 - __builtin_popcount((unsigned int)_mm_movemask_epi8(outside));
+	}
+	*count = c;
+	return i;
+}
+#endif
+
 /**
- * _base64_encode - Base64 encode
- * @src: Data to be encoded
+ * base64_simd_level - Get or set the SIMD codec used
+ * @level: BASE64_SCALAR, BASE64_SSSE3, BASE64_AVX2 or -1 to get the current level
+ * Returns: The level used. The level is limited to the CPU support.
+ */
+int base64_simd_level(int level)
+{
+	int max = BASE64_SCALAR;
+#ifdef BASE64_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		max = BASE64_AVX2;
+	else if (__builtin_cpu_supports("ssse3"))
+		max = BASE64_SSSE3;
+#endif
+	if (level < 0) {
+		if (base64_level < 0)
+			base64_level = max;
+		return base64_level;
+	}
+	base64_level = (level > max) ? max : level;
+	return base64_level;
+}
+
+/* encode the 3-byte blocks (len % 3 == 0) of the input having avail bytes. */
+static size_t encode_blocks(const unsigned char *in, size_t len, size_t avail,
+			    unsigned char *out)
+{
+	unsigned char *pos = out;
+	size_t i = 0;
+#ifdef BASE64_SIMD
+	int level = (base64_level < 0) ? base64_simd_level(-1) : base64_level;
+	if (level >= BASE64_AVX2) {
+		i = enc_avx2(in, len, avail, pos);
+		pos += i / 3 * 4;
+	}
+	if (level >= BASE64_SSSE3) {
+		size_t n = enc_ssse3(in + i, len - i, avail - i, pos);
+		pos += n / 3 * 4;
+		i += n;
+	}
+#else
+	(void) avail;
+#endif
+	for (; i + 3 <= len; i += 3) {
+		*pos++ = base64_table[in[i] >> 2];
+		*pos++ = base64_table[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+		*pos++ = base64_table[((in[i + 1] & 0x0f) << 2) | (in[i + 2] >> 6)];
+		*pos++ = base64_table[in[i + 2] & 0x3f];
+	}
+	return pos - out;
+}
+
+/**
+ * base64_encode_len - The buffer size for base64_encode_to
  * @len: Length of the data to be encoded
- * @out_len: Pointer to output length variable, or %NULL if not used
- * Returns: Allocated buffer of out_len bytes of encoded data,
- * or %NULL on failure
- *
- * Caller is responsible for freeing the returned buffer. Returned buffer is
- * nul terminated to make it easier to use as a C string. The nul terminator is
- * not included in out_len.
+ * @add_lf: Add LF (Line Feed) to each 72 chars
+ * Returns: The buffer size including the nul termination
  */
-static unsigned char * _base64_encode(const unsigned char *src, size_t len,
-			      size_t *out_len, int add_lf)
+size_t base64_encode_len(size_t len, int add_lf)
 {
-	unsigned char *out, *pos;
-	const unsigned char *end, *in;
-	size_t olen;
-	int line_len;
+	size_t olen = (len + 2) / 3 * 4;
+	if (add_lf)
+		olen += olen / 72 + 1;
+	return olen + 1;
+}
 
-	olen = len * 4 / 3 + 4; /* 3-byte blocks to 4-byte */
-	olen += olen / 72; /* line feeds */
-	olen++; /* nul termination */
-	if (olen < len)
-		return NULL; /* integer overflow */
-	out = os_malloc(olen);
-	if (out == NULL)
-		return NULL;
+/**
+ * base64_encode_to - Base64 encode into the buffer
+ * @src: Data to be encoded
+ * @len: Length of the data to be encoded
+ * @out: The buffer of base64_encode_len bytes at least
+ * @add_lf: Add LF (Line Feed) to each 72 chars
+ * Returns: The length of the encoded data. It is nul terminated.
+ */
+size_t base64_encode_to(const unsigned char *src, size_t len,
+			unsigned char *out, int add_lf)
+{
+	unsigned char *pos = out;
+	const unsigned char *end = src + len, *in = src;
+	size_t n;
 
-	end = src + len;
-	in = src;
-	pos = out;
-	line_len = 0;
-	while (end - in >= 3) {
-		*pos++ = base64_table[in[0] >> 2];
-		*pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-		*pos++ = base64_table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
-		*pos++ = base64_table[in[2] & 0x3f];
-		in += 3;
-		line_len += 4;
-		if (line_len >= 72) {
-			if (add_lf)
-				*pos++ = '\n';
-			line_len = 0;
+	if (add_lf) {
+		while (end - in >= BASE64_LINE) {
+			pos += encode_blocks(in, BASE64_LINE, end - in, pos);
+			*pos++ = '\n';
+			in += BASE64_LINE;
 		}
 	}
+	n = (end - in) / 3 * 3;
+	pos += encode_blocks(in, n, end - in, pos);
+	in += n;
 
 	if (end - in) {
 		*pos++ = base64_table[in[0] >> 2];
@@ -75,15 +356,68 @@ static unsigned char * _base64_encode(const unsigned char *src, size_t len,
 			*pos++ = base64_table[(in[1] & 0x0f) << 2];
 		}
 		*pos++ = '=';
-		line_len += 4;
 	}
 
-	if (line_len && add_lf)
+	if (add_lf && (len % BASE64_LINE))
 		*pos++ = '\n';
 
 	*pos = '\0';
+	return pos - out;
+}
+
+/**
+ * base64_encode_fp - Base64 encode into the stream
+ * @fp: The stream
+ * @src: Data to be encoded
+ * @len: Length of the data to be encoded
+ * @add_lf: Add LF (Line Feed) to each 72 chars
+ * Returns: The length written to the stream
+ *
+ * The data is encoded by the lines through a buffer on the stack.
+ */
+size_t base64_encode_fp(FILE *fp, const unsigned char *src, size_t len, int add_lf)
+{
+	unsigned char buf[BASE64_LINE * 64 / 3 * 4 + 64 + 1];
+	size_t olen = 0;
+	while (len > 0) {
+		size_t n = (len > BASE64_LINE * 64) ? BASE64_LINE * 64 : len;
+		size_t m = base64_encode_to(src, n, buf, add_lf);
+		if (fwrite(buf, 1, m, fp) != m)
+			break;
+		olen += m;
+		src += n;
+		len -= n;
+	}
+	return olen;
+}
+
+/**
+ * _base64_encode - Base64 encode
+ * @src: Data to be encoded
+ * @len: Length of the data to be encoded
+ * @out_len: Pointer to output length variable, or %NULL if not used
+ * Returns: Allocated buffer of out_len bytes of encoded data,
+ * or %NULL on failure
+ *
+ * Caller is responsible for freeing the returned buffer. Returned buffer is
+ * nul terminated to make it easier to use as a C string. The nul terminator is
+ * not included in out_len.
+ */
+static unsigned char * _base64_encode(const unsigned char *src, size_t len,
+			      size_t *out_len, int add_lf)
+{
+	unsigned char *out;
+	size_t olen;
+
+	olen = base64_encode_len(len, add_lf);
+	if (olen < len)
+		return NULL; /* integer overflow */
+	out = os_malloc(olen);
+	if (out == NULL)
+		return NULL;
+	olen = base64_encode_to(src, len, out, add_lf);
 	if (out_len)
-		*out_len = pos - out;
+		*out_len = olen;
 	return out;
 }
 
@@ -99,44 +433,106 @@ unsigned char * base64_encode(const unsigned char *src, size_t len, size_t *out_
 	return _base64_encode(src, len, out_len, 0);
 }
 
+/* The 6-bit values of the base64 chars. 0x80 is for the invalid chars. */
+static const unsigned char dtable[256] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80, 0x80, 0x3f,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x00, 0x80, 0x80,
+	0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+	0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+/* decode the valid chars in a row by the SIMD codec. */
+static size_t decode_blocks(const unsigned char *in, size_t len,
+			    unsigned char *out, size_t *out_len)
+{
+	size_t i = 0, o = 0;
+#ifdef BASE64_SIMD
+	size_t n;
+	int level = (base64_level < 0) ? base64_simd_level(-1) : base64_level;
+	if (level >= BASE64_AVX2) {
+		i = dec_avx2(in, len, out, &o);
+	}
+	if (level >= BASE64_SSSE3) {
+		i += dec_ssse3(in + i, len - i, out + o, &n);
+		o += n;
+	}
+#else
+	(void) in;
+	(void) len;
+	(void) out;
+#endif
+	*out_len = o;
+	return i;
+}
+
+/* count the chars in the base64 table including '='. */
+static size_t count_blocks(const unsigned char *in, size_t len)
+{
+	size_t i = 0, count = 0;
+#ifdef BASE64_SIMD
+	int level = (base64_level < 0) ? base64_simd_level(-1) : base64_level;
+	if (level >= BASE64_AVX2)
+		i = cnt_avx2(in, len, &count);
+	else if (level >= BASE64_SSSE3)
+		i = cnt_ssse3(in, len, &count);
+#endif
+	for (; i < len; i++) {
+		if (dtable[in[i]] != 0x80)
+			count++;
+	}
+	return count;
+}
+
 /**
- * base64_decode - Base64 decode
+ * base64_decode_len - The buffer size for base64_decode_to
+ * @len: Length of the data to be decoded
+ */
+size_t base64_decode_len(size_t len)
+{
+	return len / 4 * 3 + 3;
+}
+
+/**
+ * base64_decode_to - Base64 decode into the buffer
  * @src: Data to be decoded
  * @len: Length of the data to be decoded
+ * @out: The buffer of base64_decode_len bytes at least
  * @out_len: Pointer to output length variable
- * Returns: Allocated buffer of out_len bytes of decoded data,
- * or %NULL on failure
- *
- * Caller is responsible for freeing the returned buffer.
+ * Returns: 0 on success or -1 on the invalid data
  */
-unsigned char * base64_decode(const unsigned char *src, size_t len,
-			      size_t *out_len)
+int base64_decode_to(const unsigned char *src, size_t len,
+		     unsigned char *out, size_t *out_len)
 {
-	unsigned char dtable[256], *out, *pos, block[4], tmp;
-	size_t i, count, olen;
+	unsigned char *pos, block[4], tmp;
+	size_t i, count, n;
 	int pad = 0;
 
-	os_memset(dtable, 0x80, 256);
-	for (i = 0; i < sizeof(base64_table) - 1; i++)
-		dtable[base64_table[i]] = (unsigned char) i;
-	dtable['='] = 0;
-
-	count = 0;
-	for (i = 0; i < len; i++) {
-		if (dtable[src[i]] != 0x80)
-			count++;
-	}
-
+	count = count_blocks(src, len);
 	if (count == 0 || count % 4)
-		return NULL;
-
-	olen = count / 4 * 3;
-	pos = out = os_malloc(olen);
-	if (out == NULL)
-		return NULL;
+		return -1;
 
+	pos = out;
 	count = 0;
 	for (i = 0; i < len; i++) {
+		if (count == 0 && len - i >= 16) {
+			size_t m = decode_blocks(src + i, len - i, pos, &n);
+			pos += n;
+			i += m;
+			if (i >= len)
+				break;
+		}
 		tmp = dtable[src[i]];
 		if (tmp == 0x80)
 			continue;
@@ -157,14 +553,38 @@ unsigned char * base64_decode(const unsigned char *src, size_t len,
 					pos -= 2;
 				else {
 					/* Invalid padding */
-					os_free(out);
-					return NULL;
+					return -1;
 				}
 				break;
 			}
 		}
 	}
 	*out_len = pos - out;
+	return 0;
+}
+
+/**
+ * base64_decode - Base64 decode
+ * @src: Data to be decoded
+ * @len: Length of the data to be decoded
+ * @out_len: Pointer to output length variable
+ * Returns: Allocated buffer of out_len bytes of decoded data,
+ * or %NULL on failure
+ *
+ * Caller is responsible for freeing the returned buffer.
+ */
+unsigned char * base64_decode(const unsigned char *src, size_t len,
+			      size_t *out_len)
+{
+	unsigned char *out;
+
+	out = os_malloc(base64_decode_len(len));
+	if (out == NULL)
+		return NULL;
+	if (base64_decode_to(src, len, out, out_len)) {
+		os_free(out);
+		return NULL;
+	}
 	return out;
 }
 
@@ -10,6 +10,8 @@
 #ifndef BASE64_H
 #define BASE64_H
 
+#include <stdio.h>
+
 // base64 enconding with LF (Line Feed).
 unsigned char * base64_encode_lf(const unsigned char *src, size_t len, size_t *out_len);
 
@@ -19,4 +21,27 @@ unsigned char * base64_encode(const unsigned char *src, size_t len, size_t *out_
 // base64 decoding
 unsigned char * base64_decode(const unsigned char *src, size_t len, size_t *out_len);
 
+// The buffer size for base64_encode_to (including the nul termination)
+size_t base64_encode_len(size_t len, int add_lf);
+
+// base64 encoding into the buffer. Return the encoded length.
+size_t base64_encode_to(const unsigned char *src, size_t len, unsigned char *out, int add_lf);
+
+// base64 encoding into the stream without the intermediate buffer allocation.
+size_t base64_encode_fp(FILE *fp, const unsigned char *src, size_t len, int add_lf);
+
+// The buffer size for base64_decode_to
+size_t base64_decode_len(size_t len);
+
+// base64 decoding into the buffer. Return 0 on success or -1 on the invalid data.
+int base64_decode_to(const unsigned char *src, size_t len, unsigned char *out, size_t *out_len);
+
+// The SIMD codec selected by the CPU at runtime
+#define BASE64_SCALAR 0
+#define BASE64_SSSE3 1
+#define BASE64_AVX2 2
+
+// Get (level < 0) or set the SIMD codec level used.
+int base64_simd_level(int level);
+
 #endif /* BASE64_H */
@@ -10,6 +10,14 @@
 #include <stdbool.h>
 #include <yaml.h>
 
+#ifdef __AVX2__
+    #include <immintrin.h>
+#else
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+#endif
+
 #define UTF8_ACCEPT 0
 #define UTF8_REJECT 12
 
@@ -47,6 +55,77 @@ decode(uint32_t *state, uint32_t *codep, uint32_t byte)
     return *state;
 }
 
+// The special bytes of the plain ASCII prefix (plain_prefix)
+#define PLAIN_COLON 0x1    // ':' (': ' requires the quotes)
+#define PLAIN_EXTENDED 0x2 // '/' and '\'' (ydb path processing)
+
+static inline int plain_byte(uint8_t c, int specials)
+{
+    if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\')
+        return 0;
+    if ((specials & PLAIN_COLON) && c == ':')
+        return 0;
+    if ((specials & PLAIN_EXTENDED) && (c == '/' || c == '\''))
+        return 0;
+    return 1;
+}
+
+// plain_prefix --
+// Return the number of the leading bytes that are printable ASCII
+// (0x20-0x7E) except '"', '\\' and the specials. They need neither the decoding
+// nor the escaping. The bytes are classified 32 (AVX2) or 16 (SSE2) at a time.
+static size_t plain_prefix(const uint8_t *s, size_t len, int specials)
+{
+    size_t n = 0;
+#ifdef __AVX2__
+    for (; n + 32 <= len; n += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + n));
+        // the bytes over 0x7F are negative as signed.
+        __m256i m = _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7F)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        if (specials & PLAIN_COLON)
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+        if (specials & PLAIN_EXTENDED)
+        {
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')));
+        }
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+        if (mask)
+            return n + __builtin_ctz(mask);
+    }
+#endif
+#ifdef __SSE2__
+    for (; n + 16 <= len; n += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + n));
+        __m128i m = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        if (specials & PLAIN_COLON)
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+        if (specials & PLAIN_EXTENDED)
+        {
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+        }
+        int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return n + __builtin_ctz(mask);
+    }
+#endif
+    for (; n < len; n++)
+    {
+        if (!plain_byte(s[n], specials))
+            break;
+    }
+    return n;
+}
+
 int isUTF8(uint8_t *s)
 {
     uint32_t codepoint, state = 0;
@@ -157,6 +236,7 @@ char *to_yaml(const char *src, int indent, int *is_new, int extended)
     char *newstr;
     char *base;
     int len;
+    uint8_t *end;
 
     if (is_new)
         *is_new = 0;
@@ -167,8 +247,21 @@ char *to_yaml(const char *src, int indent, int *is_new, int extended)
     {
         quotes_required++;
     }
+    end = s + strlen(src);
     for (; *s; ++s)
     {
+        // skip the plain ASCII bytes that are not counted below.
+        if (state == UTF8_ACCEPT && codepoint_prev != ':')
+        {
+            size_t n = plain_prefix(s, end - s, PLAIN_COLON | (extended ? PLAIN_EXTENDED : 0));
+            if (n > 0)
+            {
+                codepoint_prev = s[n - 1];
+                s += n;
+                if (!*s)
+                    break;
+            }
+        }
         if (!decode(&state, &codepoint, *s))
         {
             if (state == UTF8_REJECT)
@@ -283,6 +376,20 @@ char *to_yaml(const char *src, int indent, int *is_new, int extended)
     len++;
     for (; *s; ++s)
     {
+        // copy the plain ASCII bytes that need no escaping.
+        if (state == UTF8_ACCEPT)
+        {
+            size_t n = plain_prefix(s, end - s, 0);
+            if (n > 0)
+            {
+                memcpy(&newstr[len], s, n);
+                len += n;
+                s += n;
+                base = (char *)s;
+                if (!*s)
+                    break;
+            }
+        }
         if (!decode(&state, &codepoint, *s))
         {
             // printf("  codepoint: U+%04X\n", codepoint);
@@ -382,6 +489,26 @@ char *to_yaml(const char *src, int indent, int *is_new, int extended)
 }
 
 
+// plain_scalar --
+// Return true if the yaml is a plain scalar that is scanned as it is
+// (alphanumeric, '_' or '/' followed by alphanumeric or "_-./+@").
+static bool plain_scalar(const char *yaml, size_t len)
+{
+    size_t i;
+    if (len == 0 || !(isalnum((unsigned char)yaml[0]) || yaml[0] == '_' || yaml[0] == '/'))
+        return false;
+    for (i = 1; i < len; i++)
+    {
+        unsigned char c = yaml[i];
+        if (isalnum(c))
+            continue;
+        if (c == '_' || c == '-' || c == '.' || c == '/' || c == '+' || c == '@')
+            continue;
+        return false;
+    }
+    return true;
+}
+
 char *to_string(const char *yaml, size_t len, int *invalid)
 {
     int done = 0;
@@ -394,6 +521,13 @@ char *to_string(const char *yaml, size_t len, int *invalid)
         return NULL;
     if (len == 0)
         len = strlen(yaml);
+    if (plain_scalar(yaml, len))
+    {
+        newstr = strndup(yaml, len);
+        if (newstr && invalid)
+            *invalid = 0;
+        return newstr;
+    }
     // if (yaml[0] != '"' && yaml[0] != '\'')
     //     return strndup((char *) yaml, len);
     if (!yaml_parser_initialize(&parser))
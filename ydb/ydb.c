@@ -28,13 +28,12 @@
 #include <arpa/inet.h>
 
 // #define PTHREAD_LOCK
-#ifdef PTHREAD_LOCK
 #include <pthread.h>
-#endif
 
 #define WRITEV_SEND 1
 #ifdef WRITEV_SEND
 #include <sys/uio.h>
+#include <sys/mman.h>
 #endif
 
 #include "ylog.h"
@@ -163,6 +162,7 @@ yconn tconn;
 #define YCONN_TYPE_INET 0x0200
 #define YCONN_TYPE_FIFO 0x0400
 #define YCONN_TYPE_FILE 0x0800
+#define YCONN_TYPE_SHM 0x1000
 #define YCONN_TYPE_MASK 0xff00
 
 #define STATUS_SERVER 0x010000
@@ -230,6 +230,14 @@ char *ymsg_str[] = {
 #define YMSG_HEAD_DELIMITER_LEN (sizeof(YMSG_HEAD_DELIMITER) - 1)
 #define YMSG_WHISPER_DELIMITER "+whisper-target:"
 #define YMSG_WHISPER_DELIMITER_LEN (sizeof(YMSG_WHISPER_DELIMITER) - 1)
+#define YMSG_SUBSCRIBE_HEAD "#subscribe: "
+#define YMSG_SUBSCRIBE_HEAD_LEN (sizeof(YMSG_SUBSCRIBE_HEAD) - 1)
+#define YMSG_CHANGE_HEAD "#change: "
+#define YMSG_RESUME_HEAD "#resume: "
+#define YMSG_DIGEST_HEAD "#digest: "
+#define YMSG_DIGEST_HEAD_LEN (sizeof(YMSG_DIGEST_HEAD) - 1)
+// The max number of the subtree digests sent on YOP_INIT
+#define YMSG_DIGEST_MAX 1024
 
 typedef struct _eventid
 {
@@ -276,6 +284,10 @@ struct _yconn
     int send_timeout;
     int recv_timeout;
     const char *name; // The name of the peer
+    ytrie *filter;    // The subscribed paths (prefixes) of the subscriber
+    ytrie *digest;    // The subtree digests of the subscriber received on YOP_INIT
+    unsigned long long change_epoch; // The change stream of the publisher (0: unknown)
+    unsigned long long change_seq;   // The last change applied by the subscriber
 };
 
 static bool ydb_conn_log;
@@ -297,6 +309,16 @@ static unsigned int _yconn_flags(const char *address, char *flagstr);
 static yconn *_yconn_new(const char *address, unsigned int flags, ydb *datablock);
 static void _yconn_free(yconn *conn);
 static void _yconn_free_with_deinit(yconn *conn);
+static void yconn_filter_add(yconn *conn, const char *path, int pathlen);
+static void yconn_shm_release(ydb *datablock);
+static void yconn_shm_close(ydb *datablock);
+static void yconn_filter_clear(yconn *conn);
+static bool yconn_filtered(yconn *conn);
+static void yconn_digest_add(yconn *conn, const char *path, int pathlen, unsigned long long digest);
+static void yconn_digest_clear(yconn *conn);
+static void yconn_digest_head_print(FILE *fp, ynode *top);
+static bool yconn_change_read(char *data, const char *tag,
+                              unsigned long long *epoch, unsigned long long *seq);
 
 void yconn_close(yconn *conn);
 void yconn_deferred_close(yconn *conn);
@@ -350,6 +372,29 @@ struct _ydb
     int synccount;    // The number of connections (needs sync)
     int timeout;      // timeout for ydb_sync, ydb_path_sync
     bool no_var_args; // disables C variable arguments formatting for golang
+    int shmfd;                      // shared memory ring (memfd) of the published data
+    struct yconn_shm_ring *shmring; // shmfd mapped
+    const char *shmdata;            // the data being published in shmring
+    size_t shmdatalen;
+    unsigned long long shmpos;      // the position of shmdata in shmring
+    char *pubhead;        // the publish head formatted once for all subscribers
+    size_t pubheadlen;    // pubhead length up to the sequence number
+    char *pubtail;        // the rest of the publish head after the sequence number
+    size_t pubtaillen;
+    yconn_op pubop;
+    size_t sendq_limit;        // the high-water mark of the send queue of a subscriber
+    unsigned int sendq_drops;  // the number of subscribers dropped by sendq_limit
+    struct ydb_journal *journal; // the persistent change journal (ydb_open_persistent)
+    struct ydb_change *changes;      // the ring of the recent changes for the subscriber resume
+    unsigned long long change_epoch; // the identifier of the change stream
+    unsigned long long change_seq;   // the sequence number of the latest change
+    unsigned long long change_first; // the sequence number of the oldest change in the ring
+    size_t change_bytes;             // the data size of the changes in the ring
+    unsigned long long pubchange;    // the sequence number of the change being published
+    ylist *txn;                      // the changes staged by ydb_txn_begin
+    bool counter_dirty;              // the counters changed by ydb_counter_add are not published.
+    unsigned long counter_gen;       // the generation before the counters changed
+    struct ydb_update_pool *rpool;   // the worker threads of the parallel read hooks
 #ifdef PTHREAD_LOCK
     pthread_mutex_t lock;
     pthread_t lock_id;
@@ -557,6 +602,22 @@ static ydb_res ydb_epoll_detach(ydb *datablock, yconn *conn, int fd)
     return YDB_OK;
 }
 
+static ydb_res ydb_epoll_modify(ydb *datablock, yconn *conn, int fd, bool pollout)
+{
+    struct epoll_event event;
+    if (!IS_SET(conn->flags, YCONN_UNREADABLE))
+    {
+        event.data.ptr = conn;
+        event.events = pollout ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        if (epoll_ctl(datablock->epollfd, EPOLL_CTL_MOD, fd, &event))
+        {
+            YCONN_FAILED(conn, YDB_E_SYSTEM_FAILED);
+            return YDB_E_SYSTEM_FAILED;
+        }
+    }
+    return YDB_OK;
+}
+
 static void ydb_time_set_base(struct timespec *base)
 {
     clock_gettime(CLOCK_MONOTONIC, base);
@@ -828,6 +889,33 @@ unsigned char *base64_to_binary(char *base64, size_t base64len, size_t *binaryle
     return NULL;
 }
 
+// binary_to_base64_fp --
+// Write base64 string to the stream without the string allocation.
+// Return the length written.
+size_t binary_to_base64_fp(FILE *stream, unsigned char *binary, size_t binarylen, int lf)
+{
+    if (stream && binary && binarylen > 0)
+        return base64_encode_fp(stream, (const unsigned char *)binary, binarylen, lf);
+    return 0;
+}
+
+// base64_to_binary_buf --
+// Decode base64 string into the binary buffer.
+// binarylen is the buffer size on input and the decoded length on output.
+// The buffer size should be (base64len / 4 * 3 + 3) at least.
+ydb_res base64_to_binary_buf(char *base64, size_t base64len, unsigned char *binary, size_t *binarylen)
+{
+    if (!base64 || !binary || !binarylen)
+        return YDB_E_INVALID_ARGS;
+    if (base64len == 0)
+        base64len = strlen(base64);
+    if (*binarylen < base64_decode_len(base64len))
+        return YDB_E_FULL_BUF;
+    if (base64_decode_to((const unsigned char *)base64, base64len, binary, binarylen))
+        return YDB_E_INVALID_ARGS;
+    return YDB_OK;
+}
+
 // open local ydb (yaml data block)
 ydb *ydb_open(char *name)
 {
@@ -848,7 +936,9 @@ ydb *ydb_open(char *name)
     YDB_FAIL(!datablock, YDB_E_MEM_ALLOC);
     memset(datablock, 0x0, sizeof(ydb));
     datablock->epollfd = -1;
+    datablock->shmfd = -1;
     datablock->timeout = YDB_DEFAULT_TIMEOUT;
+    datablock->sendq_limit = YDB_SEND_QUEUE_LIMIT;
 
     datablock->name = ystrdup(name);
     YDB_FAIL(!datablock->name, YDB_E_CTRL);
@@ -905,6 +995,7 @@ static size_t formatting(bool no_var_args, FILE *fp, const char *format, va_list
 //   - uss://unix-socket-name (hidden unix socket; socket file doesn’t appear from filesystem.)
 //   - tcp://ipaddr:port (tcp)
 //   - fifo://named-fifo-input,named-fifo-output
+//   - shm://name (hidden unix socket notifying the published data in the shared memory ring (memfd))
 //  - flags:
 //    pub(publisher)/sub(subscriber): YDB role configuration
 //    w(writable): connect to the channel to write data in subscriber role.
@@ -982,6 +1073,46 @@ failed:
     return res;
 }
 
+// ydb_subscribe --
+// Subscribe the data change under the path from the YDB publisher.
+ydb_res ydb_subscribe(ydb *datablock, char *addr, char *path)
+{
+    ydb_res res = YDB_OK;
+    yconn *conn = NULL;
+    int pathlen;
+    char _addr[256];
+    ylog_in();
+    YDB_FAIL(!datablock || !path || path[0] != '/', YDB_E_INVALID_ARGS);
+    lock(datablock);
+    if (!addr)
+    {
+        snprintf(_addr, sizeof(_addr), "uss://%s", datablock->name);
+        addr = _addr;
+    }
+    conn = yconn_get(addr, datablock);
+    YDB_FAIL(!conn, YDB_E_NO_CONN);
+    YDB_FAIL(IS_SET(conn->flags, YCONN_ROLE_PUBLISHER), YDB_E_INVALID_ARGS);
+    pathlen = strlen(path);
+    while (pathlen > 1 && path[pathlen - 1] == '/')
+        pathlen--;
+    if (pathlen <= 1)
+        yconn_filter_clear(conn);
+    else
+        yconn_filter_add(conn, path, pathlen);
+    ylog_info("ydb[%s] subscribe %.*s from %s\n", datablock->name, pathlen, path, addr);
+    // re-initialize the connection to update the subscribed paths.
+    if (IS_SET(conn->flags, STATUS_CLIENT) && !IS_DISCONNECTED(conn))
+    {
+        eventid eid = yconn_init(conn);
+        if (valid_waitevent(eid))
+            yconn_serve_blocking(datablock, eid, datablock->timeout);
+    }
+failed:
+    unlock(datablock);
+    ylog_out();
+    return res;
+}
+
 // ydb_is_connected --
 // Check the YDB IPC channel connected or not.
 int ydb_is_connected(ydb *datablock, char *addr)
@@ -1104,6 +1235,11 @@ failed:
 
 // Close YAML Datablock
 static void ydb_read_hook_free(void *rhook);
+static void ydb_update_pool_destroy(struct ydb_update_pool *pool);
+static void ydb_journal_close(ydb *datablock);
+static void ydb_change_free(ydb *datablock);
+static void ydb_txn_free(ydb *datablock);
+static ydb_res ydb_txn_stage(ydb *datablock, yconn_op op, ynode *src, char *path);
 
 void ydb_close(ydb *datablock)
 {
@@ -1112,6 +1248,9 @@ void ydb_close(ydb *datablock)
     {
         YDB_INFO(datablock, "closed");
         lock(datablock);
+        ydb_txn_free(datablock);
+        ydb_journal_close(datablock);
+        ydb_change_free(datablock);
         ytrie_delete(ydb_pool, datablock->name, strlen(datablock->name));
         if (datablock->disconn)
             ylist_destroy_custom(datablock->disconn, (user_free)_yconn_free_with_deinit);
@@ -1121,6 +1260,8 @@ void ydb_close(ydb *datablock)
             ytimer_destroy(datablock->timer);
         if (datablock->event)
             ytree_destroy_custom(datablock->event, (user_free)waitevent_free);
+        if (datablock->rpool)
+            ydb_update_pool_destroy(datablock->rpool);
         if (datablock->updater)
             ytrie_destroy_custom(datablock->updater, (user_free)ydb_read_hook_free);
         if (datablock->top)
@@ -1129,6 +1270,7 @@ void ydb_close(ydb *datablock)
             yfree(datablock->name);
         if (datablock->epollfd > 0)
             close(datablock->epollfd);
+        yconn_shm_close(datablock);
 #ifdef PTHREAD_LOCK
         unlock(datablock);
         pthread_mutex_destroy(&datablock->lock);
@@ -1139,6 +1281,418 @@ void ydb_close(ydb *datablock)
     ylog_out();
 }
 
+// The published changes are numbered and kept in the ring (datablock->changes)
+// so that a reconnected subscriber receives only the changes it missed.
+struct ydb_change
+{
+    yconn_op op;
+    char *buf;
+    size_t buflen;
+};
+
+static void ydb_change_drop(ydb *datablock)
+{
+    struct ydb_change *c;
+    c = &datablock->changes[datablock->change_first % YDB_CHANGE_RING_SIZE];
+    datablock->change_bytes -= c->buflen;
+    if (c->buf)
+        free(c->buf);
+    c->buf = NULL;
+    c->buflen = 0;
+    datablock->change_first++;
+}
+
+static void ydb_change_free(ydb *datablock)
+{
+    if (!datablock->changes)
+        return;
+    while (datablock->change_first <= datablock->change_seq)
+        ydb_change_drop(datablock);
+    free(datablock->changes);
+    datablock->changes = NULL;
+}
+
+// ydb_change_push --
+// Number the change and keep it in the ring within YDB_CHANGE_RING_SIZE and YDB_CHANGE_RING_BYTES.
+static void ydb_change_push(ydb *datablock, yconn_op op, char *buf, size_t buflen)
+{
+    struct ydb_change *c;
+    if (!datablock->changes)
+    {
+        struct timespec ts;
+        // only for the datablock connected to others.
+        if (datablock->epollfd < 0)
+            return;
+        datablock->changes = calloc(YDB_CHANGE_RING_SIZE, sizeof(struct ydb_change));
+        if (!datablock->changes)
+            return;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        datablock->change_epoch = ((unsigned long long)ts.tv_sec << 30) ^ ts.tv_nsec ^
+                                  ((unsigned long long)getpid() << 16) ^ (uintptr_t)datablock;
+        if (!datablock->change_epoch)
+            datablock->change_epoch = 1;
+        datablock->change_first = datablock->change_seq + 1;
+    }
+    datablock->change_seq++;
+    datablock->pubchange = datablock->change_seq;
+    while (datablock->change_first < datablock->change_seq &&
+           (datablock->change_seq - datablock->change_first >= YDB_CHANGE_RING_SIZE ||
+            datablock->change_bytes + buflen > YDB_CHANGE_RING_BYTES))
+        ydb_change_drop(datablock);
+    c = &datablock->changes[datablock->change_seq % YDB_CHANGE_RING_SIZE];
+    c->buf = (buflen <= YDB_CHANGE_RING_BYTES) ? malloc(buflen) : NULL;
+    if (!c->buf)
+    {
+        // the change is not kept so that the older ones are not available.
+        while (datablock->change_first < datablock->change_seq)
+            ydb_change_drop(datablock);
+        datablock->change_first = datablock->change_seq + 1;
+        return;
+    }
+    memcpy(c->buf, buf, buflen);
+    c->buflen = buflen;
+    c->op = op;
+    datablock->change_bytes += buflen;
+}
+
+// The journal is a sequence of the changes (ynode_log) published by the datablock.
+// Each record is formatted to "#journal: <op> <len> <crc32>\n<data>\n".
+#define YDB_JOURNAL_HEAD "#journal: "
+
+struct ydb_journal
+{
+    char *jpath;          // <dir>/<name>.journal
+    char *spath;          // <dir>/<name>.snapshot
+    int fd;               // the journal opened for appending
+    size_t size;          // the journal size
+    size_t unsynced;      // the bytes appended but not fsync'ed yet
+    unsigned int timerid; // the timer for the batched fsync
+};
+
+static uint32_t ydb_crc32(const char *data, size_t len)
+{
+    static uint32_t table[256];
+    uint32_t crc = 0xffffffff;
+    size_t i;
+    if (!table[1])
+    {
+        uint32_t c, n, k;
+        for (n = 0; n < 256; n++)
+        {
+            c = n;
+            for (k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    for (i = 0; i < len; i++)
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffff;
+}
+
+static ydb_res ydb_journal_flush(struct ydb_journal *journal)
+{
+    if (journal->unsynced <= 0)
+        return YDB_OK;
+    if (fdatasync(journal->fd))
+    {
+        ylog_error("journal %s fsync failed (%s)\n", journal->jpath, strerror(errno));
+        return YDB_E_SYSTEM_FAILED;
+    }
+    journal->unsynced = 0;
+    return YDB_OK;
+}
+
+static ytimer_status ydb_journal_expire(ytimer *timer, unsigned int timer_id, ytimer_status status, void *user)
+{
+    ydb *datablock = user;
+    if (status == YTIMER_ABORTED)
+        return YTIMER_NO_ERR;
+    if (datablock->journal && datablock->journal->timerid == timer_id)
+    {
+        datablock->journal->timerid = 0;
+        ydb_journal_flush(datablock->journal);
+    }
+    return YTIMER_NO_ERR;
+}
+
+// ydb_journal_snapshot --
+// Write the datablock to the snapshot and then truncate the journal.
+// The snapshot is replaced by rename() so that it is not broken by a crash.
+static ydb_res ydb_journal_snapshot(ydb *datablock)
+{
+    FILE *fp;
+    int n, dirfd;
+    char *tmppath, *dir;
+    struct ydb_journal *journal = datablock->journal;
+    tmppath = malloc(strlen(journal->spath) + 8);
+    if (!tmppath)
+        return YDB_E_MEM_ALLOC;
+    sprintf(tmppath, "%s.tmp", journal->spath);
+    fp = fopen(tmppath, "w");
+    if (!fp)
+    {
+        free(tmppath);
+        return YDB_E_SYSTEM_FAILED;
+    }
+    n = ynode_printf_to_fp(fp, datablock->top, 1, YDB_LEVEL_MAX);
+    if (n < 0 || fflush(fp) || fsync(fileno(fp)))
+    {
+        fclose(fp);
+        unlink(tmppath);
+        free(tmppath);
+        return YDB_E_SYSTEM_FAILED;
+    }
+    fclose(fp);
+    if (rename(tmppath, journal->spath))
+    {
+        unlink(tmppath);
+        free(tmppath);
+        return YDB_E_SYSTEM_FAILED;
+    }
+    free(tmppath);
+    // make the rename durable before the journal is truncated.
+    dir = strdup(journal->spath);
+    if (dir)
+    {
+        char *slash = strrchr(dir, '/');
+        if (slash)
+            *slash = 0;
+        dirfd = open(slash ? dir : ".", O_RDONLY | O_DIRECTORY);
+        if (dirfd >= 0)
+        {
+            fsync(dirfd);
+            close(dirfd);
+        }
+        free(dir);
+    }
+    if (ftruncate(journal->fd, 0) || fsync(journal->fd))
+        return YDB_E_SYSTEM_FAILED;
+    journal->size = 0;
+    journal->unsynced = 0;
+    ylog_info("ydb[%s] journal compacted into %s\n", datablock->name, journal->spath);
+    return YDB_OK;
+}
+
+// ydb_journal_append --
+// Append a change to the journal. The fsync is batched by YDB_JOURNAL_SYNC_SIZE
+// and YDB_JOURNAL_SYNC_MSEC, and the journal is compacted by YDB_JOURNAL_COMPACT_SIZE.
+static void ydb_journal_append(ydb *datablock, yconn_op op, char *buf, size_t buflen)
+{
+    int headlen;
+    ssize_t n;
+    char head[96];
+    struct iovec iov[3];
+    struct ydb_journal *journal = datablock->journal;
+    if (!journal || !buf || buflen <= 0)
+        return;
+    headlen = sprintf(head, YDB_JOURNAL_HEAD "%s %zu %08x\n",
+                      yconn_op_str[op], buflen, ydb_crc32(buf, buflen));
+    iov[0].iov_base = head;
+    iov[0].iov_len = headlen;
+    iov[1].iov_base = buf;
+    iov[1].iov_len = buflen;
+    iov[2].iov_base = "\n";
+    iov[2].iov_len = 1;
+    n = writev(journal->fd, iov, 3);
+    if (n != (ssize_t)(headlen + buflen + 1))
+    {
+        ylog_error("ydb[%s] journal %s write failed (%s)\n",
+                   datablock->name, journal->jpath, strerror(errno));
+        if (n > 0)
+            journal->size += n;
+        return;
+    }
+    journal->size += n;
+    journal->unsynced += n;
+    if (journal->size >= YDB_JOURNAL_COMPACT_SIZE)
+        ydb_journal_snapshot(datablock);
+    else if (journal->unsynced >= YDB_JOURNAL_SYNC_SIZE)
+        ydb_journal_flush(journal);
+    else if (!journal->timerid)
+        journal->timerid = ytimer_set_msec(datablock->timer, YDB_JOURNAL_SYNC_MSEC, false,
+                                           (ytimer_func)ydb_journal_expire, 1, datablock);
+}
+
+// ydb_journal_replay --
+// Apply the journal records to the datablock and return the size of the valid records.
+// The records after a broken (partially written) record are discarded.
+static size_t ydb_journal_replay(ydb *datablock, struct ydb_journal *journal)
+{
+    FILE *fp;
+    char *buf, *p, *end;
+    size_t buflen = 0, n;
+    int num = 0;
+    fp = fopen(journal->jpath, "r");
+    if (!fp)
+        return 0;
+    fseek(fp, 0, SEEK_END);
+    buflen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(buflen + 1);
+    if (!buf)
+    {
+        fclose(fp);
+        return 0;
+    }
+    n = fread(buf, 1, buflen, fp);
+    fclose(fp);
+    buf[n] = 0;
+    p = buf;
+    end = buf + n;
+    while (p < end)
+    {
+        char opstr[32];
+        char *data;
+        size_t datalen;
+        unsigned int crc;
+        yconn_op op;
+        data = memchr(p, '\n', end - p);
+        if (!data)
+            break;
+        data++;
+        if (sscanf(p, YDB_JOURNAL_HEAD "%31s %zu %x\n", opstr, &datalen, &crc) != 3)
+            break;
+        if (datalen >= (size_t)(end - data) || data[datalen] != '\n')
+            break;
+        if (ydb_crc32(data, datalen) != crc)
+            break;
+        data[datalen] = 0;
+        op = ydb_get_yop(opstr);
+        if (op == YOP_MERGE)
+            ydb_parses(datablock, data, datalen);
+        else if (op == YOP_DELETE)
+            ydb_rm(datablock, data);
+        p = data + datalen + 1;
+        num++;
+    }
+    n = p - buf;
+    if (n < (size_t)(end - buf))
+        ylog_error("ydb[%s] journal %s broken at %zu (discarded %zu bytes)\n",
+                   datablock->name, journal->jpath, n, (size_t)(end - buf) - n);
+    ylog_info("ydb[%s] journal %s replayed (%d records)\n",
+              datablock->name, journal->jpath, num);
+    free(buf);
+    return n;
+}
+
+static void ydb_journal_free(struct ydb_journal *journal)
+{
+    if (!journal)
+        return;
+    if (journal->fd >= 0)
+        close(journal->fd);
+    if (journal->jpath)
+        free(journal->jpath);
+    if (journal->spath)
+        free(journal->spath);
+    free(journal);
+}
+
+static void ydb_journal_close(ydb *datablock)
+{
+    struct ydb_journal *journal = datablock->journal;
+    if (!journal)
+        return;
+    datablock->journal = NULL;
+    if (journal->timerid && datablock->timer)
+        ytimer_delete(datablock->timer, journal->timerid);
+    ydb_journal_flush(journal);
+    ydb_journal_free(journal);
+}
+
+ydb *ydb_open_persistent(char *name, char *dir)
+{
+    FILE *fp;
+    ydb *datablock;
+    size_t len;
+    struct ydb_journal *journal;
+    if (!name)
+        return NULL;
+    if (!dir)
+        dir = ".";
+    datablock = ydb_open(name);
+    if (!datablock)
+        return NULL;
+    lock(datablock);
+    if (datablock->journal)
+    {
+        unlock(datablock);
+        return datablock;
+    }
+    journal = malloc(sizeof(struct ydb_journal));
+    if (!journal)
+        goto failed;
+    memset(journal, 0x0, sizeof(struct ydb_journal));
+    journal->fd = -1;
+    len = strlen(dir) + strlen(name) + 16;
+    journal->jpath = malloc(len);
+    journal->spath = malloc(len);
+    if (!journal->jpath || !journal->spath)
+        goto failed;
+    sprintf(journal->jpath, "%s/%s.journal", dir, name);
+    sprintf(journal->spath, "%s/%s.snapshot", dir, name);
+
+    // restore the data from the snapshot and the journal.
+    fp = fopen(journal->spath, "r");
+    if (fp)
+    {
+        ydb_res res = ydb_parse(datablock, fp);
+        fclose(fp);
+        if (res)
+        {
+            ylog_error("ydb[%s] snapshot %s failed (%s)\n",
+                       datablock->name, journal->spath, ydb_res_str(res));
+            goto failed;
+        }
+    }
+    journal->size = ydb_journal_replay(datablock, journal);
+    journal->fd = open(journal->jpath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journal->fd < 0)
+        goto failed;
+    // discard the broken records at the end of the journal.
+    if (ftruncate(journal->fd, journal->size))
+        goto failed;
+    datablock->journal = journal;
+    unlock(datablock);
+    return datablock;
+failed:
+    ylog_error("ydb[%s] persistent storage in %s failed (%s)\n",
+               name, dir, strerror(errno));
+    ydb_journal_free(journal);
+    unlock(datablock);
+    ydb_close(datablock);
+    return NULL;
+}
+
+ydb_res ydb_journal_sync(ydb *datablock)
+{
+    ydb_res res;
+    if (!datablock)
+        return YDB_E_INVALID_ARGS;
+    lock(datablock);
+    if (datablock->journal)
+        res = ydb_journal_flush(datablock->journal);
+    else
+        res = YDB_E_NO_ENTRY;
+    unlock(datablock);
+    return res;
+}
+
+ydb_res ydb_journal_compact(ydb *datablock)
+{
+    ydb_res res;
+    if (!datablock)
+        return YDB_E_INVALID_ARGS;
+    lock(datablock);
+    if (datablock->journal)
+        res = ydb_journal_snapshot(datablock);
+    else
+        res = YDB_E_NO_ENTRY;
+    unlock(datablock);
+    return res;
+}
+
 ydb *ydb_get(char *name_and_path, ynode **node)
 {
     ydb *datablock;
@@ -1343,6 +1897,12 @@ const char *ydb_value(ynode *node)
     return ynode_value(node);
 }
 
+// return node binary data if that is a binary leaf.
+const void *ydb_blob(ynode *node, size_t *len)
+{
+    return ynode_blob(node, len);
+}
+
 // return node key if that has a hash key.
 const char *ydb_key(ynode *node)
 {
@@ -1374,7 +1934,7 @@ char *ydb_ynode2yaml(ydb *datablock, ynode *node, int *slen)
     }
     int level = ynode_level(datablock->top, node);
     if (level == 0 && ynode_type(datablock->top) == YNODE_TYPE_VAL)
-        fprintf(fp, "%s", ynode_value(node));
+        ynode_fprintf_value(fp, node);
     else
         ynode_printf_to_fp(fp, node, 1 - level, 0);
     if (fp)
@@ -1427,6 +1987,12 @@ ydb_res ydb_parse(ydb *datablock, FILE *stream)
         ynode *top;
         ynode_log *log = NULL;
         lock(datablock);
+        if (datablock->txn)
+        {
+            res = ydb_txn_stage(datablock, YOP_MERGE, src, NULL);
+            src = NULL;
+            goto failed;
+        }
         log = ydb_log_open(datablock, NULL);
         top = ynode_merge(datablock->top, src, log);
         ydb_log_close(datablock, log, &buf, &buflen);
@@ -1462,6 +2028,12 @@ ydb_res ydb_parses(ydb *datablock, char *buf, size_t buflen)
         ynode *top;
         ynode_log *log = NULL;
         lock(datablock);
+        if (datablock->txn)
+        {
+            res = ydb_txn_stage(datablock, YOP_MERGE, src, NULL);
+            src = NULL;
+            goto failed;
+        }
         log = ydb_log_open(datablock, NULL);
         top = ynode_merge(datablock->top, src, log);
         ydb_log_close(datablock, log, &ibuf, &ibuflen);
@@ -1476,7 +2048,7 @@ ydb_res ydb_parses(ydb *datablock, char *buf, size_t buflen)
         }
     }
 failed:
-    lock(datablock);
+    unlock(datablock);
     CLEAR_BUF(ibuf, ibuflen);
     ynode_remove(src);
     ylog_out();
@@ -1490,7 +2062,7 @@ int ydb_dump(ydb *datablock, FILE *stream)
         return -1;
     lock(datablock);
     if (ynode_type(datablock->top) == YNODE_TYPE_VAL)
-        len = fprintf(stream, "%s", ynode_value(datablock->top));
+        len = ynode_fprintf_value(stream, datablock->top);
     else
         len = ynode_printf_to_fp(stream, datablock->top, 1, YDB_LEVEL_MAX);
     unlock(datablock);
@@ -1556,6 +2128,12 @@ ydb_res ydb_write(ydb *datablock, const char *format, ...)
         YDB_FAIL(res || !src, res);
         CLEAR_BUF(buf, buflen);
         lock(datablock);
+        if (datablock->txn)
+        {
+            res = ydb_txn_stage(datablock, YOP_MERGE, src, NULL);
+            src = NULL;
+            goto failed;
+        }
         log = ydb_log_open(datablock, NULL);
         // ynode_dump(src, 0, 24);
         top = ynode_merge(datablock->top, src, log);
@@ -1690,6 +2268,12 @@ ydb_res ydb_delete(ydb *datablock, const char *format, ...)
         YDB_FAIL(res || !src, res);
         CLEAR_BUF(buf, buflen);
         lock(datablock);
+        if (datablock->txn)
+        {
+            res = ydb_txn_stage(datablock, YOP_DELETE, src, NULL);
+            src = NULL;
+            goto failed;
+        }
         ddata.log = ydb_log_open(datablock, NULL);
         ddata.node = datablock->top;
         flags = YNODE_LEAF_FIRST | YNODE_LEAF_ONLY; // YNODE_VAL_ONLY;
@@ -1736,6 +2320,12 @@ ydb_res ydb_rm(ydb *datablock, char *s)
         res = ynode_scanf_from_buf(s, slen, 0, &src);
         YDB_FAIL(res || !src, res);
         lock(datablock);
+        if (datablock->txn)
+        {
+            res = ydb_txn_stage(datablock, YOP_DELETE, src, NULL);
+            src = NULL;
+            goto failed;
+        }
         ddata.log = ydb_log_open(datablock, NULL);
         ddata.node = datablock->top;
         flags = YNODE_LEAF_FIRST | YNODE_LEAF_ONLY; // YNODE_VAL_ONLY;
@@ -1767,6 +2357,7 @@ struct readhook
         ydb_read_hook3 hook3;
         ydb_read_hook4 hook4;
     };
+    bool parallel; // run concurrently with the other read hooks
     int num;
     void *user[];
 };
@@ -1775,21 +2366,24 @@ struct ydb_update_params
 {
     yconn *src_conn;
     ydb *datablock;
-    struct readhook *rhook;
+    ytree *rhooks;
+    char *path; // the path of the current level
+    int pathsize;
+    bool found;
     bool updated;
 };
 
-static ydb_res ydb_update_rhook_exec(struct ydb_update_params *params, struct readhook *rhook)
+// ydb_update_rhook_exec --
+// run a read hook into its own stream and scan the result to a separated ynode.
+// The result is not merged to the datablock here.
+static ydb_res ydb_update_rhook_exec(ydb *datablock, struct readhook *rhook, ynode **src)
 {
-    ydb_res res;
+    ydb_res res = YDB_OK;
     FILE *fp;
     char *buf = NULL;
     size_t buflen = 0;
-    ynode *src = NULL;
-    ynode *top = NULL;
-    ynode_log *log = NULL;
-    ydb *datablock = params->datablock;
 
+    ylog_info("ydb[%s] read hook (%s) found\n", datablock->name, rhook->path);
     fp = open_memstream(&buf, &buflen);
     if (fp)
     {
@@ -1818,113 +2412,413 @@ static ydb_res ydb_update_rhook_exec(struct ydb_update_params *params, struct re
         }
         fclose(fp);
     }
-    res = ynode_scanf_from_buf(buf, buflen, 0, &src);
+    res = ynode_scanf_from_buf(buf, buflen, 0, src);
     CLEAR_BUF(buf, buflen);
     if (res)
     {
-        ynode_remove(src);
-        return res;
-    }
-    if (!src)
-        return YDB_OK;
-
-    log = ydb_log_open(datablock, NULL);
-    top = ynode_merge(datablock->top, src, log);
-    ydb_log_close(datablock, log, &buf, &buflen);
-    ynode_remove(src);
-    if (top)
-    {
-        datablock->top = top;
-        yconn_publish(params->src_conn, NULL, datablock, YOP_MERGE, buf, buflen);
-        params->updated = true;
+        ynode_remove(*src);
+        *src = NULL;
     }
-    else
-        res = YDB_E_MERGE_FAILED;
-    CLEAR_BUF(buf, buflen);
     return res;
 }
 
-static ydb_res ydb_update_sub(ynode *cur, void *addition)
+#define YDB_UPDATE_THREAD_MAX 4
+
+// The read hooks executed by ydb_update.
+struct ydb_update_hooks
 {
-    ydb_res res = YDB_OK;
-    struct ydb_update_params *params = addition;
-    ydb *datablock = params->datablock;
-    struct readhook *rhook = NULL;
+    ydb *datablock;
+    struct readhook **rhooks;
+    ynode **srcs;   // the result of each read hook
+    int num;
+    int *parallel;  // the indexes of the read hooks run concurrently
+    int parallelnum;
+    int next;       // the next parallel read hook to be taken by a thread
+};
 
-    int pathlen = 0;
-    char *path = ydb_path(datablock, cur, &pathlen);
-    if (!path)
+// The worker threads of a datablock running the parallel read hooks.
+// The threads are created by the first parallel read hook and
+// kept until the datablock is closed.
+struct ydb_update_pool
+{
+    pthread_t tids[YDB_UPDATE_THREAD_MAX - 1];
+    int threads;
+    pthread_mutex_t run;   // held by the reading thread during the fan-out
+    pthread_mutex_t mutex; // protects the fields below
+    pthread_cond_t wakeup;
+    pthread_cond_t idle;
+    struct ydb_update_hooks *job;
+    unsigned long round; // increased for each job
+    int busy;            // the threads running the job
+    bool quit;
+};
+
+static void ydb_update_rhook_one(struct ydb_update_hooks *uhooks, int i)
+{
+    ydb_res res;
+    struct readhook *rhook = uhooks->rhooks[i];
+    res = ydb_update_rhook_exec(uhooks->datablock, rhook, &uhooks->srcs[i]);
+    if (res)
+        ylog_error("ydb[%s] read hook (%s) failed with %s\n",
+                   uhooks->datablock->name, rhook->path, ydb_res_str(res));
+}
+
+// ydb_update_rhook_run --
+// Take and run the parallel read hooks until all of them are taken.
+static void ydb_update_rhook_run(struct ydb_update_hooks *uhooks)
+{
+    while (1)
     {
-        path = strdup("/");
-        pathlen = 1;
+        int i = __atomic_fetch_add(&uhooks->next, 1, __ATOMIC_RELAXED);
+        if (i >= uhooks->parallelnum)
+            break;
+        ydb_update_rhook_one(uhooks, uhooks->parallel[i]);
+    }
+}
+
+static void *ydb_update_pool_worker(void *arg)
+{
+    struct ydb_update_pool *pool = arg;
+    unsigned long served = 0;
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->quit)
+    {
+        struct ydb_update_hooks *job = pool->job;
+        if (!job || pool->round == served)
+        {
+            pthread_cond_wait(&pool->wakeup, &pool->mutex);
+            continue;
+        }
+        served = pool->round;
+        pool->busy++;
+        pthread_mutex_unlock(&pool->mutex);
+        ydb_update_rhook_run(job);
+        pthread_mutex_lock(&pool->mutex);
+        pool->busy--;
+        if (pool->busy == 0)
+            pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+static void ydb_update_pool_destroy(struct ydb_update_pool *pool)
+{
+    int i;
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->mutex);
+    for (i = 0; i < pool->threads; i++)
+        pthread_join(pool->tids[i], NULL);
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->wakeup);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_mutex_destroy(&pool->run);
+    free(pool);
+}
+
+static struct ydb_update_pool *ydb_update_pool_create(void)
+{
+    int i;
+    struct ydb_update_pool *pool = malloc(sizeof(struct ydb_update_pool));
+    if (!pool)
+        return NULL;
+    memset(pool, 0x0, sizeof(struct ydb_update_pool));
+    pthread_mutex_init(&pool->run, NULL);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wakeup, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    for (i = 0; i < YDB_UPDATE_THREAD_MAX - 1; i++)
+    {
+        if (pthread_create(&pool->tids[i], NULL, ydb_update_pool_worker, pool))
+            break;
+        pool->threads++;
+    }
+    if (pool->threads <= 0)
+    {
+        ydb_update_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+// ydb_update_rhook_fanout --
+// Run the serial read hooks on the caller's thread and the parallel read hooks
+// on the worker threads and the caller's thread. The parallel read hooks are
+// run by the caller's thread only if the pool is not available or used by
+// another read (e.g. a read from a read hook).
+static void ydb_update_rhook_fanout(struct ydb_update_pool *pool, struct ydb_update_hooks *uhooks)
+{
+    int i, p = 0;
+    bool fanout = false;
+    if (pool && uhooks->parallelnum > 1 && pthread_mutex_trylock(&pool->run) == 0)
+    {
+        fanout = true;
+        pthread_mutex_lock(&pool->mutex);
+        pool->job = uhooks;
+        pool->round++;
+        pthread_cond_broadcast(&pool->wakeup);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    for (i = 0; i < uhooks->num; i++)
+    {
+        if (p < uhooks->parallelnum && uhooks->parallel[p] == i)
+            p++;
+        else
+            ydb_update_rhook_one(uhooks, i);
     }
-    if (path && pathlen > 0)
+    ydb_update_rhook_run(uhooks);
+    if (fanout)
     {
-        ylog_info("ydb[%s] path=%s\n", datablock->name, path);
-        ylist *child_rhooks = ytrie_search_range(datablock->updater, path, pathlen);
-        if (ylist_size(child_rhooks) > 0)
+        pthread_mutex_lock(&pool->mutex);
+        pool->job = NULL;
+        while (pool->busy > 0)
+            pthread_cond_wait(&pool->idle, &pool->mutex);
+        pthread_mutex_unlock(&pool->mutex);
+        pthread_mutex_unlock(&pool->run);
+    }
+}
+
+// ydb_update_path_push --
+// Append the path segment (/key or /index) of the node to params->path
+// and then return the new path length.
+static int ydb_update_path_push(struct ydb_update_params *params, int len, ynode *node, int index)
+{
+    int n, is_new = 0;
+    char *key = NULL;
+    switch (ynode_type(ynode_up(node)))
+    {
+    case YNODE_TYPE_LIST:
+        break;
+    case YNODE_TYPE_MAP:
+    case YNODE_TYPE_SET:
+    case YNODE_TYPE_IMAP:
+    case YNODE_TYPE_OMAP:
+        key = to_yaml(ynode_key(node), -1, &is_new, 1);
+        if (!key)
+            return -1;
+        break;
+    default:
+        return len;
+    }
+    while (1)
+    {
+        if (key)
+            n = snprintf(params->path + len, params->pathsize - len, "/%s", key);
+        else
+            n = snprintf(params->path + len, params->pathsize - len, "/%d", index);
+        if (len + n < params->pathsize)
+            break;
+        char *path = realloc(params->path, (len + n + 1) * 2);
+        if (!path)
+        {
+            n = -1 - len;
+            break;
+        }
+        params->path = path;
+        params->pathsize = (len + n + 1) * 2;
+    }
+    if (is_new)
+        free(key);
+    return len + n;
+}
+
+// ydb_update_sub --
+// Collect the read hooks for the leaves of the target during the descent.
+// The path of each level is built incrementally in params->path and
+// the subtree without any read hook under its path is not visited.
+static void ydb_update_sub(struct ydb_update_params *params, ynode *target, int len)
+{
+    ydb *datablock = params->datablock;
+    struct readhook *rhook = NULL;
+    int matched_len = 0;
+    int levels = 16, level, prev_level = 0;
+    int *lens, *index; // the path length and the child index of each level
+    ynode_iter niter;
+    ytrie_iter iter;
+    ynode *cur;
+
+    lens = malloc(sizeof(int) * levels * 2);
+    if (!lens)
+        return;
+    index = lens + levels;
+    lens[0] = len;
+    index[0] = 0;
+    for (cur = ynode_iter_begin(&niter, target, YNODE_NO_FLAG); cur; cur = ynode_iter_next(&niter))
+    {
+        char *path = params->path;
+        int pathlen;
+        level = niter.level;
+        if (level >= levels)
+        {
+            int *newlens = malloc(sizeof(int) * levels * 4);
+            if (!newlens)
+                break;
+            memcpy(newlens, lens, sizeof(int) * levels);
+            memcpy(newlens + levels * 2, index, sizeof(int) * levels);
+            free(lens);
+            lens = newlens;
+            levels *= 2;
+            index = lens + levels;
+        }
+        if (level > 0)
+        {
+            // The first child of the level follows its parent in the pre-order.
+            index[level] = (level > prev_level) ? 0 : index[level] + 1;
+            lens[level] = ydb_update_path_push(params, lens[level - 1], cur, index[level]);
+            if (lens[level] < 0)
+                break;
+            path = params->path;
+        }
+        prev_level = level;
+        pathlen = lens[level];
+        if (pathlen <= 0)
+        {
+            path = "/";
+            pathlen = 1;
+        }
+        if (ynode_down(cur))
         {
-            while (!ylist_empty(child_rhooks))
+            // stop at the first read hook under the path.
+            if (!ytrie_iter_prefix_begin(datablock->updater, &iter, path, pathlen))
             {
-                rhook = ylist_pop_front(child_rhooks);
+                // The best matched hook of all descendants is the same.
+                rhook = ytrie_best_match(datablock->updater, path, pathlen, &matched_len);
                 if (rhook)
-                {
-                    ylog_info("ydb[%s] read hook (%s) found\n", datablock->name, rhook->path);
-                    res = ydb_update_rhook_exec(params, rhook);
-                    if (res)
-                        ylog_error("ydb[%s] read hook (%s) failed with %s\n",
-                                   datablock->name, rhook->path, ydb_res_str(res));
-                }
+                    ytree_insert(params->rhooks, (void *)rhook->path, rhook);
+                ynode_iter_skip(&niter);
             }
+            continue;
         }
-        else
+        ylog_info("ydb[%s] path=%.*s\n", datablock->name, pathlen, path);
+        params->found = false;
+        rhook = ytrie_iter_prefix_begin(datablock->updater, &iter, path, pathlen);
+        for (; rhook; rhook = ytrie_iter_prefix_next(datablock->updater, &iter))
+        {
+            ytree_insert(params->rhooks, (void *)rhook->path, rhook);
+            params->found = true;
+        }
+        if (!params->found)
         {
-            int matched_len = 0;
             rhook = ytrie_best_match(datablock->updater, path, pathlen, &matched_len);
-            if (rhook != params->rhook)
-            {
-                if (params->rhook)
-                {
-                    // run rhook before change rhook
-                    ylog_info("ydb[%s] read hook (%s) found\n", datablock->name, params->rhook->path);
-                    res = ydb_update_rhook_exec(params, params->rhook);
-                    if (res)
-                        ylog_error("ydb[%s] read hook (%s) failed with %s\n",
-                                   datablock->name, params->rhook->path, ydb_res_str(res));
-                }
-                params->rhook = rhook;
-            }
+            if (rhook)
+                ytree_insert(params->rhooks, (void *)rhook->path, rhook);
         }
-        if (child_rhooks)
-            ylist_destroy(child_rhooks);
     }
-    if (path)
-        free(path);
-    return YDB_OK;
+    free(lens);
 }
 
+// ydb_update --
+// update the target nodes of the datablock using the read hooks.
+// The read hooks are collected (deduplicated by path) before running,
+// the parallel read hooks are run concurrently by up to YDB_UPDATE_THREAD_MAX
+// threads, each hook output is scanned independently and then all of them
+// are merged in path order within a single ynode_log and published once.
 bool ydb_update(yconn *src_conn, ydb *datablock, ynode *target)
 {
-    ydb_res res = YDB_OK;
+    int i;
     struct ydb_update_params params;
+    struct ydb_update_hooks uhooks;
+    ytree_iter *iter;
+    ynode_log *log = NULL;
+    char *buf = NULL;
+    size_t buflen = 0;
+    int pathlen = 0;
+
+    if (!target || ytrie_size(datablock->updater) <= 0)
+        return false;
     params.src_conn = src_conn;
     params.datablock = datablock;
     params.updated = false;
-    params.rhook = NULL;
-    ynode_traverse(target, ydb_update_sub, &params, YNODE_LEAF_ONLY);
-    if (params.rhook)
+    params.found = false;
+    params.path = ydb_path(datablock, target, &pathlen);
+    if (!params.path)
+        return false;
+    if (pathlen <= 0) // root
+        params.path[0] = 0;
+    params.pathsize = strlen(params.path) + 1;
+    params.rhooks = ytree_create((ytree_cmp)strcmp, NULL);
+    if (!params.rhooks)
     {
-        // run the last rhook.
-        ylog_info("ydb[%s] read hook (%s) found\n", datablock->name, params.rhook->path);
-        res = ydb_update_rhook_exec(&params, params.rhook);
-        if (res)
-            ylog_error("ydb[%s] read hook (%s) failed with %s\n",
-                       datablock->name, params.rhook->path, ydb_res_str(res));
+        free(params.path);
+        return false;
+    }
+    ydb_update_sub(&params, target, pathlen);
+    free(params.path);
+    if (ytree_size(params.rhooks) <= 0)
+    {
+        ytree_destroy(params.rhooks);
+        return false;
     }
+
+    memset(&uhooks, 0x0, sizeof(uhooks));
+    uhooks.datablock = datablock;
+    uhooks.num = ytree_size(params.rhooks);
+    uhooks.rhooks = malloc(sizeof(struct readhook *) * uhooks.num);
+    uhooks.srcs = calloc(uhooks.num, sizeof(ynode *));
+    uhooks.parallel = malloc(sizeof(int) * uhooks.num);
+    if (!uhooks.rhooks || !uhooks.srcs || !uhooks.parallel)
+    {
+        ylog_error("ydb[%s] read hook failed with %s\n",
+                   datablock->name, ydb_res_str(YDB_E_MEM_ALLOC));
+        goto failed;
+    }
+    i = 0;
+    for (iter = ytree_first(params.rhooks); iter; iter = ytree_next(params.rhooks, iter))
+    {
+        struct readhook *rhook = ytree_data(iter);
+        if (rhook->parallel)
+            uhooks.parallel[uhooks.parallelnum++] = i;
+        uhooks.rhooks[i++] = rhook;
+    }
+    ydb_update_rhook_fanout(datablock->rpool, &uhooks);
+
+    for (i = 0; i < uhooks.num; i++)
+    {
+        ynode *top;
+        if (!uhooks.srcs[i])
+            continue;
+        if (!log)
+            log = ydb_log_open(datablock, NULL);
+        top = ynode_merge(datablock->top, uhooks.srcs[i], log);
+        if (top)
+        {
+            datablock->top = top;
+            params.updated = true;
+        }
+        else
+            ylog_error("ydb[%s] read hook merge failed with %s\n",
+                       datablock->name, ydb_res_str(YDB_E_MERGE_FAILED));
+    }
+    if (log)
+    {
+        ydb_log_close(datablock, log, &buf, &buflen);
+        if (params.updated)
+            yconn_publish(src_conn, NULL, datablock, YOP_MERGE, buf, buflen);
+        CLEAR_BUF(buf, buflen);
+    }
+failed:
+    if (uhooks.srcs)
+    {
+        for (i = 0; i < uhooks.num; i++)
+        {
+            if (uhooks.srcs[i])
+                ynode_remove(uhooks.srcs[i]);
+        }
+        free(uhooks.srcs);
+    }
+    if (uhooks.rhooks)
+        free(uhooks.rhooks);
+    if (uhooks.parallel)
+        free(uhooks.parallel);
+    ytree_destroy(params.rhooks);
     return params.updated;
 }
 
-ydb_res ydb_read_hook_add(ydb *datablock, char *path, ydb_read_hook func, int num, ...)
+ydb_res ydb_read_hook_add(ydb *datablock, char *path, int parallel, ydb_read_hook func, int num, ...)
 {
     ydb_res res = YDB_OK;
     int pathlen;
@@ -1948,6 +2842,7 @@ ydb_res ydb_read_hook_add(ydb *datablock, char *path, ydb_read_hook func, int nu
     rhook->hook = func;
     rhook->path = ystrdup(newpath);
     rhook->pathlen = pathlen;
+    rhook->parallel = parallel ? true : false;
     rhook->num = num;
     {
         int i;
@@ -1963,6 +2858,9 @@ ydb_res ydb_read_hook_add(ydb *datablock, char *path, ydb_read_hook func, int nu
         va_end(ap);
     }
     lock(datablock);
+    // The worker threads are created by the first parallel read hook.
+    if (rhook->parallel && !datablock->rpool)
+        datablock->rpool = ydb_update_pool_create();
     oldhook = ytrie_insert(datablock->updater, rhook->path, rhook->pathlen, rhook);
     if (oldhook)
     {
@@ -2067,10 +2965,21 @@ static ydb_res ydb_read_sub(ynode *cur, void *addition)
             sscanf(ynode_value(n), &(value[4]), p);
 #else
             int len = strlen(value);
-            if (value[len - 1] == 's')
-                strcpy(p, ynode_value(n));
+            const void *blob;
+            size_t bloblen = 0;
+            const char *nval;
+            // the binary leaf is encoded into the buffer without the cache.
+            blob = ynode_blob(n, &bloblen);
+            if (blob && value[len - 1] == 's')
+                base64_encode_to(blob, bloblen, (unsigned char *)p, 0);
             else
-                sscanf(ynode_value(n), &(value[4]), p);
+            {
+                nval = ynode_value(n);
+                if (value[len - 1] == 's')
+                    strcpy(p, nval ? nval : "");
+                else if (nval)
+                    sscanf(nval, &(value[4]), p);
+            }
 #endif
             data->varnum++;
         }
@@ -2269,6 +3178,13 @@ ydb_res ydb_path_write(ydb *datablock, const char *format, ...)
     fclose(fp);
 
     lock(datablock);
+    if (datablock->txn)
+    {
+        src = ynode_create_path(pathbuf, NULL, NULL);
+        YDB_FAIL(!src, YDB_E_MERGE_FAILED);
+        res = ydb_txn_stage(datablock, YOP_MERGE, ynode_top(src), NULL);
+        goto failed;
+    }
     {
         char *rbuf = NULL;
         size_t rbuflen = 0;
@@ -2291,12 +3207,35 @@ failed:
     return res;
 }
 
+static ydb_res ydb_path_delete_node(ydb *datablock, char *path, ynode_log *log)
+{
+    ynode *target = ynode_search(datablock->top, path);
+    if (!target)
+        return YDB_W_NON_EXISTENT_DATA;
+    if (target == datablock->top)
+    {
+        ynode *n = ynode_down(datablock->top);
+        while (n)
+        {
+            // The root should not be deleted.
+            ynode_delete(n, log);
+            n = ynode_down(datablock->top);
+        }
+    }
+    else
+    {
+        if (ynode_index(target) > 0)
+            return YDB_E_DENIED_DELETE;
+        ynode_delete(target, log);
+    }
+    return YDB_OK;
+}
+
 // delete the ydb using input path
 // ydb_path_delete(datablock, "/path/to/update\n")
 ydb_res ydb_path_delete(ydb *datablock, const char *format, ...)
 {
     ydb_res res = YDB_OK;
-    ynode *target = NULL;
     FILE *fp;
     char *buf = NULL;
     size_t buflen = 0;
@@ -2313,42 +3252,194 @@ ydb_res ydb_path_delete(ydb *datablock, const char *format, ...)
     fclose(fp);
 
     lock(datablock);
+    if (datablock->txn)
+    {
+        res = ydb_txn_stage(datablock, YOP_DELETE, NULL, buf);
+        buf = NULL;
+        buflen = 0;
+        goto failed;
+    }
     {
         char *rbuf = NULL;
         size_t rbuflen = 0;
         ynode_log *log = NULL;
         log = ydb_log_open(datablock, NULL);
-        target = ynode_search(datablock->top, buf);
-        if (target)
+        res = ydb_path_delete_node(datablock, buf, log);
+        ydb_log_close(datablock, log, &rbuf, &rbuflen);
+        if (rbuf)
         {
-            if (target == datablock->top) {
-                ynode *n = ynode_down(datablock->top);
-                while (n)
+            if (rbuflen > 0)
+                yconn_publish(NULL, NULL, datablock, YOP_DELETE, rbuf, rbuflen);
+            free(rbuf);
+        }
+    }
+failed:
+    unlock(datablock);
+    CLEAR_BUF(buf, buflen);
+    ylog_out();
+    return res;
+}
+
+// A staged change of the transaction
+struct ydb_txn_op
+{
+    yconn_op op;
+    ynode *src; // the data to be merged or deleted
+    char *path; // the path to be deleted (ydb_path_delete)
+};
+
+static void ydb_txn_op_free(struct ydb_txn_op *txnop)
+{
+    if (!txnop)
+        return;
+    ynode_remove(txnop->src);
+    if (txnop->path)
+        free(txnop->path);
+    free(txnop);
+}
+
+static void ydb_txn_free(ydb *datablock)
+{
+    if (!datablock->txn)
+        return;
+    ylist_destroy_custom(datablock->txn, (user_free)ydb_txn_op_free);
+    datablock->txn = NULL;
+    unlock(datablock); // the lock held by ydb_txn_begin
+}
+
+// ydb_txn_stage --
+// Stage a change to the transaction instead of applying it.
+// Consecutive writes are merged into a single staging tree.
+// Deletes are kept in order, since deleting a leaf of a staging tree
+// would also remove its ancestors from the staged deletion.
+static ydb_res ydb_txn_stage(ydb *datablock, yconn_op op, ynode *src, char *path)
+{
+    struct ydb_txn_op *last = ylist_back(datablock->txn);
+    struct ydb_txn_op *txnop;
+    if (op == YOP_MERGE && last && last->op == YOP_MERGE)
+    {
+        ynode *top = ynode_merge(last->src, src, NULL);
+        ynode_remove(src);
+        if (!top)
+            return YDB_E_MERGE_FAILED;
+        last->src = top;
+        return YDB_OK;
+    }
+    txnop = malloc(sizeof(struct ydb_txn_op));
+    if (!txnop)
+    {
+        ynode_remove(src);
+        if (path)
+            free(path);
+        return YDB_E_MEM_ALLOC;
+    }
+    txnop->op = op;
+    txnop->src = src;
+    txnop->path = path;
+    ylist_push_back(datablock->txn, txnop);
+    return YDB_OK;
+}
+
+// ydb_txn_begin --
+// Start a transaction that stages the following local changes
+// (ydb_write, ydb_delete, ydb_path_write, ydb_path_delete, ydb_parse,
+// ydb_parses, ydb_add, ydb_rm and ydb_blob_write) until ydb_txn_commit.
+ydb_res ydb_txn_begin(ydb *datablock)
+{
+    ydb_res res = YDB_OK;
+    ylog_in();
+    YDB_FAIL(!datablock, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    YDB_FAIL(datablock->txn, YDB_E_ENTRY_EXISTS);
+    datablock->txn = ylist_create();
+    YDB_FAIL(!datablock->txn, YDB_E_MEM_ALLOC);
+    // The lock (PTHREAD_LOCK) is held until ydb_txn_commit or ydb_txn_abort.
+    ylog_out();
+    return res;
+failed:
+    unlock(datablock);
+    ylog_out();
+    return res;
+}
+
+// ydb_txn_commit --
+// Apply the staged changes in order. Each run of the staged writes is merged
+// at once, so that the write hooks run once per node and a single change
+// is logged and published for the run. So does each run of the deletes.
+ydb_res ydb_txn_commit(ydb *datablock)
+{
+    ydb_res res = YDB_OK;
+    ylist *txn;
+    struct ydb_txn_op *txnop;
+    ylog_in();
+    YDB_FAIL(!datablock, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    txn = datablock->txn;
+    YDB_FAIL(!txn, YDB_E_NO_ENTRY);
+    datablock->txn = NULL;
+    txnop = ylist_pop_front(txn);
+    while (txnop)
+    {
+        char *rbuf = NULL;
+        size_t rbuflen = 0;
+        yconn_op op = txnop->op;
+        ynode_log *log = ydb_log_open(datablock, NULL);
+        if (op == YOP_MERGE)
+        {
+            ynode *top = ynode_merge(datablock->top, txnop->src, log);
+            if (top)
+                datablock->top = top;
+            else
+                res = YDB_E_MERGE_FAILED;
+            ydb_txn_op_free(txnop);
+            txnop = ylist_pop_front(txn);
+        }
+        else
+        {
+            do
+            {
+                if (txnop->src)
                 {
-                    // The root should not be deleted.
-                    ynode_delete(n, log);
-                    n = ynode_down(datablock->top);
+                    struct ydb_delete_data ddata;
+                    ddata.log = log;
+                    ddata.node = datablock->top;
+                    ynode_traverse(txnop->src, ydb_delete_sub, &ddata,
+                                   YNODE_LEAF_FIRST | YNODE_LEAF_ONLY);
                 }
-            } else {
-                int index = ynode_index(target);
-                if (index <= 0)
-                    ynode_delete(target, log);
                 else
-                    res = YDB_E_DENIED_DELETE;
-            }
+                    ydb_path_delete_node(datablock, txnop->path, log);
+                ydb_txn_op_free(txnop);
+                txnop = ylist_pop_front(txn);
+            } while (txnop && txnop->op == YOP_DELETE);
         }
         ydb_log_close(datablock, log, &rbuf, &rbuflen);
         if (rbuf)
         {
             if (rbuflen > 0)
-                yconn_publish(NULL, NULL, datablock, YOP_DELETE, rbuf, rbuflen);
+                yconn_publish(NULL, NULL, datablock, op, rbuf, rbuflen);
             free(rbuf);
         }
     }
-    YDB_FAIL(!target, YDB_W_NON_EXISTENT_DATA);
+    ylist_destroy(txn);
+    unlock(datablock); // the lock held by ydb_txn_begin
+failed:
+    unlock(datablock);
+    ylog_out();
+    return res;
+}
+
+// ydb_txn_abort --
+// Discard the staged changes of the transaction.
+ydb_res ydb_txn_abort(ydb *datablock)
+{
+    ydb_res res = YDB_OK;
+    ylog_in();
+    YDB_FAIL(!datablock, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    YDB_FAIL(!datablock->txn, YDB_E_NO_ENTRY);
+    ydb_txn_free(datablock);
 failed:
     unlock(datablock);
-    CLEAR_BUF(buf, buflen);
     ylog_out();
     return res;
 }
@@ -2453,7 +3544,7 @@ int ydb_path_fprintf(FILE *stream, ydb *datablock, const char *format, ...)
     {
         int level = ynode_level(datablock->top, target);
         if (level == 0 && ynode_type(datablock->top) == YNODE_TYPE_VAL)
-            ret = fprintf(stream, "%s", ynode_value(target));
+            ret = ynode_fprintf_value(stream, target);
         else
             ret = ynode_printf_to_fp(stream, target, 1 - level, YDB_LEVEL_MAX);
     }
@@ -2465,11 +3556,204 @@ failed:
     return ret;
 }
 
+// write the binary data to the leaf of the path.
+ydb_res ydb_blob_write(ydb *datablock, const char *path, const void *data, size_t len)
+{
+    ydb_res res = YDB_OK;
+    ynode *src = NULL;
+    char *pathbuf = NULL;
+
+    ylog_in();
+    YDB_FAIL(!datablock || !path || (!data && len > 0), YDB_E_INVALID_ARGS);
+    pathbuf = strdup(path);
+    YDB_FAIL(!pathbuf, YDB_E_MEM_ALLOC);
+    src = ynode_create_blob(pathbuf, data, len);
+    YDB_FAIL(!src, YDB_E_MERGE_FAILED);
+    src = ynode_top(src);
+
+    lock(datablock);
+    if (datablock->txn)
+    {
+        res = ydb_txn_stage(datablock, YOP_MERGE, src, NULL);
+        src = NULL;
+        goto unlocked;
+    }
+    {
+        char *buf = NULL;
+        size_t buflen = 0;
+        ynode *top;
+        ynode_log *log = ydb_log_open(datablock, NULL);
+        top = ynode_merge(datablock->top, src, log);
+        ydb_log_close(datablock, log, &buf, &buflen);
+        if (top)
+        {
+            datablock->top = top;
+            yconn_publish(NULL, NULL, datablock, YOP_MERGE, buf, buflen);
+        }
+        else
+            res = YDB_E_MERGE_FAILED;
+        CLEAR_BUF(buf, buflen);
+    }
+unlocked:
+    unlock(datablock);
+failed:
+    if (pathbuf)
+        free(pathbuf);
+    ynode_remove(src);
+    ylog_out();
+    return res;
+}
+
+// add delta to the integer leaf in place.
+ydb_res ydb_counter_add(ydb *datablock, const char *path, long long delta)
+{
+    ydb_res res = YDB_OK;
+    ynode *target;
+    ynode *src = NULL;
+    char *pathbuf = NULL;
+
+    ylog_in();
+    YDB_FAIL(!datablock || !path, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    if (datablock->txn)
+    {
+        // The counter is not staged.
+        res = YDB_E_CTRL;
+        goto unlocked;
+    }
+    target = ynode_search(datablock->top, (char *)path);
+    if (target)
+    {
+        unsigned long gen = ynode_generation(datablock->top);
+        res = ynode_counter_add(target, delta);
+        if (res == YDB_OK && !datablock->counter_dirty)
+        {
+            datablock->counter_dirty = true;
+            datablock->counter_gen = gen;
+        }
+        goto unlocked;
+    }
+    // create the counter by the write.
+    pathbuf = strdup(path);
+    if (pathbuf)
+        src = ynode_create_int(pathbuf, delta);
+    if (!src)
+        res = YDB_E_MERGE_FAILED;
+    else
+    {
+        char *buf = NULL;
+        size_t buflen = 0;
+        ynode *top;
+        ynode_log *log = ydb_log_open(datablock, NULL);
+        top = ynode_merge(datablock->top, ynode_top(src), log);
+        ydb_log_close(datablock, log, &buf, &buflen);
+        if (top)
+        {
+            datablock->top = top;
+            yconn_publish(NULL, NULL, datablock, YOP_MERGE, buf, buflen);
+        }
+        else
+            res = YDB_E_MERGE_FAILED;
+        CLEAR_BUF(buf, buflen);
+        ynode_remove(ynode_top(src));
+    }
+unlocked:
+    unlock(datablock);
+failed:
+    if (pathbuf)
+        free(pathbuf);
+    ylog_out();
+    return res;
+}
+
+// log and publish the counters changed by ydb_counter_add at once.
+ydb_res ydb_counter_flush(ydb *datablock)
+{
+    char *buf = NULL;
+    size_t buflen = 0;
+    ynode_log *log;
+    if (!datablock)
+        return YDB_E_INVALID_ARGS;
+    lock(datablock);
+    if (datablock->counter_dirty)
+    {
+        datablock->counter_dirty = false;
+        log = ydb_log_open(datablock, NULL);
+        ynode_counter_flush(datablock->top, datablock->counter_gen, log);
+        ydb_log_close(datablock, log, &buf, &buflen);
+        if (buf)
+            yconn_publish(NULL, NULL, datablock, YOP_MERGE, buf, buflen);
+        CLEAR_BUF(buf, buflen);
+    }
+    unlock(datablock);
+    return YDB_OK;
+}
+
+// read the binary data of the leaf without copying.
+ydb_res ydb_blob_read(ydb *datablock, const char *path, const void **data, size_t *len)
+{
+    ydb_res res = YDB_OK;
+    ynode *target;
+    const void *blob;
+    size_t bloblen = 0;
+
+    ylog_in();
+    YDB_FAIL(!datablock || !path || !data, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    target = ynode_search(datablock->top, (char *)path);
+    if (!target)
+        res = YDB_E_NO_ENTRY;
+    else
+    {
+        blob = ynode_blob(target, &bloblen);
+        if (!blob)
+            res = YDB_E_TYPE_ERR;
+        else
+        {
+            *data = blob;
+            if (len)
+                *len = bloblen;
+        }
+    }
+    unlock(datablock);
+failed:
+    ylog_out();
+    return res;
+}
+
+#define YCONN_SHM_DATA_MIN 512
+#define YCONN_SHM_RING_SIZE (4 * 1024 * 1024)
+#define YCONN_SHM_SLOT_MAX 64
+#define YCONN_SHM_SLOT_FREE (~0ULL)
+
+// yconn_shm_ring --
+// The shared memory ring (memfd) of the published data (shm://)
+// - The publisher writes the published data into the ring once for all subscribers
+//   and only notifies the position of the data to them over the socket.
+// - The subscribers parse the data in the ring without copying it
+//   and then store the end of the data to their slots (tail)
+//   so that the publisher reuses the space consumed by all of them.
+// - The data is sent over the socket if the ring has no space for it.
+struct yconn_shm_ring
+{
+    unsigned long long head;                     // the end of the data written
+    unsigned long long tail[YCONN_SHM_SLOT_MAX]; // the end of the data consumed by each subscriber
+    char data[];
+};
+
+#define YCONN_SHM_RING_DATA_SIZE (YCONN_SHM_RING_SIZE - sizeof(struct yconn_shm_ring))
+
 struct yconn_socket_head
 {
     struct
     {
         int fd;
+        char *qbuf;  // the queued data not yet sent (drained on EPOLLOUT)
+        size_t qoff; // the sent length of qbuf
+        size_t qlen; // the queued length of qbuf
+        size_t qsize;
+        int shmslot;  // the slot of the subscriber in the shm ring + 1 (0 if not assigned)
+        bool shmsent; // true if the shm ring is delivered to the subscriber
     } send;
     struct
     {
@@ -2480,6 +3764,9 @@ struct yconn_socket_head
         size_t buflen;
         size_t bufused;
         int next;
+        struct yconn_shm_ring *shmring; // the shm ring of the publisher mapped (shm://)
+        int shmslot;
+        unsigned long long shmdone; // the end of the data being consumed in shmring
     } recv;
 };
 
@@ -2493,10 +3780,17 @@ void yconn_socket_deinit(yconn *conn)
     {
         if (head->send.fd > 0)
             close(head->send.fd);
+        if (head->send.qbuf)
+            free(head->send.qbuf);
         if (head->recv.fp)
             fclose(head->recv.fp);
         if (head->recv.buf)
             free(head->recv.buf);
+        if (head->send.shmslot > 0 && conn->datablock && conn->datablock->shmring)
+            __atomic_store_n(&conn->datablock->shmring->tail[head->send.shmslot - 1],
+                             YCONN_SHM_SLOT_FREE, __ATOMIC_RELEASE);
+        if (head->recv.shmring)
+            munmap(head->recv.shmring, YCONN_SHM_RING_SIZE);
         free(head);
     }
     conn->head = NULL;
@@ -2579,6 +3873,15 @@ ydb_res yconn_socket_init(yconn *conn)
         addr.un.sun_path[0] = 0;
         addrlen = offsetof(struct sockaddr_un, sun_path) + strlen(sname) + 1;
     }
+    else if (IS_SET(flags, YCONN_TYPE_SHM))
+    {
+        // hidden unix socket to notify the data in the shared memory ring
+        const char *sname = &(address[strlen("shm://")]);
+        addr.un.sun_family = AF_UNIX;
+        snprintf(addr.un.sun_path, sizeof(addr.un.sun_path), "#shm:%s", sname);
+        addr.un.sun_path[0] = 0;
+        addrlen = offsetof(struct sockaddr_un, sun_path) + strlen(addr.un.sun_path + 1) + 1;
+    }
     else
     {
         const char *sname = &(address[strlen("us://")]);
@@ -2743,6 +4046,61 @@ void yconn_default_recv_head(
         if (conn->name)
             yfree(conn->name);
         conn->name = ystrdup(name);
+        // the subscribed paths and the subtree digests of the subscriber
+        if (IS_SET(conn->flags, STATUS_COND_CLIENT))
+        {
+            char *headstart = recvdata;
+            char *headend = strstr(recvdata, YMSG_HEAD_DELIMITER);
+            yconn_filter_clear(conn);
+            while ((recvdata = strstr(recvdata, YMSG_SUBSCRIBE_HEAD)) != NULL)
+            {
+                char *eol;
+                if (headend && recvdata > headend)
+                    break;
+                recvdata += YMSG_SUBSCRIBE_HEAD_LEN;
+                eol = strchr(recvdata, '\n');
+                if (!eol)
+                    break;
+                yconn_filter_add(conn, recvdata, eol - recvdata);
+                ylog_info("ydb[%s] head {subscribe: %.*s}\n",
+                          conn->datablock->name, (int)(eol - recvdata), recvdata);
+                recvdata = eol;
+            }
+            conn->change_epoch = 0;
+            conn->change_seq = 0;
+            yconn_change_read(headstart, YMSG_RESUME_HEAD, &conn->change_epoch, &conn->change_seq);
+            recvdata = headstart;
+            yconn_digest_clear(conn);
+            while ((recvdata = strstr(recvdata, YMSG_DIGEST_HEAD)) != NULL)
+            {
+                char *eol, *path;
+                unsigned long long digest;
+                if (headend && recvdata > headend)
+                    break;
+                recvdata += YMSG_DIGEST_HEAD_LEN;
+                eol = strchr(recvdata, '\n');
+                if (!eol)
+                    break;
+                digest = strtoull(recvdata, &path, 16);
+                if (path < eol && *path == ' ')
+                    yconn_digest_add(conn, path + 1, eol - (path + 1), digest);
+                recvdata = eol;
+            }
+            if (conn->digest)
+                ylog_info("ydb[%s] head {digest: %d subtrees}\n",
+                          conn->datablock->name, ytrie_size(conn->digest));
+        }
+    }
+    // the last change received from the publisher
+    if (IS_SET(conn->flags, STATUS_CLIENT) &&
+        (*type == YMSG_PUBLISH || (*type == YMSG_RESPONSE && *op == YOP_INIT)))
+    {
+        unsigned long long epoch, seq;
+        if (yconn_change_read(*data, YMSG_CHANGE_HEAD, &epoch, &seq))
+        {
+            conn->change_epoch = epoch;
+            conn->change_seq = seq;
+        }
     }
     ylog_info("ydb[%s] head {peer: %s, seq: %u, type: %s, op: %s, to: %d}\n",
               conn->datablock->name,
@@ -2765,6 +4123,8 @@ failed:
     return;
 }
 
+static ssize_t yconn_shm_read(yconn *conn, char *buf, size_t buflen);
+
 #define RECV_BUF_SIZE 2048
 ydb_res yconn_default_recv(
     yconn *conn, yconn_op *op, ymsg_type *type,
@@ -2845,7 +4205,9 @@ ydb_res yconn_default_recv(
         }
     }
 
-    if (IS_SET(conn->flags, (YCONN_TYPE_INET | YCONN_TYPE_UNIX)))
+    if (IS_SET(conn->flags, YCONN_TYPE_SHM))
+        len = yconn_shm_read(conn, recvbuf, RECV_BUF_SIZE);
+    else if (IS_SET(conn->flags, (YCONN_TYPE_INET | YCONN_TYPE_UNIX)))
         len = recv(conn->fd, recvbuf, RECV_BUF_SIZE, MSG_DONTWAIT);
     else
         len = read(conn->fd, recvbuf, RECV_BUF_SIZE);
@@ -2911,11 +4273,263 @@ conn_closed:
     return res;
 }
 
+static int yconn_filter_head_print(void *addition, const void *key, int key_len, void *value)
+{
+    FILE *fp = addition;
+    fprintf(fp, YMSG_SUBSCRIBE_HEAD "%.*s\n", key_len, (const char *)key);
+    return 0;
+}
+
+// yconn_sendq_enabled --
+// Return true if the data sent to the conn is queued instead of blocking the sender.
+// The queue is drained on EPOLLOUT so that it is only used for the readable sockets.
+static bool yconn_sendq_enabled(yconn *conn, int fd)
+{
+    if (fd != conn->fd || IS_SET(conn->flags, YCONN_UNREADABLE))
+        return false;
+    if (!IS_SET(conn->flags, YCONN_TYPE_UNIX | YCONN_TYPE_INET))
+        return false;
+    return true;
+}
+
+static size_t yconn_sendq_len(yconn *conn)
+{
+    struct yconn_socket_head *head = conn->head;
+    if (!head)
+        return 0;
+    return head->send.qlen - head->send.qoff;
+}
+
+static int yconn_sendq_push(yconn *conn, struct iovec *iov, int cnt, size_t skip)
+{
+    int i;
+    size_t len = 0;
+    struct yconn_socket_head *head = conn->head;
+    for (i = 0; i < cnt; i++)
+        len += iov[i].iov_len;
+    len -= skip;
+    if (head->send.qoff > 0)
+    {
+        memmove(head->send.qbuf, head->send.qbuf + head->send.qoff,
+                head->send.qlen - head->send.qoff);
+        head->send.qlen -= head->send.qoff;
+        head->send.qoff = 0;
+    }
+    if (head->send.qlen + len > head->send.qsize)
+    {
+        size_t qsize = head->send.qsize ? head->send.qsize : 4096;
+        char *qbuf;
+        while (qsize < head->send.qlen + len)
+            qsize = qsize * 2;
+        qbuf = realloc(head->send.qbuf, qsize);
+        if (!qbuf)
+            return -1;
+        head->send.qbuf = qbuf;
+        head->send.qsize = qsize;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        if (skip >= iov[i].iov_len)
+        {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        memcpy(head->send.qbuf + head->send.qlen,
+               (char *)iov[i].iov_base + skip, iov[i].iov_len - skip);
+        head->send.qlen += iov[i].iov_len - skip;
+        skip = 0;
+    }
+    return 0;
+}
+
+// yconn_sendq_writev --
+// Send the data without blocking. The rest of the data not sent is queued and
+// then sent on EPOLLOUT. The subscriber is dropped if its queue exceeds sendq_limit.
+// (It receives all data again by YOP_INIT when it reconnects.)
+static int yconn_sendq_writev(yconn *conn, int fd, struct iovec *iov, int cnt)
+{
+    int i;
+    ssize_t n = 0;
+    size_t len = 0;
+    struct msghdr msg;
+    ydb *datablock = conn->datablock;
+    if (!yconn_sendq_enabled(conn, fd))
+        return writev(fd, iov, cnt);
+    for (i = 0; i < cnt; i++)
+        len += iov[i].iov_len;
+    if (yconn_sendq_len(conn) <= 0)
+    {
+        memset(&msg, 0x0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = cnt;
+        n = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return -1;
+            n = 0;
+        }
+        if ((size_t)n >= len)
+            return n;
+        if (ydb_epoll_modify(datablock, conn, fd, true))
+            return -1;
+    }
+    if (yconn_sendq_push(conn, iov, cnt, n))
+        return -1;
+    ylog_info("ydb[%s] %s queued (%zu bytes)\n",
+              datablock->name, conn->address, yconn_sendq_len(conn));
+    if (IS_COND_CLIENT(conn) && datablock->sendq_limit > 0 &&
+        yconn_sendq_len(conn) > datablock->sendq_limit)
+    {
+        datablock->sendq_drops++;
+        ylog_error("ydb[%s] %s dropped (send queue %zu bytes > %zu)\n",
+                   datablock->name, conn->address,
+                   yconn_sendq_len(conn), datablock->sendq_limit);
+        errno = ENOBUFS;
+        return -1;
+    }
+    return len;
+}
+
+// yconn_sendq_flush --
+// Send the queued data on EPOLLOUT.
+static ydb_res yconn_sendq_flush(yconn *conn)
+{
+    ssize_t n;
+    struct yconn_socket_head *head = conn->head;
+    if (!head || yconn_sendq_len(conn) <= 0)
+        return YDB_OK;
+    n = send(conn->fd, head->send.qbuf + head->send.qoff,
+             head->send.qlen - head->send.qoff, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return YDB_OK;
+        YCONN_FAILED(conn, YDB_E_SYSTEM_FAILED);
+        SET_DISCONNECTED(conn);
+        return YDB_E_CONN_FAILED;
+    }
+    head->send.qoff += n;
+    if (yconn_sendq_len(conn) > 0)
+        return YDB_OK;
+    head->send.qoff = 0;
+    head->send.qlen = 0;
+    return ydb_epoll_modify(conn->datablock, conn, conn->fd, false);
+}
+
+// yconn_pubhead_build --
+// Format the publish head except for the sequence number once
+// so that it can be shared by all subscribers of a publish.
+static void yconn_pubhead_build(ydb *datablock, yconn_op op)
+{
+    int n;
+    size_t len;
+    char *pubhead;
+    if (op != YOP_MERGE && op != YOP_DELETE)
+        return;
+    len = strlen(datablock->name) + 192;
+    pubhead = malloc(len);
+    if (!pubhead)
+        return;
+    n = snprintf(pubhead, len,
+                 YMSG_START_DELIMITER
+                 "#name: %s\n"
+                 "#seq: ",
+                 datablock->name);
+    datablock->pubheadlen = n;
+    n++; // the null-terminated string of the head.
+    datablock->pubtail = pubhead + n;
+    datablock->pubtaillen = snprintf(pubhead + n, len - n,
+                                     "\n#type: %s\n"
+                                     "#op: %s\n",
+                                     ymsg_str[YMSG_PUBLISH],
+                                     yconn_op_str[op]);
+    if (datablock->pubchange)
+        datablock->pubtaillen += snprintf(pubhead + n + datablock->pubtaillen,
+                                          len - n - datablock->pubtaillen,
+                                          YMSG_CHANGE_HEAD "%llx:%llu\n",
+                                          datablock->change_epoch, datablock->pubchange);
+    datablock->pubtaillen += snprintf(pubhead + n + datablock->pubtaillen,
+                                      len - n - datablock->pubtaillen,
+                                      YMSG_HEAD_DELIMITER);
+    datablock->pubhead = pubhead;
+    datablock->pubop = op;
+}
+
+static void yconn_pubhead_release(ydb *datablock)
+{
+    if (datablock->pubhead)
+        free(datablock->pubhead);
+    datablock->pubhead = NULL;
+    datablock->pubheadlen = 0;
+    datablock->pubtail = NULL;
+    datablock->pubtaillen = 0;
+    datablock->pubop = YOP_NONE;
+}
+
+// yconn_seq_print --
+// Print the sequence number without the printf formatting.
+static int yconn_seq_print(char *buf, unsigned int seq)
+{
+    char tmp[16];
+    int n = 0, len = 0;
+    do
+    {
+        tmp[n++] = '0' + (seq % 10);
+        seq = seq / 10;
+    } while (seq > 0);
+    while (n > 0)
+        buf[len++] = tmp[--n];
+    buf[len] = 0;
+    return len;
+}
+
+// yconn_change_print --
+// Print the change sequence number of the published data or
+// the latest change sequence number of the datablock (to the YOP_INIT response).
+static int yconn_change_print(char *buf, yconn *conn, yconn_op op, ymsg_type type)
+{
+    ydb *datablock = conn->datablock;
+    if (!datablock->changes)
+        return 0;
+    if (type == YMSG_PUBLISH && (op == YOP_MERGE || op == YOP_DELETE) && datablock->pubchange)
+        return sprintf(buf, YMSG_CHANGE_HEAD "%llx:%llu\n",
+                       datablock->change_epoch, datablock->pubchange);
+    if (type == YMSG_RESPONSE && op == YOP_INIT)
+        return sprintf(buf, YMSG_CHANGE_HEAD "%llx:%llu\n",
+                       datablock->change_epoch, datablock->change_seq);
+    return 0;
+}
+
+// yconn_change_read --
+// Read the change sequence number from the head.
+static bool yconn_change_read(char *data, const char *tag,
+                              unsigned long long *epoch, unsigned long long *seq)
+{
+    char *headend, *p;
+    size_t taglen = strlen(tag);
+    headend = strstr(data, YMSG_HEAD_DELIMITER);
+    if (!headend)
+        return false;
+    p = memmem(data, headend - data, tag, taglen);
+    if (!p)
+        return false;
+    if (sscanf(p + taglen, "%llx:%llu", epoch, seq) != 2)
+        return false;
+    return true;
+}
+
 ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data, size_t datalen)
 {
     int n, fd;
     char msghead[256 + 128];
+    char *subs = NULL;
+    size_t subslen = 0;
     struct yconn_socket_head *head;
+    ydb *datablock = conn->datablock;
+    bool pubhead = false;
+    char seq[16];
+    int seqlen = 0;
     ylog_in();
     if (IS_SET(conn->flags, STATUS_DISCONNECT))
     {
@@ -2923,6 +4537,20 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
         return YDB_E_CONN_FAILED;
     }
     head = (struct yconn_socket_head *)conn->head;
+    if (type == YMSG_PUBLISH && datablock->pubhead && datablock->pubop == op)
+    {
+        // the publish head was already formatted except for the seq.
+        pubhead = true;
+        seqlen = yconn_seq_print(seq, conn->sendseq);
+        n = 0;
+        msghead[0] = 0;
+        ylog_info("ydb[%s] head {seq: %u, type: %s, op: %s}\n",
+                  datablock->name,
+                  conn->sendseq,
+                  ymsg_str[type],
+                  yconn_op_str[op]);
+        goto send_msg;
+    }
     n = sprintf(msghead,
                 YMSG_START_DELIMITER
                 "#name: %s\n"
@@ -2956,6 +4584,37 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
                   IS_SET(conn->flags, YCONN_ROLE_PUBLISHER) ? "p" : "s",
                   IS_SET(conn->flags, YCONN_WRITABLE) ? "w" : "_",
                   IS_SET(conn->flags, YCONN_UNSUBSCRIBE) ? "u" : "_");
+        // the last change applied to resume the change stream of the publisher.
+        if (IS_SET(conn->flags, STATUS_CLIENT) && type == YMSG_REQUEST && conn->change_epoch &&
+            !IS_SET(conn->flags, YCONN_UNSUBSCRIBE) && !yconn_filtered(conn))
+        {
+            n += sprintf(msghead + n, YMSG_RESUME_HEAD "%llx:%llu\n",
+                         conn->change_epoch, conn->change_seq);
+            ylog_info("ydb[%s] head {resume: %llu}\n", conn->datablock->name, conn->change_seq);
+        }
+        // the subscribed paths or the subtree digests are placed at the end of the head.
+        // The publisher sends only the subtrees that differ from the digests.
+        if (IS_SET(conn->flags, STATUS_CLIENT) && yconn_filtered(conn))
+        {
+            FILE *fp = open_memstream(&subs, &subslen);
+            if (fp)
+            {
+                ytrie_traverse(conn->filter, yconn_filter_head_print, fp);
+                fprintf(fp, "%s", YMSG_HEAD_DELIMITER);
+                fclose(fp);
+            }
+        }
+        else if (IS_SET(conn->flags, STATUS_CLIENT) && type == YMSG_REQUEST &&
+                 !IS_SET(conn->flags, YCONN_UNSUBSCRIBE) && !ydb_empty(conn->datablock->top))
+        {
+            FILE *fp = open_memstream(&subs, &subslen);
+            if (fp)
+            {
+                yconn_digest_head_print(fp, conn->datablock->top);
+                fprintf(fp, "%s", YMSG_HEAD_DELIMITER);
+                fclose(fp);
+            }
+        }
         break;
     case YOP_SYNC:
         if (type == YMSG_REQUEST)
@@ -2966,14 +4625,31 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
     default:
         break;
     }
-    n += sprintf(msghead + n, "%s", YMSG_HEAD_DELIMITER);
+    n += yconn_change_print(msghead + n, conn, op, type);
+    if (!subs)
+        n += sprintf(msghead + n, "%s", YMSG_HEAD_DELIMITER);
+send_msg:
     fd = conn->fd;
     if (head->send.fd > 0)
         fd = head->send.fd;
 #ifndef WRITEV_SEND
-    n = write(fd, msghead, n);
+    if (pubhead)
+    {
+        if (write(fd, datablock->pubhead, datablock->pubheadlen) < 0 ||
+            write(fd, seq, seqlen) < 0)
+            goto conn_failed;
+        n = write(fd, datablock->pubtail, datablock->pubtaillen);
+    }
+    else
+        n = write(fd, msghead, n);
     if (n < 0)
         goto conn_failed;
+    if (subs)
+    {
+        n = write(fd, subs, subslen);
+        if (n < 0)
+            goto conn_failed;
+    }
     if (datalen > 0)
     {
         tx_fail_count--;
@@ -2987,16 +4663,37 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
         if (n < 0)
             goto conn_failed;
     }
-    ylog_info("ydb[%s] data {\n%s%.*s%s}\n",
+    ylog_info("ydb[%s] data {\n%s%s%.*s%s}\n",
               conn->datablock->name,
-              msghead, datalen, data ? data : "", "\n...\n");
+              msghead, subs ? subs : "", datalen, data ? data : "", "\n...\n");
     n = write(fd, YMSG_END_DELIMITER, YMSG_END_DELIMITER_LEN);
 #else
     int cnt = 0;
-    struct iovec iov[3];
-    iov[cnt].iov_base = msghead;
-    iov[cnt].iov_len = n;
-    cnt++;
+    struct iovec iov[6];
+    if (pubhead)
+    {
+        iov[cnt].iov_base = datablock->pubhead;
+        iov[cnt].iov_len = datablock->pubheadlen;
+        cnt++;
+        iov[cnt].iov_base = seq;
+        iov[cnt].iov_len = seqlen;
+        cnt++;
+        iov[cnt].iov_base = datablock->pubtail;
+        iov[cnt].iov_len = datablock->pubtaillen;
+        cnt++;
+    }
+    else
+    {
+        iov[cnt].iov_base = msghead;
+        iov[cnt].iov_len = n;
+        cnt++;
+    }
+    if (subs)
+    {
+        iov[cnt].iov_base = subs;
+        iov[cnt].iov_len = subslen;
+        cnt++;
+    }
     if (datalen > 0 && data)
     {
         iov[cnt].iov_base = data;
@@ -3006,9 +4703,9 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
     iov[cnt].iov_base = YMSG_END_DELIMITER;
     iov[cnt].iov_len = YMSG_END_DELIMITER_LEN;
     cnt++;
-    ylog_info("ydb[%s] data {\n%s%.*s%s}\n",
+    ylog_info("ydb[%s] data {\n%s%s%.*s%s}\n",
               conn->datablock->name,
-              msghead, datalen, data ? data : "", "\n...\n");
+              msghead, subs ? subs : "", datalen, data ? data : "", "\n...\n");
     if (tx_fail_en)
     {
         if (tx_fail_count > 0)
@@ -3025,19 +4722,22 @@ ydb_res yconn_default_send(yconn *conn, yconn_op op, ymsg_type type, char *data,
         else if (tx_fail_count < 0)
         {
             ylog_error("no-tx for test\n");
+            CLEAR_BUF(subs, subslen);
             ylog_out();
             return YDB_OK;
         }
     }
-    n = writev(fd, iov, cnt);
+    n = yconn_sendq_writev(conn, fd, iov, cnt);
 #endif
     if (n < 0)
         goto conn_failed;
+    CLEAR_BUF(subs, subslen);
     ylog_out();
     return YDB_OK;
 conn_failed:
     YCONN_FAILED(conn, YDB_E_SYSTEM_FAILED);
     SET_DISCONNECTED(conn);
+    CLEAR_BUF(subs, subslen);
     ylog_out();
     return YDB_E_CONN_FAILED;
 }
@@ -3172,6 +4872,314 @@ void yconn_file_deinit(yconn *conn)
     SET_DISCONNECTED(conn);
 }
 
+// yconn_shm_release --
+// Stop sharing the data being published in the shm ring.
+static void yconn_shm_release(ydb *datablock)
+{
+    datablock->shmdata = NULL;
+    datablock->shmdatalen = 0;
+}
+
+// yconn_shm_ring_open --
+// Return the shm ring of the datablock created and mapped once.
+static struct yconn_shm_ring *yconn_shm_ring_open(ydb *datablock)
+{
+    int i, fd;
+    struct yconn_shm_ring *ring;
+    if (datablock->shmring)
+        return datablock->shmring;
+    fd = memfd_create(datablock->name, MFD_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    if (ftruncate(fd, YCONN_SHM_RING_SIZE) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    ring = mmap(NULL, YCONN_SHM_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    ring->head = 0;
+    for (i = 0; i < YCONN_SHM_SLOT_MAX; i++)
+        ring->tail[i] = YCONN_SHM_SLOT_FREE;
+    datablock->shmfd = fd;
+    datablock->shmring = ring;
+    return ring;
+}
+
+// yconn_shm_close --
+// Unmap and close the shm ring of the datablock.
+static void yconn_shm_close(ydb *datablock)
+{
+    if (datablock->shmring)
+        munmap(datablock->shmring, YCONN_SHM_RING_SIZE);
+    if (datablock->shmfd >= 0)
+        close(datablock->shmfd);
+    datablock->shmring = NULL;
+    datablock->shmfd = -1;
+}
+
+// yconn_shm_slot --
+// Return the slot of the subscriber in the shm ring or -1 if all slots are used.
+static int yconn_shm_slot(yconn *conn, struct yconn_shm_ring *ring)
+{
+    int i;
+    ydb *datablock = conn->datablock;
+    struct yconn_socket_head *head = conn->head;
+    if (head->send.shmslot > 0)
+        return head->send.shmslot - 1;
+    for (i = 0; i < YCONN_SHM_SLOT_MAX; i++)
+    {
+        if (__atomic_load_n(&ring->tail[i], __ATOMIC_ACQUIRE) != YCONN_SHM_SLOT_FREE)
+            continue;
+        // the data being published is not consumed by the subscriber yet.
+        __atomic_store_n(&ring->tail[i], datablock->shmdata ? datablock->shmpos : ring->head,
+                         __ATOMIC_RELEASE);
+        head->send.shmslot = i + 1;
+        return i;
+    }
+    return -1;
+}
+
+// yconn_shm_write --
+// Write the data into the shm ring once for all subscribers and return the position of the data.
+// Return YCONN_SHM_SLOT_FREE if the space of the ring is not consumed by the subscribers yet.
+static unsigned long long yconn_shm_write(ydb *datablock, struct yconn_shm_ring *ring, char *data, size_t datalen)
+{
+    int i;
+    size_t off;
+    unsigned long long pos, end, tail;
+    if (datablock->shmdata == data && datablock->shmdatalen == datalen)
+        return datablock->shmpos;
+    yconn_shm_release(datablock);
+    if (datalen > YCONN_SHM_RING_DATA_SIZE / 2)
+        return YCONN_SHM_SLOT_FREE;
+    // the data is kept contiguous in the ring to be parsed in place.
+    pos = ring->head;
+    off = pos % YCONN_SHM_RING_DATA_SIZE;
+    if (off + datalen > YCONN_SHM_RING_DATA_SIZE)
+        pos += YCONN_SHM_RING_DATA_SIZE - off;
+    end = pos + datalen;
+    for (i = 0; i < YCONN_SHM_SLOT_MAX; i++)
+    {
+        tail = __atomic_load_n(&ring->tail[i], __ATOMIC_ACQUIRE);
+        if (tail != YCONN_SHM_SLOT_FREE && end - tail > YCONN_SHM_RING_DATA_SIZE)
+            return YCONN_SHM_SLOT_FREE;
+    }
+    memcpy(ring->data + (pos % YCONN_SHM_RING_DATA_SIZE), data, datalen);
+    __atomic_store_n(&ring->head, end, __ATOMIC_RELEASE);
+    datablock->shmdata = data;
+    datablock->shmdatalen = datalen;
+    datablock->shmpos = pos;
+    return pos;
+}
+
+// read the message and map the shm ring delivered by SCM_RIGHTS.
+static ssize_t yconn_shm_read(yconn *conn, char *buf, size_t buflen)
+{
+    ssize_t len;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctrl;
+    struct yconn_socket_head *head = conn->head;
+    memset(&msg, 0x0, sizeof(msg));
+    iov.iov_base = buf;
+    iov.iov_len = buflen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+    len = recvmsg(conn->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (len <= 0)
+        return len;
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        int fd;
+        struct stat st;
+        struct yconn_shm_ring *ring;
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        ring = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size == YCONN_SHM_RING_SIZE)
+            ring = mmap(NULL, YCONN_SHM_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ring == MAP_FAILED)
+        {
+            ylog_error("ydb[%s] unable to map the shm ring\n", conn->datablock->name);
+            continue;
+        }
+        if (head->recv.shmring)
+            munmap(head->recv.shmring, YCONN_SHM_RING_SIZE);
+        head->recv.shmring = ring;
+        head->recv.shmdone = 0;
+    }
+    return len;
+}
+
+ydb_res yconn_shm_send(yconn *conn, yconn_op op, ymsg_type type, char *data, size_t datalen)
+{
+    int n, slot;
+    unsigned long long pos;
+    char msghead[256 + 128];
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    struct yconn_shm_ring *ring;
+    struct yconn_socket_head *head;
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctrl;
+
+    // Only the published data is delivered by the shm ring
+    // because it is the only data sent to multiple subscribers.
+    if (type != YMSG_PUBLISH || (op != YOP_MERGE && op != YOP_DELETE) ||
+        !data || datalen < YCONN_SHM_DATA_MIN)
+        return yconn_default_send(conn, op, type, data, datalen);
+    if (IS_SET(conn->flags, STATUS_DISCONNECT))
+        return YDB_E_CONN_FAILED;
+    // keep the order of the queued data.
+    if (yconn_sendq_len(conn) > 0)
+        return yconn_default_send(conn, op, type, data, datalen);
+    head = conn->head;
+    ring = yconn_shm_ring_open(conn->datablock);
+    if (!ring)
+        return yconn_default_send(conn, op, type, data, datalen);
+    slot = yconn_shm_slot(conn, ring);
+    if (slot < 0)
+        return yconn_default_send(conn, op, type, data, datalen);
+    pos = yconn_shm_write(conn->datablock, ring, data, datalen);
+    if (pos == YCONN_SHM_SLOT_FREE)
+        return yconn_default_send(conn, op, type, data, datalen);
+
+    ylog_in();
+    n = sprintf(msghead,
+                YMSG_START_DELIMITER
+                "#name: %s\n"
+                "#seq: %u\n"
+                "#type: %s\n"
+                "#op: %s\n"
+                "#shm: %llu %zu %d\n",
+                conn->datablock->name,
+                conn->sendseq,
+                ymsg_str[type],
+                yconn_op_str[op],
+                pos, datalen, slot);
+    n += yconn_change_print(msghead + n, conn, op, type);
+    n += sprintf(msghead + n, YMSG_HEAD_DELIMITER YMSG_END_DELIMITER);
+    ylog_info("ydb[%s] head {seq: %u, type: %s, op: %s, shm: %llu %zu %d}\n",
+              conn->datablock->name,
+              conn->sendseq,
+              ymsg_str[type],
+              yconn_op_str[op],
+              pos, datalen, slot);
+    memset(&msg, 0x0, sizeof(msg));
+    iov.iov_base = msghead;
+    iov.iov_len = n;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    // the shm ring is delivered once with the first notification.
+    if (!head->send.shmsent)
+    {
+        msg.msg_control = ctrl.buf;
+        msg.msg_controllen = sizeof(ctrl.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &conn->datablock->shmfd, sizeof(int));
+    }
+    n = sendmsg(conn->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        ylog_out();
+        return yconn_default_send(conn, op, type, data, datalen);
+    }
+    if (n > 0)
+        head->send.shmsent = true;
+    if (n >= 0 && (size_t)n < iov.iov_len)
+    {
+        // the shm ring is passed with the first byte.
+        if (ydb_epoll_modify(conn->datablock, conn, conn->fd, true) ||
+            yconn_sendq_push(conn, &iov, 1, n))
+            n = -1;
+    }
+    if (n < 0)
+    {
+        YCONN_FAILED(conn, YDB_E_SYSTEM_FAILED);
+        SET_DISCONNECTED(conn);
+        ylog_out();
+        return YDB_E_CONN_FAILED;
+    }
+    ylog_out();
+    return YDB_OK;
+}
+
+ydb_res yconn_shm_recv(
+    yconn *conn, yconn_op *op, ymsg_type *type,
+    unsigned int *flags, char **data, size_t *datalen,
+    int *next)
+{
+    ydb_res res;
+    struct yconn_socket_head *head = conn->head;
+    char *shm, *headend;
+    unsigned long long pos;
+    size_t len, off;
+    int slot;
+    // the data returned by the last call is consumed.
+    if (head && head->recv.shmring && head->recv.shmdone)
+    {
+        unsigned long long *tail = &head->recv.shmring->tail[head->recv.shmslot];
+        unsigned long long cur = __atomic_load_n(tail, __ATOMIC_ACQUIRE);
+        // The slot reassigned to a new subscriber starts after the data.
+        if (cur != YCONN_SHM_SLOT_FREE && cur < head->recv.shmdone)
+            __atomic_compare_exchange_n(tail, &cur, head->recv.shmdone, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        head->recv.shmdone = 0;
+    }
+    res = yconn_default_recv(conn, op, type, flags, data, datalen, next);
+    if (res || !*data || *datalen <= 0)
+        return res;
+    head = conn->head;
+    headend = strstr(*data, YMSG_HEAD_DELIMITER);
+    if (!headend)
+        return res;
+    shm = strstr(*data, "#shm: ");
+    if (!shm || shm > headend)
+        return res;
+    if (sscanf(shm, "#shm: %llu %zu %d", &pos, &len, &slot) != 3 ||
+        slot < 0 || slot >= YCONN_SHM_SLOT_MAX || len > YCONN_SHM_RING_DATA_SIZE ||
+        (pos % YCONN_SHM_RING_DATA_SIZE) + len > YCONN_SHM_RING_DATA_SIZE)
+    {
+        ylog_error("ydb[%s] invalid shm data\n", conn->datablock->name);
+        *op = head->recv.op = YOP_NONE;
+        return YDB_OK;
+    }
+    if (!head->recv.shmring)
+    {
+        ylog_error("ydb[%s] no shm ring received\n", conn->datablock->name);
+        *op = head->recv.op = YOP_NONE;
+        return YDB_OK;
+    }
+    // the data is parsed in the shm ring without copying it.
+    off = pos % YCONN_SHM_RING_DATA_SIZE;
+    head->recv.shmslot = slot;
+    head->recv.shmdone = pos + len;
+    *data = head->recv.shmring->data + off;
+    *datalen = len;
+    ylog_info("ydb[%s] shm data {\n%.*s}\n",
+              conn->datablock->name, (int)*datalen, *data);
+    return YDB_OK;
+}
+
 static char *yconn_flag_print(yconn *conn)
 {
     static char flagstr[64];
@@ -3306,6 +5314,11 @@ static unsigned int _yconn_flags(const char *address, char *flagstr)
     {
         SET_FLAG(flags, YCONN_TYPE_FIFO);
     }
+    else if (strncmp(address, "shm://", strlen("shm://")) == 0)
+    {
+        SET_FLAG(flags, YCONN_TYPE_UNIX);
+        SET_FLAG(flags, YCONN_TYPE_SHM);
+    }
     // else if (strncmp(address, "ws://", strlen("ws://")) == 0)
     // else if (strncmp(address, "wss://", strlen("wss://")) == 0)
     else
@@ -3324,7 +5337,15 @@ static yconn *_yconn_new(const char *address, unsigned int flags, ydb *datablock
     yconn_func_accept func_accept = NULL;
     yconn *conn = NULL;
 
-    if (IS_SET(flags, YCONN_TYPE_UNIX | YCONN_TYPE_INET))
+    if (IS_SET(flags, YCONN_TYPE_SHM))
+    {
+        func_init = yconn_socket_init;
+        func_send = yconn_shm_send;
+        func_recv = yconn_shm_recv;
+        func_accept = yconn_socket_accept;
+        func_deinit = yconn_socket_deinit;
+    }
+    else if (IS_SET(flags, YCONN_TYPE_UNIX | YCONN_TYPE_INET))
     {
         func_init = yconn_socket_init;
         func_send = yconn_default_send;
@@ -3379,6 +5400,8 @@ static void _yconn_free(yconn *conn)
             yfree(conn->address);
         if (conn->name)
             yfree(conn->name);
+        yconn_filter_clear(conn);
+        yconn_digest_clear(conn);
         free(conn);
     }
 }
@@ -3799,27 +5822,357 @@ ydb_res yconn_response(yconn *req_conn, yconn_op op, unsigned int respseq, bool
     return res;
 }
 
-eventid yconn_request(yconn *req_conn, yconn_op op, int timeout, char *buf, size_t buflen, eventid peid)
+eventid yconn_request(yconn *req_conn, yconn_op op, int timeout, char *buf, size_t buflen, eventid peid)
+{
+    ydb_res res = YDB_OK;
+    eventid eid = {.fd = -1, .seq = 0};
+    ylog_inout();
+    if (!req_conn)
+        return eid;
+    YCONN_SIMPLE_INFO(req_conn);
+    req_conn->sendseq++;
+    if ((timeout - YDB_DELIVERY_LATENCY) > 0)
+        req_conn->send_timeout = timeout - YDB_DELIVERY_LATENCY;
+    else
+        req_conn->send_timeout = timeout;
+    YDB_ASSERT(!req_conn->func_send, YDB_E_FUNC);
+    res = req_conn->func_send(req_conn, op, YMSG_REQUEST, buf, buflen);
+    if (res)
+    {
+        yconn_deferred_close(req_conn);
+        return eid;
+    }
+    return waitevent_set_event(req_conn->datablock, req_conn->fd, req_conn->sendseq, req_conn->send_timeout, peid);
+}
+
+static void yconn_filter_add(yconn *conn, const char *path, int pathlen)
+{
+    char *oldpath, *newpath;
+    if (pathlen <= 0)
+        return;
+    if (!conn->filter)
+    {
+        conn->filter = ytrie_create();
+        if (!conn->filter)
+            return;
+    }
+    newpath = strndup(path, pathlen);
+    if (!newpath)
+        return;
+    oldpath = ytrie_insert(conn->filter, newpath, pathlen, newpath);
+    if (oldpath)
+        free(oldpath);
+}
+
+static void yconn_filter_clear(yconn *conn)
+{
+    if (conn->filter)
+        ytrie_destroy_custom(conn->filter, free);
+    conn->filter = NULL;
+}
+
+static bool yconn_filtered(yconn *conn)
+{
+    if (conn->filter && ytrie_size(conn->filter) > 0)
+        return true;
+    return false;
+}
+
+struct yconn_filter_data
+{
+    ytrie *filter;
+    ynode *top;
+    ynode_log *log;
+    int num;
+};
+
+static int yconn_filter_print(void *addition, const void *key, int key_len, void *value)
+{
+    struct yconn_filter_data *fdata = addition;
+    const char *path = key;
+    ynode *node;
+    int i, matched = 0;
+    // skip the path if its ancestor path is also subscribed.
+    for (i = 1; i < key_len; i++)
+    {
+        if (path[i] == '/' && ytrie_search(fdata->filter, path, i))
+            return 0;
+    }
+    node = ynode_search_best(fdata->top, value, &matched);
+    if (!node || node == fdata->top)
+        return 0;
+    // The ancestor deleted or replaced to a value covers the subscribed path.
+    if (!matched && ynode_type(node) != YNODE_TYPE_VAL)
+        return 0;
+    ynode_get(node, fdata->log);
+    fdata->num++;
+    return 0;
+}
+
+// yconn_filter_dumps --
+// Print the nodes of top under the subscribed paths of the conn to buf.
+// Return the number of the printed subtrees.
+static int yconn_filter_dumps(yconn *conn, ynode *top, char **buf, size_t *buflen)
+{
+    struct yconn_filter_data fdata;
+    *buf = NULL;
+    *buflen = 0;
+    if (!top || !yconn_filtered(conn))
+        return 0;
+    fdata.filter = conn->filter;
+    fdata.top = top;
+    fdata.num = 0;
+    fdata.log = ynode_log_open(top, NULL);
+    if (!fdata.log)
+        return 0;
+    ytrie_traverse(conn->filter, yconn_filter_print, &fdata);
+    ynode_log_close(fdata.log, buf, buflen);
+    if (fdata.num <= 0)
+        CLEAR_BUF(*buf, *buflen);
+    return fdata.num;
+}
+
+static void yconn_digest_add(yconn *conn, const char *path, int pathlen, unsigned long long digest)
+{
+    unsigned long long *old, *new;
+    if (pathlen <= 0)
+        return;
+    if (!conn->digest)
+    {
+        conn->digest = ytrie_create();
+        if (!conn->digest)
+            return;
+    }
+    new = malloc(sizeof(unsigned long long));
+    if (!new)
+        return;
+    *new = digest;
+    old = ytrie_insert(conn->digest, path, pathlen, new);
+    if (old)
+        free(old);
+}
+
+static void yconn_digest_clear(yconn *conn)
+{
+    if (conn->digest)
+        ytrie_destroy_custom(conn->digest, free);
+    conn->digest = NULL;
+}
+
+static char *yconn_digest_path(ynode *top, ynode *node, int *pathlen)
+{
+    if (node == top)
+    {
+        *pathlen = 1;
+        return strdup("/");
+    }
+    return ynode_path(node, ynode_level(top, node), pathlen);
+}
+
+// yconn_digest_head_print --
+// Print the subtree digests of top level by level until YMSG_DIGEST_MAX.
+// Only the complete levels are printed and the list items are not descended.
+static void yconn_digest_head_print(FILE *fp, ynode *top)
+{
+    int num = 0;
+    ynode *node, *child;
+    ylist *level, *next;
+    level = ylist_create();
+    if (!level)
+        return;
+    ylist_push_back(level, top);
+    while (!ylist_empty(level))
+    {
+        next = ylist_create();
+        if (!next)
+            break;
+        while ((node = ylist_pop_front(level)) != NULL)
+        {
+            int pathlen = 0;
+            char *path = yconn_digest_path(top, node, &pathlen);
+            if (!path)
+                continue;
+            fprintf(fp, YMSG_DIGEST_HEAD "%016llx %.*s\n", ynode_digest(node), pathlen, path);
+            free(path);
+            num++;
+            if (ynode_type(node) == YNODE_TYPE_VAL || ynode_type(node) == YNODE_TYPE_LIST)
+                continue;
+            for (child = ynode_down(node); child; child = ynode_next(child))
+                ylist_push_back(next, child);
+        }
+        ylist_destroy(level);
+        level = next;
+        if (num + ylist_size(level) > YMSG_DIGEST_MAX)
+            break;
+    }
+    ylist_destroy(level);
+}
+
+// yconn_digest_stale --
+// Add the children of node that the subscriber has, but top doesn't have to del.
+// Return true if the subscriber has sent the digests of the children of node.
+static bool yconn_digest_stale(yconn *conn, ynode *top, ynode *node, char *path, int pathlen, ynode *del, int *delnum)
+{
+    bool children = false;
+    int level, prefixlen;
+    char *prefix;
+    ytrie_iter iter;
+    void *digest;
+    prefixlen = (node == top) ? 0 : pathlen;
+    prefix = malloc(prefixlen + 1);
+    if (!prefix)
+        return false;
+    memcpy(prefix, path, prefixlen);
+    prefix[prefixlen++] = '/';
+    level = ynode_level(top, node) + 1;
+    digest = ytrie_iter_prefix_begin(conn->digest, &iter, prefix, prefixlen);
+    for (; digest; digest = ytrie_iter_prefix_next(conn->digest, &iter))
+    {
+        int keylen = 0;
+        const char *key = ytrie_iter_key(&iter, &keylen);
+        char *subpath;
+        ylist *keylist;
+        if (keylen <= prefixlen)
+            continue;
+        children = true;
+        subpath = strndup(key, keylen);
+        if (!subpath)
+            continue;
+        if (!ynode_search(top, subpath))
+        {
+            // only the topmost subtree removed is deleted.
+            keylist = ynode_path_tokenize(subpath, NULL);
+            if (keylist && ylist_size(keylist) == level)
+            {
+                ynode_create_path(subpath, del, NULL);
+                (*delnum)++;
+            }
+            ylist_destroy_custom(keylist, free);
+        }
+        free(subpath);
+    }
+    free(prefix);
+    return children;
+}
+
+static void yconn_digest_print(yconn *conn, ynode *top, ynode *node, ynode_log *log, int *num, ynode *del, int *delnum)
+{
+    int pathlen = 0;
+    char *path;
+    ynode *child;
+    unsigned long long *digest;
+    path = yconn_digest_path(top, node, &pathlen);
+    if (!path)
+        return;
+    digest = ytrie_search(conn->digest, path, pathlen);
+    if (digest && *digest == ynode_digest(node))
+    {
+        free(path);
+        return;
+    }
+    if (digest && ynode_type(node) != YNODE_TYPE_VAL)
+    {
+        // descend the subtree to find the different subtrees
+        // if the subscriber has sent the digests of the children.
+        if (ynode_type(node) != YNODE_TYPE_LIST &&
+            yconn_digest_stale(conn, top, node, path, pathlen, del, delnum))
+        {
+            free(path);
+            for (child = ynode_down(node); child; child = ynode_next(child))
+                yconn_digest_print(conn, top, child, log, num, del, delnum);
+            return;
+        }
+        // otherwise, the subtree of the subscriber is replaced as a whole.
+        if (node != top)
+        {
+            ynode_create_path(path, del, NULL);
+            (*delnum)++;
+        }
+    }
+    free(path);
+    ynode_get(node, log);
+    (*num)++;
+}
+
+// yconn_digest_dumps --
+// Print only the subtrees of top that differ from the subtree digests of the subscriber to buf
+// and the subtrees of the subscriber to be deleted before them to delbuf.
+// Return the number of the printed subtrees.
+static int yconn_digest_dumps(yconn *conn, ynode *top, char **buf, size_t *buflen, char **delbuf, size_t *delbuflen)
+{
+    int num = 0;
+    int delnum = 0;
+    ynode_log *log;
+    ynode *del;
+    *buf = NULL;
+    *buflen = 0;
+    *delbuf = NULL;
+    *delbuflen = 0;
+    if (!top || !conn->digest)
+        return 0;
+    del = ynode_top(ynode_create_path("/", NULL, NULL));
+    if (!del)
+        return 0;
+    log = ynode_log_open(top, NULL);
+    if (!log)
+    {
+        ynode_remove(del);
+        return 0;
+    }
+    yconn_digest_print(conn, top, top, log, &num, del, &delnum);
+    ynode_log_close(log, buf, buflen);
+    if (num <= 0)
+        CLEAR_BUF(*buf, *buflen);
+    if (delnum > 0)
+    {
+        FILE *fp = open_memstream(delbuf, delbuflen);
+        if (fp)
+        {
+            ynode_printf_to_fp(fp, del, 1, YDB_LEVEL_MAX);
+            fclose(fp);
+        }
+    }
+    ynode_remove(del);
+    ylog_info("ydb[%s] %d subtrees differ from the digests.\n", conn->datablock->name, num);
+    ylog_info("ydb[%s] %d subtrees removed from the digests.\n", conn->datablock->name, delnum);
+    return num;
+}
+
+// yconn_change_resume --
+// Send the changes missed by the reconnected subscriber from the change ring.
+// Return false if the ring doesn't keep all of them so that the data should be sent.
+static bool yconn_change_resume(yconn *conn)
 {
-    ydb_res res = YDB_OK;
-    eventid eid = {.fd = -1, .seq = 0};
-    ylog_inout();
-    if (!req_conn)
-        return eid;
-    YCONN_SIMPLE_INFO(req_conn);
-    req_conn->sendseq++;
-    if ((timeout - YDB_DELIVERY_LATENCY) > 0)
-        req_conn->send_timeout = timeout - YDB_DELIVERY_LATENCY;
-    else
-        req_conn->send_timeout = timeout;
-    YDB_ASSERT(!req_conn->func_send, YDB_E_FUNC);
-    res = req_conn->func_send(req_conn, op, YMSG_REQUEST, buf, buflen);
-    if (res)
+    ydb_res res;
+    unsigned long long seq;
+    ydb *datablock = conn->datablock;
+    if (!datablock->changes || !conn->change_epoch)
+        return false;
+    if (conn->change_epoch != datablock->change_epoch ||
+        conn->change_seq > datablock->change_seq ||
+        conn->change_seq + 1 < datablock->change_first)
     {
-        yconn_deferred_close(req_conn);
-        return eid;
+        ylog_info("ydb[%s] unable to resume from the change %llu (%llu-%llu kept).\n",
+                  datablock->name, conn->change_seq, datablock->change_first, datablock->change_seq);
+        return false;
     }
-    return waitevent_set_event(req_conn->datablock, req_conn->fd, req_conn->sendseq, req_conn->send_timeout, peid);
+    ylog_info("ydb[%s] resume %llu changes from the change %llu.\n",
+              datablock->name, datablock->change_seq - conn->change_seq, conn->change_seq);
+    for (seq = conn->change_seq + 1; seq <= datablock->change_seq; seq++)
+    {
+        struct ydb_change *c = &datablock->changes[seq % YDB_CHANGE_RING_SIZE];
+        datablock->pubchange = seq;
+        conn->sendseq++;
+        res = conn->func_send(conn, c->op, YMSG_PUBLISH, c->buf, c->buflen);
+        yconn_shm_release(datablock);
+        if (res)
+        {
+            yconn_deferred_close(conn);
+            break;
+        }
+    }
+    datablock->pubchange = 0;
+    return true;
 }
 
 ydb_res yconn_publish(yconn *recv_conn, yconn *req_conn, ydb *datablock, yconn_op op, char *buf, size_t buflen)
@@ -3827,6 +6180,9 @@ ydb_res yconn_publish(yconn *recv_conn, yconn *req_conn, ydb *datablock, yconn_o
     yconn *conn;
     ylist *publist = NULL;
     ytree_iter *iter;
+    ynode *src = NULL;
+    bool scanned = false;
+    ydb_res scanres = YDB_OK;
     ylog_inout();
     if (op == YOP_SYNC)
         return YDB_E_INVALID_MSG;
@@ -3840,6 +6196,13 @@ ydb_res yconn_publish(yconn *recv_conn, yconn *req_conn, ydb *datablock, yconn_o
                 ylog_info("ydb[%s] no data to publish.\n", recv_conn->datablock->name);
             return YDB_OK;
         }
+        // all changes of the datablock are published.
+        if (datablock)
+        {
+            if (datablock->journal)
+                ydb_journal_append(datablock, op, buf, buflen);
+            ydb_change_push(datablock, op, buf, buflen);
+        }
     }
     publist = ylist_create();
     if (!publist)
@@ -3874,18 +6237,59 @@ ydb_res yconn_publish(yconn *recv_conn, yconn *req_conn, ydb *datablock, yconn_o
     }
     ylog_info("ydb[%s] publish num: %d\n",
               datablock ? datablock->name : "...", ylist_size(publist));
+    if (datablock && ylist_size(publist) > 0)
+        yconn_pubhead_build(datablock, op);
     conn = ylist_pop_front(publist);
     while (conn)
     {
         ydb_res res;
+        char *fbuf = NULL;
+        size_t fbuflen = 0;
         YCONN_SIMPLE_INFO(conn);
         YDB_ASSERT(!conn->func_send, YDB_E_FUNC);
+        if (datablock && yconn_filtered(conn) && (op == YOP_MERGE || op == YOP_DELETE))
+        {
+            // The change is scanned once and then sent partially to the subscribers.
+            if (!scanned)
+            {
+                scanned = true;
+                scanres = ynode_scanf_from_buf(buf, buflen, 0, &src);
+                if (scanres)
+                {
+                    ynode_remove(src);
+                    src = NULL;
+                }
+            }
+            if (!scanres && yconn_filter_dumps(conn, src, &fbuf, &fbuflen) <= 0)
+            {
+                ylog_info("ydb[%s] no subscribed data to publish.\n", datablock->name);
+                conn = ylist_pop_front(publist);
+                continue;
+            }
+        }
         conn->sendseq++;
-        res = conn->func_send(conn, op, YMSG_PUBLISH, buf, buflen);
+        if (fbuf)
+        {
+            res = conn->func_send(conn, op, YMSG_PUBLISH, fbuf, fbuflen);
+            // The filtered data is only for the subscriber, so that its segment
+            // must not be reused for the next fbuf allocated at the same address.
+            if (conn->datablock->shmdata == fbuf)
+                yconn_shm_release(conn->datablock);
+        }
+        else
+            res = conn->func_send(conn, op, YMSG_PUBLISH, buf, buflen);
+        CLEAR_BUF(fbuf, fbuflen);
         if (res)
             yconn_deferred_close(conn);
         conn = ylist_pop_front(publist);
     }
+    if (datablock)
+    {
+        yconn_shm_release(datablock);
+        yconn_pubhead_release(datablock);
+        datablock->pubchange = 0;
+    }
+    ynode_remove(src);
     ylog_out();
     ylist_destroy(publist);
     return YDB_OK;
@@ -4083,6 +6487,8 @@ ydb_res yconn_merge(yconn *recv_conn, yconn *req_conn, bool not_publish, char *b
             recv_conn->datablock->top = top;
             if (!not_publish)
                 yconn_publish(recv_conn, req_conn, recv_conn->datablock, YOP_MERGE, logbuf, logbuflen);
+            else if (recv_conn->datablock->journal)
+                ydb_journal_append(recv_conn->datablock, YOP_MERGE, logbuf, logbuflen);
         }
         else
             res = YDB_E_MERGE_FAILED;
@@ -4122,6 +6528,8 @@ ydb_res yconn_delete(yconn *recv_conn, yconn *req_conn, bool not_publish, char *
         {
             if (!not_publish)
                 yconn_publish(recv_conn, req_conn, recv_conn->datablock, YOP_DELETE, logbuf, logbuflen);
+            else if (recv_conn->datablock->journal)
+                ydb_journal_append(recv_conn->datablock, YOP_DELETE, logbuf, logbuflen);
         }
         CLEAR_BUF(logbuf, logbuflen);
     }
@@ -4303,7 +6711,24 @@ eventid yconn_recv(yconn *recv_conn, yconn_op *op, ymsg_type *type, int *next)
                 {
                     char *ibuf = NULL;
                     size_t ibuflen = 0;
-                    ydb_dumps(recv_conn->datablock, &ibuf, &ibuflen);
+                    if (yconn_filtered(recv_conn))
+                        yconn_filter_dumps(recv_conn, recv_conn->datablock->top, &ibuf, &ibuflen);
+                    else if (yconn_change_resume(recv_conn))
+                        ylog_info("ydb[%s] no data to initialize.\n", recv_conn->datablock->name);
+                    else if (recv_conn->digest)
+                    {
+                        char *dbuf = NULL;
+                        size_t dbuflen = 0;
+                        yconn_digest_dumps(recv_conn, recv_conn->datablock->top,
+                                           &ibuf, &ibuflen, &dbuf, &dbuflen);
+                        // the subtrees removed or replaced are deleted first.
+                        if (dbuf && dbuflen > 0)
+                            yconn_response(recv_conn, YOP_DELETE, recvseq, false, true, dbuf, dbuflen);
+                        CLEAR_BUF(dbuf, dbuflen);
+                    }
+                    else
+                        ydb_dumps(recv_conn->datablock, &ibuf, &ibuflen);
+                    yconn_digest_clear(recv_conn);
                     yconn_response(recv_conn, YOP_INIT, recvseq, true, YDB_FAILED(res) ? false : true, ibuf, ibuflen);
                     CLEAR_BUF(ibuf, ibuflen);
                 }
@@ -4448,6 +6873,16 @@ ydb_res yconn_serve(ydb *datablock, int timeout)
             int next = 0;
             yconn_op op = YOP_NONE;
             ymsg_type type = YMSG_NONE;
+            if (IS_SET(event[i].events, EPOLLOUT))
+            {
+                if (yconn_sendq_flush(conn))
+                {
+                    yconn_deferred_close(conn);
+                    continue;
+                }
+                if (!IS_SET(event[i].events, EPOLLIN | EPOLLHUP | EPOLLERR))
+                    continue;
+            }
         recv_again:
             yconn_recv(conn, &op, &type, &next);
             if (next)
@@ -4464,6 +6899,7 @@ failed:
 
 ydb_res ydb_serve(ydb *datablock, int timeout)
 {
+    ydb_counter_flush(datablock);
     return yconn_serve(datablock, timeout);
 }
 
@@ -4530,6 +6966,16 @@ ydb_res yconn_serve_blocking(ydb *datablock, eventid eid, int timeout)
                 yconn_op op = YOP_NONE;
                 ymsg_type type = YMSG_NONE;
                 eventid reid;
+                if (IS_SET(event[i].events, EPOLLOUT))
+                {
+                    if (yconn_sendq_flush(conn))
+                    {
+                        yconn_deferred_close(conn);
+                        continue;
+                    }
+                    if (!IS_SET(event[i].events, EPOLLIN | EPOLLHUP | EPOLLERR))
+                        continue;
+                }
             recv_again:
                 reid = yconn_recv(conn, &op, &type, &next);
                 if (is_equal_waitevent(eid, reid))
@@ -4556,10 +7002,110 @@ int ydb_fd(ydb *datablock)
     return -1;
 }
 
+ydb_res ydb_send_queue_limit(ydb *datablock, size_t limit)
+{
+    if (datablock)
+    {
+        lock(datablock);
+        datablock->sendq_limit = limit;
+        ylog_debug("set send queue limit %zu\n", datablock->sendq_limit);
+        unlock(datablock);
+        return YDB_OK;
+    }
+    return YDB_E_INVALID_ARGS;
+}
+
+ydb_res ydb_send_queue_stats(ydb *datablock, size_t *queued, unsigned int *dropped)
+{
+    ytree_iter *iter;
+    size_t total = 0;
+    if (!datablock)
+        return YDB_E_INVALID_ARGS;
+    lock(datablock);
+    iter = ytree_first(datablock->conn);
+    for (; iter != NULL; iter = ytree_next(datablock->conn, iter))
+    {
+        yconn *conn = ytree_data(iter);
+        if (IS_SET(conn->flags, YCONN_TYPE_UNIX | YCONN_TYPE_INET))
+            total += yconn_sendq_len(conn);
+    }
+    if (queued)
+        *queued = total;
+    if (dropped)
+        *dropped = datablock->sendq_drops;
+    unlock(datablock);
+    return YDB_OK;
+}
+
+// return the first wildcard segment (* or **) of the path.
+static char *ydb_path_wildcard(char *path)
+{
+    char *s;
+    int depth = 0;
+    for (s = path; *s; s++)
+    {
+        if (*s == '[')
+            depth++;
+        else if (*s == ']')
+            depth--;
+        else if (*s == '*' && depth == 0 && (s == path || s[-1] == '/'))
+        {
+            char *e = (s[1] == '*') ? s + 2 : s + 1;
+            if (*e == 0 || *e == '/')
+                return s;
+        }
+    }
+    return NULL;
+}
+
+// get the node to be hooked. The path is created if not exists and create is set.
+// If the path has the wildcard segments, the node of the path before the first
+// wildcard segment is returned and the pattern is set to the rest of the path.
+static ynode *ydb_write_hook_node(ydb *datablock, char *path, char **pattern, bool create)
+{
+    ynode *cur;
+    char *prefix = NULL;
+    *pattern = NULL;
+    if (!path)
+        return datablock->top;
+    *pattern = ydb_path_wildcard(path);
+    if (*pattern)
+    {
+        if (*pattern - path <= 1)
+            return datablock->top;
+        prefix = strndup(path, *pattern - path - 1);
+        if (!prefix)
+            return NULL;
+        path = prefix;
+    }
+    cur = ynode_search(datablock->top, path);
+    if (!cur && create)
+    {
+        char *rbuf = NULL;
+        size_t rbuflen = 0;
+        ynode_log *log = NULL;
+        ynode *src = NULL;
+        log = ydb_log_open(datablock, NULL);
+        src = ynode_create_path(path, datablock->top, log);
+        ydb_log_close(datablock, log, &rbuf, &rbuflen);
+        if (rbuf)
+        {
+            if (src)
+                yconn_publish(NULL, NULL, datablock, YOP_MERGE, rbuf, rbuflen);
+            free(rbuf);
+        }
+        cur = ynode_search(datablock->top, path);
+    }
+    if (prefix)
+        free(prefix);
+    return cur;
+}
+
 ydb_res ydb_write_hook_add(ydb *datablock, char *path, int suppressed, ydb_write_hook func, int num, ...)
 {
     ydb_res res = YDB_OK;
     ynode *cur;
+    char *pattern;
     void *user[5] = {0};
     unsigned int flags = 0x0;
 
@@ -4570,31 +7116,9 @@ ydb_res ydb_write_hook_add(ydb *datablock, char *path, int suppressed, ydb_write
     if (suppressed)
         SET_FLAG(flags, YNODE_SUPPRESS_HOOK);
 
-    if (path)
-    {
-        lock(datablock);
-        cur = ynode_search(datablock->top, path);
-        if (!cur)
-        {
-            char *rbuf = NULL;
-            size_t rbuflen = 0;
-            ynode_log *log = NULL;
-            ynode *src = NULL;
-            log = ydb_log_open(datablock, NULL);
-            src = ynode_create_path(path, datablock->top, log);
-            ydb_log_close(datablock, log, &rbuf, &rbuflen);
-            if (rbuf)
-            {
-                if (src)
-                    yconn_publish(NULL, NULL, datablock, YOP_MERGE, rbuf, rbuflen);
-                free(rbuf);
-            }
-            cur = ynode_search(datablock->top, path);
-            YDB_FAIL(!cur, YDB_E_NO_ENTRY);
-        }
-    }
-    else
-        cur = datablock->top;
+    lock(datablock);
+    cur = ydb_write_hook_node(datablock, path, &pattern, true);
+    YDB_FAIL(!cur, YDB_E_NO_ENTRY);
 
     user[0] = datablock;
     num++;
@@ -4612,7 +7136,35 @@ ydb_res ydb_write_hook_add(ydb *datablock, char *path, int suppressed, ydb_write
         }
         va_end(ap);
     }
-    res = yhook_register(cur, flags, (yhook_func)func, num, user);
+    if (pattern)
+        res = yhook_register_pattern(cur, pattern, flags, (yhook_func)func, num, user);
+    else
+        res = yhook_register(cur, flags, (yhook_func)func, num, user);
+    YDB_FAIL(res, YDB_E_HOOK_ADD);
+failed:
+    unlock(datablock);
+    ylog_out();
+    return res;
+}
+
+ydb_res ydb_write_batch_hook_add(ydb *datablock, char *path, ydb_write_batch_hook func, void *user)
+{
+    ydb_res res = YDB_OK;
+    ynode *cur;
+    char *pattern;
+    void *users[2];
+
+    ylog_in();
+    YDB_FAIL(!datablock || !func, YDB_E_INVALID_ARGS);
+    lock(datablock);
+    cur = ydb_write_hook_node(datablock, path, &pattern, true);
+    YDB_FAIL(!cur, YDB_E_NO_ENTRY);
+    users[0] = datablock;
+    users[1] = user;
+    if (pattern)
+        res = yhook_register_pattern(cur, pattern, YNODE_BATCH_HOOK, (yhook_func)func, 2, users);
+    else
+        res = yhook_register(cur, YNODE_BATCH_HOOK, (yhook_func)func, 2, users);
     YDB_FAIL(res, YDB_E_HOOK_ADD);
 failed:
     unlock(datablock);
@@ -4623,20 +7175,17 @@ failed:
 void ydb_write_hook_delete(ydb *datablock, char *path)
 {
     ynode *cur;
+    char *pattern;
     if (!datablock)
         return;
     lock(datablock);
-    if (path)
-    {
-        cur = ynode_search(datablock->top, path);
-        if (!cur)
-            goto failed;
-    }
+    cur = ydb_write_hook_node(datablock, path, &pattern, false);
+    if (!cur)
+        goto failed;
+    if (pattern)
+        yhook_unregister_pattern(cur, pattern);
     else
-    {
-        cur = datablock->top;
-    }
-    yhook_unregister(cur);
+        yhook_unregister(cur);
 failed:
     unlock(datablock);
 }
@@ -4828,3 +7377,235 @@ ydb_res ydb_traverse(ydb *datablock, ynode *cur, ydb_traverse_callback func, cha
     unlock(datablock);
     return res;
 }
+
+unsigned long ydb_generation(ydb *datablock)
+{
+    unsigned long gen;
+    if (!datablock)
+        return 0;
+    lock(datablock);
+    gen = ynode_generation(datablock->top);
+    unlock(datablock);
+    return gen;
+}
+
+unsigned long long ydb_digest(ydb *datablock, char *path)
+{
+    ynode *cur;
+    unsigned long long digest = 0;
+    if (!datablock)
+        return 0;
+    lock(datablock);
+    cur = datablock->top;
+    if (path && strcmp(path, "/") != 0)
+        cur = ynode_search(datablock->top, path);
+    if (cur)
+        digest = ynode_digest(cur);
+    unlock(datablock);
+    return digest;
+}
+
+ydb_res ydb_changed_since(ydb *datablock, char *path, unsigned long gen,
+                          ydb_traverse_callback func, char *flags, void *U1)
+{
+    ydb_res res;
+    ynode *cur;
+    unsigned int trflags = 0x0;
+    struct ydb_traverse_data data;
+    if (!datablock || !func)
+        return YDB_E_INVALID_ARGS;
+    if (flags)
+    {
+        if (strstr(flags, "leaf-only"))
+            SET_FLAG(trflags, YNODE_LEAF_ONLY);
+        else if (strstr(flags, "val-only"))
+            SET_FLAG(trflags, YNODE_VAL_ONLY);
+    }
+    memset(&data, 0x0, sizeof(struct ydb_traverse_data));
+    data.cb = func;
+    data.num = 1;
+    data.user[0] = U1;
+    data.datablock = datablock;
+    lock(datablock);
+    cur = datablock->top;
+    if (path && strcmp(path, "/") != 0)
+        cur = ynode_search(datablock->top, path);
+    if (cur)
+        res = ynode_traverse_changed(cur, gen, ydb_traverse_sub, &data, trflags);
+    else
+        res = YDB_E_NO_ENTRY;
+    unlock(datablock);
+    return res;
+}
+
+#define YDB_TRAVERSE_THREAD_MAX 256
+
+struct ydb_traverse_parallel_data
+{
+    ydb *datablock;
+    ydb_traverse_callback cb;
+    unsigned int flags;
+    ynode **tasks; // the subtrees at the split depth
+    int tasknum;
+    int tasksize;
+    ynode **upper; // the nodes above the split depth
+    int uppernum;
+    int uppersize;
+    int next; // the next task to be taken by a thread
+    int stop;
+    int res;
+};
+
+struct ydb_traverse_worker
+{
+    struct ydb_traverse_parallel_data *pdata;
+    void *state;
+    pthread_t tid;
+    bool running;
+};
+
+static int ydb_traverse_push(ynode ***nodes, int *num, int *size, ynode *node)
+{
+    if (*num >= *size)
+    {
+        int newsize = *size ? *size * 2 : 64;
+        ynode **n = realloc(*nodes, sizeof(ynode *) * newsize);
+        if (!n)
+            return -1;
+        *nodes = n;
+        *size = newsize;
+    }
+    (*nodes)[(*num)++] = node;
+    return 0;
+}
+
+// ydb_traverse_split --
+// Split the node into the subtrees at the depth.
+static int ydb_traverse_split(struct ydb_traverse_parallel_data *pdata, ynode *node, int level, int depth)
+{
+    ynode *child;
+    if (level >= depth)
+        return ydb_traverse_push(&pdata->tasks, &pdata->tasknum, &pdata->tasksize, node);
+    if (ydb_traverse_push(&pdata->upper, &pdata->uppernum, &pdata->uppersize, node))
+        return -1;
+    for (child = ydb_down(node); child; child = ydb_next(child))
+    {
+        if (ydb_traverse_split(pdata, child, level + 1, depth))
+            return -1;
+    }
+    return 0;
+}
+
+static ydb_res ydb_traverse_node(struct ydb_traverse_parallel_data *pdata, ynode *node, void *state)
+{
+    ydb_res res = pdata->cb(pdata->datablock, node, state);
+    if (res)
+    {
+        int expected = YDB_OK;
+        __atomic_compare_exchange_n(&pdata->res, &expected, res, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        __atomic_store_n(&pdata->stop, 1, __ATOMIC_RELAXED);
+    }
+    return res;
+}
+
+static void *ydb_traverse_worker_run(void *arg)
+{
+    struct ydb_traverse_worker *worker = arg;
+    struct ydb_traverse_parallel_data *pdata = worker->pdata;
+    while (!__atomic_load_n(&pdata->stop, __ATOMIC_RELAXED))
+    {
+        ynode *node;
+        ynode_iter iter;
+        // The idle thread takes the next subtree.
+        int t = __atomic_fetch_add(&pdata->next, 1, __ATOMIC_RELAXED);
+        if (t >= pdata->tasknum)
+            break;
+        node = ynode_iter_begin(&iter, pdata->tasks[t], pdata->flags);
+        for (; node; node = ynode_iter_next(&iter))
+        {
+            if (ydb_traverse_node(pdata, node, worker->state))
+                break;
+        }
+    }
+    return NULL;
+}
+
+ydb_res ydb_traverse_parallel(ydb *datablock, ynode *cur, ydb_traverse_callback func,
+                              char *flags, int depth, int threads, void *states[])
+{
+    int i;
+    ydb_res res = YDB_OK;
+    struct ydb_traverse_parallel_data pdata;
+    struct ydb_traverse_worker *workers = NULL;
+    if (!datablock || !func)
+        return YDB_E_INVALID_ARGS;
+    if (threads <= 0 || threads > YDB_TRAVERSE_THREAD_MAX)
+        return YDB_E_INVALID_ARGS;
+    if (depth <= 0)
+        depth = 1;
+    memset(&pdata, 0x0, sizeof(pdata));
+    pdata.datablock = datablock;
+    pdata.cb = func;
+    if (flags)
+    {
+        if (strstr(flags, "leaf-first"))
+            SET_FLAG(pdata.flags, YNODE_LEAF_FIRST);
+        if (strstr(flags, "leaf-only"))
+            SET_FLAG(pdata.flags, YNODE_LEAF_ONLY);
+        else if (strstr(flags, "val-only"))
+            SET_FLAG(pdata.flags, YNODE_VAL_ONLY);
+    }
+    ylog_in();
+    lock(datablock);
+    if (!cur)
+        cur = datablock->top;
+    YDB_FAIL(ydb_traverse_split(&pdata, cur, 0, depth), YDB_E_MEM_ALLOC);
+    if (threads > pdata.tasknum)
+        threads = pdata.tasknum;
+    if (threads > 0)
+    {
+        workers = malloc(sizeof(struct ydb_traverse_worker) * threads);
+        YDB_FAIL(!workers, YDB_E_MEM_ALLOC);
+    }
+    for (i = 0; i < threads; i++)
+    {
+        workers[i].pdata = &pdata;
+        workers[i].state = states ? states[i] : NULL;
+        workers[i].running = false;
+        // The caller's thread works as the first worker.
+        if (i > 0 && pthread_create(&workers[i].tid, NULL, ydb_traverse_worker_run, &workers[i]) == 0)
+            workers[i].running = true;
+    }
+    if (threads > 0)
+        ydb_traverse_worker_run(&workers[0]);
+    for (i = 1; i < threads; i++)
+    {
+        if (workers[i].running)
+            pthread_join(workers[i].tid, NULL);
+        else // run the work of the failed thread.
+            ydb_traverse_worker_run(&workers[i]);
+    }
+    // The nodes above the split depth are traversed by the caller's thread.
+    for (i = 0; i < pdata.uppernum && !pdata.stop; i++)
+    {
+        ynode *node;
+        if (IS_SET(pdata.flags, YNODE_LEAF_FIRST))
+            node = pdata.upper[pdata.uppernum - i - 1];
+        else
+            node = pdata.upper[i];
+        if (ynode_iter_matched(node, pdata.flags))
+            ydb_traverse_node(&pdata, node, states ? states[0] : NULL);
+    }
+    res = pdata.res;
+failed:
+    unlock(datablock);
+    if (workers)
+        free(workers);
+    if (pdata.tasks)
+        free(pdata.tasks);
+    if (pdata.upper)
+        free(pdata.upper);
+    ylog_out();
+    return res;
+}
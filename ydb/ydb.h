@@ -13,6 +13,12 @@
 #define YDB_LEVEL_MAX 16
 #define YDB_CONN_MAX 16
 #define YDB_DEFAULT_TIMEOUT 3000 //ms
+#define YDB_SEND_QUEUE_LIMIT (8 * 1024 * 1024) // bytes
+#define YDB_CHANGE_RING_SIZE 1024 // the number of the recent changes kept for the subscriber resume
+#define YDB_CHANGE_RING_BYTES (4 * 1024 * 1024) // bytes
+#define YDB_JOURNAL_SYNC_SIZE (64 * 1024) // bytes
+#define YDB_JOURNAL_SYNC_MSEC 100 //ms
+#define YDB_JOURNAL_COMPACT_SIZE (4 * 1024 * 1024) // bytes
 #define YDB_DELIVERY_LATENCY 100 //ms
 #define YDB_DEFAULT_PORT 3677
 
@@ -95,6 +101,17 @@ char *binary_to_base64_lf(unsigned char *binary, size_t binarylen, size_t *base6
 // It should be free
 unsigned char *base64_to_binary(char *base64, size_t base64len, size_t *binarylen);
 
+// binary_to_base64_fp --
+// Write base64 string to the stream without the string allocation.
+// Return the length written.
+size_t binary_to_base64_fp(FILE *stream, unsigned char *binary, size_t binarylen, int lf);
+
+// base64_to_binary_buf --
+// Decode base64 string into the binary buffer.
+// binarylen is the buffer size on input and the decoded length on output.
+// The buffer size should be (base64len / 4 * 3 + 3) at least.
+ydb_res base64_to_binary_buf(char *base64, size_t base64len, unsigned char *binary, size_t *binarylen);
+
 // ydb_lock --
 // Lock the entrace of the YDB instance
 void ydb_lock(struct _ydb *datablock);
@@ -107,6 +124,23 @@ void ydb_unlock(struct _ydb *datablock);
 // Open an instance of YAML DataBlock
 ydb *ydb_open(char *name);
 
+// ydb_open_persistent --
+// Open an instance of YAML DataBlock stored in the directory (dir).
+// The data is restored from <dir>/<name>.snapshot and <dir>/<name>.journal,
+// and then all changes of the datablock are appended to the journal.
+//  - The journal is fsync'ed every YDB_JOURNAL_SYNC_SIZE bytes or
+//    YDB_JOURNAL_SYNC_MSEC (while ydb_serve() runs), by ydb_journal_sync() and on ydb_close().
+//  - The journal is compacted into the snapshot at YDB_JOURNAL_COMPACT_SIZE.
+ydb *ydb_open_persistent(char *name, char *dir);
+
+// ydb_journal_sync --
+// Flush the journal of the persistent datablock to the storage.
+ydb_res ydb_journal_sync(ydb *datablock);
+
+// ydb_journal_compact --
+// Write the persistent datablock to the snapshot and empty the journal.
+ydb_res ydb_journal_compact(ydb *datablock);
+
 // ydb_get --
 // Get the opend YAML DataBlock and also return ynode
 ydb *ydb_get(char *name_and_path, ynode **node);
@@ -127,6 +161,7 @@ const char *ydb_name(ydb *datablock);
 //   - uss://unix-socket-name (hidden unix socket; socket file doesn’t appear from filesystem.)
 //   - tcp://ipaddr:port (tcp)
 //   - fifo://named-fifo-input,named-fifo-output
+//   - shm://name (hidden unix socket notifying the published data in the shared memory ring (memfd))
 //  - flags:
 //    pub(publisher)/sub(subscriber): YDB role configuration
 //    w(writable): connect to the channel to write data in subscriber role.
@@ -140,6 +175,16 @@ ydb_res ydb_connect(ydb *datablock, char *addr, char *flags);
 // Destroy or disconnect to the YDB IPC (Inter Process Communication) channel
 ydb_res ydb_disconnect(ydb *datablock, char *addr);
 
+// ydb_subscribe --
+// Subscribe only the data change under the path from the YDB publisher.
+// The publisher sends the subscriber the changes and the initial data
+// under the subscribed paths if one or more paths are subscribed.
+// The paths are updated to the publisher immediately if connected.
+//  - addr: The address of the connection (NULL: uss://YDB_NAME)
+//  - path: The path to subscribe ("/" to remove all paths and subscribe all data)
+// e.g. ydb_subscribe(db, "uss://netconf", "/interfaces")
+ydb_res ydb_subscribe(ydb *datablock, char *addr, char *path);
+
 // ydb_is_connected --
 // Check the YDB IPC channel connected or not.
 int ydb_is_connected(ydb *datablock, char *addr);
@@ -161,6 +206,18 @@ ydb_res ydb_serve(ydb *datablock, int timeout);
 // Return the fd (file descriptor) opened for YDB IPC channel.
 int ydb_fd(ydb *datablock);
 
+// ydb_send_queue_limit --
+// Set the high-water mark (bytes) of the data queued to a subscriber not reading.
+// The data is queued instead of blocking the publisher and sent when the subscriber is ready.
+// The subscriber is dropped over the limit and then resynchronized when it reconnects.
+//  - limit: 0 to disable the limit (YDB_SEND_QUEUE_LIMIT by default)
+ydb_res ydb_send_queue_limit(ydb *datablock, size_t limit);
+
+// ydb_send_queue_stats --
+// Return the total bytes queued to the connections and
+// the number of the subscribers dropped by the send queue limit.
+ydb_res ydb_send_queue_stats(ydb *datablock, size_t *queued, unsigned int *dropped);
+
 // ydb_clear --
 // Clear all data in the YAML DataBlock
 ydb_res ydb_clear(ydb *datablock);
@@ -216,7 +273,11 @@ ynode *ydb_last(ynode *node);
 // return node tag
 const char *ydb_tag(ynode *node);
 // Return node value if that is a value node.
+// The binary leaf (!!binary) is returned as the base64 string
+// that is valid until the next change of the datablock.
 const char *ydb_value(ynode *node);
+// Return node binary data and the length if that is a binary leaf (!!binary).
+const void *ydb_blob(ynode *node, size_t *len);
 // Return the key of the node when the parent is a map (hasp).
 const char *ydb_key(ynode *node);
 // Return the index of the node when the parent is a seq (list).
@@ -295,6 +356,27 @@ ydb_res ydb_path_write(ydb *datablock, const char *format, ...);
 // ydb_path_delete(datablock, "/path/to/update\n")
 ydb_res ydb_path_delete(ydb *datablock, const char *format, ...);
 
+// ydb_txn_begin --
+// Start a transaction. ydb_write, ydb_delete, ydb_path_write, ydb_path_delete,
+// ydb_parse, ydb_parses, ydb_add, ydb_rm and ydb_blob_write are staged
+// instead of being applied until ydb_txn_commit or ydb_txn_abort.
+// The staged data is not visible to ydb_read before the commit.
+// ydb_counter_add fails during the transaction. ydb_clean and the changes
+// received from the remote ydb instances (ydb_serve) are still applied at once.
+// Nothing is locked for the other threads unless PTHREAD_LOCK is enabled,
+// so the transaction should be used by the thread that owns the datablock.
+// e.g. ydb_txn_begin(db); ydb_path_write(db, "/a/b=%d", 1); ...; ydb_txn_commit(db);
+ydb_res ydb_txn_begin(ydb *datablock);
+
+// ydb_txn_commit --
+// Apply the staged changes in order. The consecutive writes are merged,
+// logged and published at once and their write hooks run once per node.
+ydb_res ydb_txn_commit(ydb *datablock);
+
+// ydb_txn_abort --
+// Discard the staged changes of the transaction.
+ydb_res ydb_txn_abort(ydb *datablock);
+
 // ydb_path_read --
 // Read the value from ydb using input path
 // const char *value = ydb_path_read(datablock, "/path/to/read")
@@ -302,6 +384,40 @@ const char *ydb_path_read(ydb *datablock, const char *format, ...);
 
 int ydb_path_fprintf(FILE *stream, ydb *datablock, const char *format, ...);
 
+// ydb_blob_write --
+// Write the binary data to the leaf of the path without base64 encoding.
+// The binary leaf (!!binary) keeps the raw data in memory and is
+// encoded to base64 only when it is printed to YAML (dump, publish)
+// or read as the string (ydb_read, ydb_path_read, ydb_value).
+// ydb_read encodes it into the buffer of the caller and the string returned by
+// ydb_path_read and ydb_value is kept until the next change of the datablock.
+// ydb_blob_write(datablock, "/path/to/blob", data, len)
+ydb_res ydb_blob_write(ydb *datablock, const char *path, const void *data, size_t len);
+
+// ydb_counter_add --
+// Add delta to the integer leaf (!!int) of the path in place.
+// A string leaf having an integer is converted to the integer leaf and
+// the leaf is created with delta if it doesn't exist.
+// The !!int and !!float leaves written by the other APIs keep their
+// original text (e.g. 007, 1.50) unless ydb_counter_add changes them.
+// The increments are not logged, published nor hooked one by one;
+// they are logged, published and hooked at once by ydb_counter_flush or ydb_serve.
+// ydb_counter_add is not allowed in a transaction (YDB_E_CTRL).
+// ydb_counter_add(datablock, "/interfaces/ge1/in-octets", 64)
+ydb_res ydb_counter_add(ydb *datablock, const char *path, long long delta);
+
+// ydb_counter_flush --
+// Log and publish the counters changed by ydb_counter_add at once.
+// The write hooks of the changed counters are called with the replace op
+// and the same node as cur and new (the counter is changed in place).
+ydb_res ydb_counter_flush(ydb *datablock);
+
+// ydb_blob_read --
+// Read the binary data of the leaf without copying.
+// The data is valid until the leaf is changed or deleted.
+// Hold ydb_lock while using it if other threads write the datablock.
+ydb_res ydb_blob_read(ydb *datablock, const char *path, const void **data, size_t *len);
+
 // ydb_read_hook: The callback executed by ydb_read() to update the datablock at reading.
 //  - ydb_read_hook0 - 4: The callback prototype according to the USER (U1-4) number.
 //  - path: The target path to be updated
@@ -309,6 +425,8 @@ int ydb_path_fprintf(FILE *stream, ydb *datablock, const char *format, ...);
 //        YAML format stream should be written by the ydb_read_hook.
 //  - U1-4: The user-defined data
 //  - num: The number of the user-defined data (U1-4)
+// The read hooks found by a read are executed one by one by the reading thread
+// and their results are merged at once after all of them.
 typedef ydb_res (*ydb_read_hook0)(ydb *datablock, const char *path, FILE *stream);
 typedef ydb_res (*ydb_read_hook1)(ydb *datablock, const char *path, FILE *stream, void *U1);
 typedef ydb_res (*ydb_read_hook2)(ydb *datablock, const char *path, FILE *stream, void *U1, void *U2);
@@ -316,7 +434,16 @@ typedef ydb_res (*ydb_read_hook3)(ydb *datablock, const char *path, FILE *stream
 typedef ydb_res (*ydb_read_hook4)(ydb *datablock, const char *path, FILE *stream, void *U1, void *U2, void *U3, void *U4);
 typedef ydb_read_hook1 ydb_read_hook;
 
-ydb_res ydb_read_hook_add(ydb *datablock, char *path, ydb_read_hook hook, int num, ...);
+// ydb_read_hook_add --
+// Add the read hook to the path.
+//  - parallel: If set, the read hook is executed concurrently with the other read hooks
+//    of the same read by up to 4 threads (the reading thread and the worker threads
+//    of the datablock created by the first parallel read hook).
+//    The parallel read hook must not call the ydb API of the datablock and
+//    the data shared with the other read hooks must be thread-safe.
+//    Nothing is locked for the parallel read hooks unless PTHREAD_LOCK is enabled;
+//    the reading thread waits for all read hooks before the merge.
+ydb_res ydb_read_hook_add(ydb *datablock, char *path, int parallel, ydb_read_hook hook, int num, ...);
 void ydb_read_hook_delete(ydb *datablock, char *path);
 
 // ydb_write_hook: The callback is executed by ydb_write() or ydb_delete().
@@ -340,9 +467,34 @@ typedef void (*ydb_write_suppressed_hook3)(ydb *datablock, char op, ynode *_base
 typedef void (*ydb_write_suppressed_hook4)(ydb *datablock, char op, ynode *_base, void *U1, void *U2, void *U3, void *U4);
 typedef ydb_write_hook1 ydb_write_hook;
 
+// ydb_write_hook_add --
+// Add the write hook to the path. The path could have the wildcard segments
+// to hook all matched nodes without the registration per node.
+//  - "*": any single path segment (e.g. /interfaces/*/state/oper-status)
+//  - "**": zero or more path segments (e.g. /interfaces/**/counters)
+// The _base of the wildcard hook is the node of the path before the first wildcard.
 ydb_res ydb_write_hook_add(ydb *datablock, char *path, int suppressed, ydb_write_hook func, int num, ...);
 void ydb_write_hook_delete(ydb *datablock, char *path);
 
+// ydb_write_batch_hook: The callback is executed once for all changes under the path
+// made by a ydb_write(), ydb_delete() or ydb_txn_commit() instead of once per change.
+//  - _base: The base data node of ydb_write_batch_hook registered
+//  - changes: The list of the changes (op, _cur, _new) in the order of the changes
+//  - num: The number of the changes
+//  - user: The USER-defined data
+// The nodes in the changes are valid only within the callback.
+typedef struct _ydb_write_change
+{
+    char op;     // c: create, d: delete, r: replace
+    ynode *cur;  // The current data node (old data)
+    ynode *_new; // The new data node to be replaced or created.
+} ydb_write_change;
+typedef void (*ydb_write_batch_hook)(ydb *datablock, ynode *_base, ydb_write_change *changes, int num, void *user);
+
+// ydb_write_batch_hook_add --
+// Add the batch hook to the path. ydb_write_hook_delete() removes it.
+ydb_res ydb_write_batch_hook_add(ydb *datablock, char *path, ydb_write_batch_hook func, void *user);
+
 // ydb_onchange_hook: executed before, after ydb data changes
 typedef void (*ydb_onchange_hook)(ydb *datablock, int started, void *user);
 ydb_res ydb_onchange_hook_add(ydb *datablock, ydb_onchange_hook hook, void *user);
@@ -380,6 +532,38 @@ typedef ydb_res (*ydb_traverse_callback4)(ydb *datablock, ynode *cur, void *U1,
 typedef ydb_traverse_callback1 ydb_traverse_callback;
 ydb_res ydb_traverse(ydb *datablock, ynode *cur, ydb_traverse_callback func, char *flags, int num, ...);
 
+// Traverse the node using the threads for the read-only scan.
+// The subtrees at the depth from the node are traversed by the threads in parallel and
+// the nodes above the depth are traversed after that. The order of the nodes is not kept.
+//  - depth: The depth to split the subtrees (1 if depth <= 0)
+//  - threads: The number of threads including the caller's thread
+//  - states: The user-defined data of each thread (NULL or an array of the threads)
+//    passed to the cb as U1, which is merged by the caller after ydb_traverse_parallel().
+// The cb must not change the datablock and must not call ydb API except
+// the node accessors (ydb_down, ydb_next, ydb_key, ydb_value, etc.).
+ydb_res ydb_traverse_parallel(ydb *datablock, ynode *cur, ydb_traverse_callback func,
+                              char *flags, int depth, int threads, void *states[]);
+
+// Return the generation of the latest change of the datablock.
+// The generation is increased by each change and stamped on the changed nodes and their ancestors.
+// Each datablock has its own generation not affected by the changes of other datablocks.
+unsigned long ydb_generation(ydb *datablock);
+
+// Return the digest of the node and its descendants in the path (0: no entry).
+// The same data has the same digest so that the datablocks can be compared by the digests.
+// A subscriber sends its digests on (re)connection to receive only the different subtrees.
+unsigned long long ydb_digest(ydb *datablock, char *path);
+
+// Traverse only the nodes changed after the generation under the path.
+// The parent of a deleted node is traversed as a changed node.
+//  - path: The path to the node to be traversed (NULL: the top node)
+//  - gen: The generation returned by ydb_generation()
+//  - flags: leaf-only or val-only (NULL: all changed branches and leaves)
+//  - U1: The user-defined data passed to the cb
+// e.g. gen = ydb_generation(db); ... ydb_changed_since(db, "/interfaces", gen, cb, "val-only", NULL);
+ydb_res ydb_changed_since(ydb *datablock, char *path, unsigned long gen,
+                          ydb_traverse_callback func, char *flags, void *U1);
+
 // disable variable arguments of the ydb instance for golang
 void ydb_disable_variable_arguments(ydb *datablock);
 
@@ -7,58 +7,310 @@
 
 #include "ymap.h"
 
-struct _ymap
-{
-    ytree *tree;
-    ylist *list;
-};
+// The index table slots
+#define YMAP_EMPTY -1
+#define YMAP_DUMMY -2 // the deleted entry
+#define YMAP_MIN_CAPACITY 4
 
+// ymap_iter is the entry of the ymap.
+// The deleted entry has the null key until the entries are compacted.
 struct _ymap_iter
 {
-    ylist_iter *ilist;
     void *key;
     void *data;
+    unsigned int hash;
 };
 
-// create a ymap
-ymap *ymap_create(ytree_cmp comp, user_free kfree)
+// The entries are ordered by the insert sequence and
+// the index table (open addressing) has the positions of the entries.
+// The index table is twice the capacity of the entries.
+struct _ymap
+{
+    ymap_iter *entries;
+    int *index;
+    unsigned int mask;     // the size of the index table - 1
+    unsigned int capacity; // the size of the entries
+    unsigned int used;     // the number of the entries including the deleted
+    unsigned int size;     // the number of the valid entries
+    unsigned int dummy;    // the number of the deleted slots in the index table
+    ymap_hash hash;
+    ytree_cmp comp;
+    user_free kfree;
+};
+
+// FNV-1a
+static unsigned int ymap_hash_str(void *key)
+{
+    const unsigned char *s = key;
+    unsigned int h = 2166136261u;
+    while (*s)
+    {
+        h ^= *s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned int ymap_hash_ptr(void *key)
+{
+    uint64_t h = (uintptr_t)key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (unsigned int)h;
+}
+
+static inline int ymap_equal(ymap *map, void *k1, void *k2)
+{
+    if (k1 == k2)
+        return 1;
+    if (map->comp)
+        return map->comp(k1, k2) == 0;
+    return 0;
+}
+
+static inline int ymap_order(ymap *map, void *k1, void *k2)
+{
+    if (map->comp)
+        return map->comp(k1, k2);
+    return (k1 < k2) ? -1 : ((k1 > k2) ? 1 : 0);
+}
+
+// return the entry position of the key or -1 if not found.
+// slot is set to the index table slot of the entry.
+static int ymap_lookup(ymap *map, void *key, unsigned int hash, unsigned int *slot)
+{
+    unsigned int i, n;
+    if (!map->index)
+        return -1;
+    for (i = hash & map->mask, n = 0; n <= map->mask; i = (i + 1) & map->mask, n++)
+    {
+        int pos = map->index[i];
+        if (pos == YMAP_EMPTY)
+            return -1;
+        if (pos >= 0 && map->entries[pos].hash == hash &&
+            ymap_equal(map, map->entries[pos].key, key))
+        {
+            if (slot)
+                *slot = i;
+            return pos;
+        }
+    }
+    return -1;
+}
+
+// set the entry position to an empty (or deleted) slot of the index table.
+static void ymap_index_set(ymap *map, unsigned int hash, int pos)
+{
+    unsigned int i;
+    for (i = hash & map->mask; map->index[i] >= 0; i = (i + 1) & map->mask)
+        ;
+    if (map->index[i] == YMAP_DUMMY)
+        map->dummy--;
+    map->index[i] = pos;
+}
+
+// rebuild the index table from the entries.
+static void ymap_reindex(ymap *map)
+{
+    unsigned int i;
+    memset(map->index, 0xff, sizeof(int) * (map->mask + 1)); // YMAP_EMPTY
+    map->dummy = 0;
+    for (i = 0; i < map->used; i++)
+    {
+        if (map->entries[i].key)
+            ymap_index_set(map, map->entries[i].hash, i);
+    }
+}
+
+// compact the entries into new entries of the capacity and rebuild the index table.
+// pos is updated to the new position of the entry (or the end) if set.
+static int ymap_rebuild(ymap *map, unsigned int capacity, int *pos)
+{
+    unsigned int i, n = 0;
+    ymap_iter *entries = malloc(sizeof(ymap_iter) * capacity);
+    int *index = malloc(sizeof(int) * capacity * 2);
+    if (!entries || !index)
+    {
+        free(entries);
+        free(index);
+        return -1;
+    }
+    for (i = 0; i < map->used; i++)
+    {
+        if (pos && *pos == (int)i)
+            *pos = n;
+        if (map->entries[i].key)
+            entries[n++] = map->entries[i];
+    }
+    if (pos && *pos >= (int)map->used)
+        *pos = n;
+    free(map->entries);
+    free(map->index);
+    map->entries = entries;
+    map->index = index;
+    map->mask = capacity * 2 - 1;
+    map->capacity = capacity;
+    map->used = n;
+    ymap_reindex(map);
+    return 0;
+}
+
+// make room for new entry.
+// The entries and the deleted slots are kept less than the half of the index table
+// so that the index table always has empty slots to end the probing.
+// pos is updated to the new position of the entry if the entries are compacted.
+static int ymap_reserve(ymap *map, int *pos)
+{
+    unsigned int capacity = map->capacity;
+    if (map->used + map->dummy < map->capacity)
+        return 0;
+    if (capacity < YMAP_MIN_CAPACITY)
+        capacity = YMAP_MIN_CAPACITY;
+    // grow if the deleted entries are not enough to compact.
+    while (map->size * 2 >= capacity)
+        capacity *= 2;
+    return ymap_rebuild(map, capacity, pos);
+}
+
+// compact the entries in place without the allocation.
+static void ymap_squeeze(ymap *map)
+{
+    unsigned int i, n = 0;
+    for (i = 0; i < map->used; i++)
+    {
+        if (map->entries[i].key)
+            map->entries[n++] = map->entries[i];
+    }
+    map->used = n;
+    ymap_reindex(map);
+}
+
+// compact the entries if the deleted entries are more than the valid entries.
+static void ymap_compact(ymap *map, int *pos)
+{
+    unsigned int capacity = map->capacity;
+    unsigned int deleted = map->used - map->size;
+    if (deleted < YMAP_MIN_CAPACITY || deleted <= map->size)
+        return;
+    while (capacity > YMAP_MIN_CAPACITY && map->size * 4 < capacity)
+        capacity /= 2;
+    ymap_rebuild(map, capacity, pos);
+}
+
+// insert new entry at the position.
+static int ymap_insert_at(ymap *map, int pos, void *key, void *data, unsigned int hash)
+{
+    ymap_iter *e;
+    // the position is moved if the entries are compacted.
+    if (ymap_reserve(map, &pos))
+        return -1;
+    if (pos > (int)map->used)
+        pos = map->used;
+    e = &map->entries[pos];
+    if (pos < map->used)
+        memmove(e + 1, e, sizeof(ymap_iter) * (map->used - pos));
+    e->key = key;
+    e->data = data;
+    e->hash = hash;
+    map->used++;
+    map->size++;
+    if ((unsigned int)pos + 1 < map->used)
+        ymap_reindex(map);
+    else
+        ymap_index_set(map, hash, pos);
+    return pos;
+}
+
+// delete the entry and return the data.
+static void *ymap_delete_at(ymap *map, int pos, int kfree)
+{
+    unsigned int slot;
+    ymap_iter *e = &map->entries[pos];
+    void *data = e->data;
+    int found = ymap_lookup(map, e->key, e->hash, &slot);
+    assert(found == pos);
+    map->index[slot] = YMAP_DUMMY;
+    map->dummy++;
+    if (kfree && map->kfree)
+        map->kfree(e->key);
+    e->key = NULL;
+    e->data = NULL;
+    map->size--;
+    if ((unsigned int)pos + 1 == map->used)
+        map->used--;
+    return data;
+}
+
+static int ymap_first_pos(ymap *map, int pos)
+{
+    for (; pos < (int)map->used; pos++)
+    {
+        if (map->entries[pos].key)
+            return pos;
+    }
+    return -1;
+}
+
+static int ymap_last_pos(ymap *map, int pos)
+{
+    for (; pos >= 0; pos--)
+    {
+        if (map->entries[pos].key)
+            return pos;
+    }
+    return -1;
+}
+
+static inline ymap_iter *ymap_entry(ymap *map, int pos)
+{
+    if (pos < 0)
+        return NULL;
+    return &map->entries[pos];
+}
+
+// create a ymap with the hash function of the keys.
+ymap *ymap_create_hash(ymap_hash hash, ytree_cmp comp, user_free kfree)
 {
     ymap *map;
     map = malloc(sizeof(ymap));
     if (map)
     {
-        map->list = ylist_create();
-        if (!map->list)
-        {
-            free(map);
-            return NULL;
-        }
-        map->tree = ytree_create(comp, kfree);
-        if (!map->tree)
-        {
-            ylist_destroy(map->list);
-            free(map);
-            return NULL;
-        }
+        memset(map, 0x0, sizeof(ymap));
+        if (!hash)
+            hash = comp ? ymap_hash_str : ymap_hash_ptr;
+        map->hash = hash;
+        map->comp = comp;
+        map->kfree = kfree;
     }
     return map;
 }
 
+// create a ymap
+// The keys are hashed as strings if comp is set, otherwise as pointers.
+ymap *ymap_create(ytree_cmp comp, user_free kfree)
+{
+    return ymap_create_hash(NULL, comp, kfree);
+}
+
 // destroy the ymap with deleting all entries.
 void ymap_destroy_custom(ymap *map, user_free ufree)
 {
+    unsigned int i;
     if (map)
     {
-        ytree_destroy(map->tree);
-        while (!ylist_empty(map->list))
+        for (i = 0; i < map->used; i++)
         {
-            ymap_iter *imap;
-            imap = ylist_pop_front(map->list);
+            ymap_iter *e = &map->entries[i];
+            if (!e->key)
+                continue;
+            if (map->kfree)
+                map->kfree(e->key);
             if (ufree)
-                ufree(imap->data);
-            free(imap);
+                ufree(e->data);
         }
-        ylist_destroy(map->list);
+        free(map->entries);
+        free(map->index);
         free(map);
     }
 }
@@ -71,7 +323,7 @@ void ymap_destroy(ymap *map)
 unsigned int ymap_size(ymap *map)
 {
     if (map)
-        return ytree_size(map->tree);
+        return map->size;
     return 0;
 }
 
@@ -82,21 +334,14 @@ void *ymap_insert_back(ymap *map, void *key, void *data)
 {
     if (map && key)
     {
-        ymap_iter *imap;
-        imap = malloc(sizeof(ymap_iter));
-        assert(imap);
-        imap->key = key;
-        imap->data = data;
-        imap->ilist = ylist_push_back(map->list, imap);
-        assert(imap->ilist);
-        imap = ytree_insert(map->tree, key, imap);
-        if (imap) // old imap
-        {
-            data = imap->data;
-            ylist_erase(map->list, imap->ilist, NULL);
-            free(imap);
-            return data;
-        }
+        void *old = NULL;
+        unsigned int hash = map->hash(key);
+        int pos = ymap_lookup(map, key, hash, NULL);
+        if (pos >= 0)
+            old = ymap_delete_at(map, pos, 1);
+        pos = ymap_insert_at(map, map->used, key, data, hash);
+        assert(pos >= 0);
+        return old;
     }
     return NULL;
 }
@@ -108,72 +353,58 @@ void *ymap_insert_front(ymap *map, void *key, void *data)
 {
     if (map && key)
     {
-        ymap_iter *imap;
-        imap = malloc(sizeof(ymap_iter));
-        assert(imap);
-        imap->key = key;
-        imap->data = data;
-        imap->ilist = ylist_push_front(map->list, imap);
-        assert(imap->ilist);
-        imap = ytree_insert(map->tree, key, imap);
-        if (imap) // old imap
-        {
-            data = imap->data;
-            ylist_erase(map->list, imap->ilist, NULL);
-            free(imap);
-            return data;
-        }
+        void *old = NULL;
+        unsigned int hash = map->hash(key);
+        int pos = ymap_lookup(map, key, hash, NULL);
+        if (pos >= 0)
+            old = ymap_delete_at(map, pos, 1);
+        pos = ymap_insert_at(map, 0, key, data, hash);
+        assert(pos >= 0);
+        return old;
     }
     return NULL;
 }
 
-
-// pop the key and data from the head of the ymap 
-// return data or NULL if no entry.
+// pop the key and data from the head of the ymap
+// return data or NULL if no entry. The key is not freed.
 void *ymap_pop_front(ymap *map, void **key, void **data)
 {
-    ymap_iter *imap;
+    int pos;
+    void *k, *d;
     if (!map)
         return NULL;
-    imap = ylist_pop_front(map->list);
-    if (imap)
-    {
-        void *d, *k;
-        d = imap->data;
-        k = imap->key;
-        assert(ytree_delete(map->tree, k) == imap);
-        free(imap);
-        if (key)
-            *key = k;
-        if (data)
-            *data = d;
-        return d;
-    }
-    return NULL;
+    pos = ymap_first_pos(map, 0);
+    if (pos < 0)
+        return NULL;
+    k = map->entries[pos].key;
+    d = ymap_delete_at(map, pos, 0);
+    ymap_compact(map, NULL);
+    if (key)
+        *key = k;
+    if (data)
+        *data = d;
+    return d;
 }
 
-// pop the key and data from the tail of the ymap 
-// return data or NULL if no entry.
+// pop the key and data from the tail of the ymap
+// return data or NULL if no entry. The key is not freed.
 void *ymap_pop_tail(ymap *map, void **key, void **data)
 {
-    ymap_iter *imap;
+    int pos;
+    void *k, *d;
     if (!map)
         return NULL;
-    imap = ylist_pop_back(map->list);
-    if (imap)
-    {
-        void *d, *k;
-        d = imap->data;
-        k = imap->key;
-        assert(ytree_delete(map->tree, k) == imap);
-        free(imap);
-        if (key)
-            *key = k;
-        if (data)
-            *data = d;
-        return d;
-    }
-    return NULL;
+    pos = ymap_last_pos(map, (int)map->used - 1);
+    if (pos < 0)
+        return NULL;
+    k = map->entries[pos].key;
+    d = ymap_delete_at(map, pos, 0);
+    ymap_compact(map, NULL);
+    if (key)
+        *key = k;
+    if (data)
+        *data = d;
+    return d;
 }
 
 // delete the key from the ymap return the data.
@@ -181,15 +412,13 @@ void *ymap_delete(ymap *map, void *key)
 {
     if (map && key)
     {
-        ymap_iter *imap;
-        imap = ytree_delete(map->tree, key);
-        if (imap)
-        {
-            void *data = imap->data;
-            ylist_erase(map->list, imap->ilist, NULL);
-            free(imap);
-            return data;
-        }
+        void *data;
+        int pos = ymap_lookup(map, key, map->hash(key), NULL);
+        if (pos < 0)
+            return NULL;
+        data = ymap_delete_at(map, pos, 1);
+        ymap_compact(map, NULL);
+        return data;
     }
     return NULL;
 }
@@ -199,80 +428,74 @@ void *ymap_search(ymap *map, void *key)
 {
     if (map && key)
     {
-        ymap_iter *imap;
-        imap = ytree_search(map->tree, key);
-        if (imap)
-            return imap->data;
+        int pos = ymap_lookup(map, key, map->hash(key), NULL);
+        if (pos >= 0)
+            return map->entries[pos].data;
     }
     return NULL;
 }
 
 // return the near data to the key. (This searches lower nodes if lower is set.)
+// The lower (or higher) nearest key is returned if the key is not found.
+// If there is no lower (or higher) key, the nearest key of the other side is returned.
 void *ymap_search_nearby(ymap *map, void *key, void **nearkey, int lower)
 {
     if (map && key)
     {
-        ytree_iter *itree;
-        itree = ytree_find_nearby(map->tree, key, lower);
-        if (itree)
+        unsigned int i;
+        ymap_iter *below = NULL, *above = NULL, *found;
+        int pos = ymap_lookup(map, key, map->hash(key), NULL);
+        if (pos >= 0)
+        {
+            found = &map->entries[pos];
+        }
+        else
+        {
+            for (i = 0; i < map->used; i++)
+            {
+                ymap_iter *e = &map->entries[i];
+                if (!e->key)
+                    continue;
+                if (ymap_order(map, e->key, key) < 0)
+                {
+                    if (!below || ymap_order(map, e->key, below->key) > 0)
+                        below = e;
+                }
+                else if (!above || ymap_order(map, e->key, above->key) < 0)
+                {
+                    above = e;
+                }
+            }
+            if (lower)
+                found = below ? below : above;
+            else
+                found = above ? above : below;
+        }
+        if (found)
         {
-            ymap_iter *imap;
-            imap = ytree_data(itree);
             if (nearkey)
-                *nearkey = imap->key;
-            return imap->data;
+                *nearkey = found->key;
+            return found->data;
         }
     }
     return NULL;
 }
 
-
 // return 1 if found, otherwise return 0
 int ymap_exist(ymap *map, void *key)
 {
-    if (map)
+    if (map && key)
     {
-        ymap_iter *imap;
-        imap = ytree_search(map->tree, key);
-        if (imap)
+        if (ymap_lookup(map, key, map->hash(key), NULL) >= 0)
             return 1;
     }
     return 0;
 }
 
-struct _ymap_tr_data
-{
-    ytree_callback cb;
-    void *addition;
-};
-
-static int ymap_traverse_sub(void *key, void *data, void *addition)
-{
-    ymap_iter *imap = data;
-    struct _ymap_tr_data *pdata = addition;
-    assert(pdata || imap);
-    return pdata->cb(key, imap->data, pdata->addition);
-}
-
-static int ymap_traverse_order_sub(void *data, void *addition)
-{
-    ymap_iter *imap = data;
-    struct _ymap_tr_data *pdata = addition;
-    assert(pdata || imap);
-    return pdata->cb(imap->key, imap->data, pdata->addition);
-}
-
 // iterates all entries in the ymap regardless of ordering.
 int ymap_traverse(ymap *map, ytree_callback cb, void *addition)
 {
-    if (map)
-    {
-        struct _ymap_tr_data data;
-        data.cb = cb;
-        data.addition = addition;
-        return ytree_traverse(map->tree, ymap_traverse_sub, &data);
-    }
-    return 1;
+    return ymap_traverse_order(map, cb, addition);
 }
 
 // iterates all entries in the ymap in ordering.
@@ -280,10 +503,18 @@ int ymap_traverse_order(ymap *map, ytree_callback cb, void *addition)
 {
     if (map)
     {
-        struct _ymap_tr_data data;
-        data.cb = cb;
-        data.addition = addition;
-        return ylist_traverse(map->list, ymap_traverse_order_sub, &data);
+        unsigned int i;
+        for (i = 0; i < map->used; i++)
+        {
+            ymap_iter *e = &map->entries[i];
+            if (e->key)
+            {
+                int res = cb(e->key, e->data, addition);
+                if (res)
+                    return res;
+            }
+        }
+        return 0;
     }
     return 1;
 }
@@ -292,9 +523,7 @@ int ymap_traverse_order(ymap *map, ytree_callback cb, void *addition)
 ymap_iter *ymap_find(ymap *map, void *key)
 {
     if (map && key)
-    {
-        return ytree_search(map->tree, key);
-    }
+        return ymap_entry(map, ymap_lookup(map, key, map->hash(key), NULL));
     return NULL;
 }
 
@@ -302,11 +531,7 @@ ymap_iter *ymap_find(ymap *map, void *key)
 ymap_iter *ymap_first(ymap *map)
 {
     if (map)
-    {
-        ylist_iter *ilist;
-        ilist = ylist_first(map->list);
-        return ylist_data(ilist);
-    }
+        return ymap_entry(map, ymap_first_pos(map, 0));
     return NULL;
 }
 
@@ -314,11 +539,7 @@ ymap_iter *ymap_first(ymap *map)
 ymap_iter *ymap_last(ymap *map)
 {
     if (map)
-    {
-        ylist_iter *ilist;
-        ilist = ylist_last(map->list);
-        return ylist_data(ilist);
-    }
+        return ymap_entry(map, ymap_last_pos(map, (int)map->used - 1));
     return NULL;
 }
 
@@ -326,11 +547,7 @@ ymap_iter *ymap_last(ymap *map)
 ymap_iter *ymap_prev(ymap *map, ymap_iter *imap)
 {
     if (map && imap)
-    {
-        ylist_iter *ilist;
-        ilist = ylist_prev(map->list, imap->ilist);
-        return ylist_data(ilist);
-    }
+        return ymap_entry(map, ymap_last_pos(map, (int)(imap - map->entries) - 1));
     return NULL;
 }
 
@@ -339,17 +556,9 @@ ymap_iter *ymap_next(ymap *map, ymap_iter *imap)
 {
     if (map)
     {
-        ylist_iter *ilist;
         if (imap)
-        {
-            ilist = ylist_next(map->list, imap->ilist);
-            return ylist_data(ilist);
-        }
-        else
-        {
-            ilist = ylist_first(map->list);
-            return ylist_data(ilist);
-        }
+            return ymap_entry(map, ymap_first_pos(map, (int)(imap - map->entries) + 1));
+        return ymap_first(map);
     }
     return NULL;
 }
@@ -358,9 +567,7 @@ ymap_iter *ymap_next(ymap *map, ymap_iter *imap)
 int ymap_done(ymap *map, ymap_iter *imap)
 {
     if (map && imap)
-    {
-        return ylist_done(map->list, imap->ilist);
-    }
+        return 0;
     return 1;
 }
 
@@ -372,23 +579,18 @@ ymap_iter *ymap_remove(ymap *map, ymap_iter *imap, user_free ufree)
     if (map && imap)
     {
         void *data;
-        ylist_iter *prev;
-        ymap_iter *imap_copy;
-        imap_copy = ytree_delete(map->tree, imap->key);
-        assert(imap_copy == imap);
-        imap = imap_copy;
-        prev = ylist_erase(map->list, imap->ilist, NULL);
-        data = imap->data;
-        free(imap);
+        int pos = (int)(imap - map->entries);
+        int prev = ymap_last_pos(map, pos - 1);
+        data = ymap_delete_at(map, pos, 1);
         if (ufree)
             ufree(data);
-        imap = ylist_data(prev);
-        return imap;
+        ymap_compact(map, &prev);
+        return ymap_entry(map, prev);
     }
     return NULL;
 }
 
-// insert the data next to the ymap_iter and then 
+// insert the data next to the ymap_iter and then
 // return new ymap_iter for the inserted data if ok or null if failed.
 // if ymap_iter is null, the data will be pushed back to the list.
 // if there is the same key exists in the ymap, it will be failed.
@@ -396,19 +598,13 @@ ymap_iter *ymap_insert(ymap *map, ymap_iter *imap, void *key, void *data)
 {
     if (map && key)
     {
-        ymap_iter *new_imap;
-        new_imap = ytree_search(map->tree, key);
-        if (new_imap)
+        int pos;
+        unsigned int hash = map->hash(key);
+        if (ymap_lookup(map, key, hash, NULL) >= 0)
             return NULL;
-        new_imap = malloc(sizeof(ymap_iter));
-        assert(new_imap);
-        new_imap->key = key;
-        new_imap->data = data;
-        new_imap->ilist = ylist_insert(map->list, imap->ilist, new_imap);
-        assert(new_imap->ilist);
-        imap = ytree_insert(map->tree, key, new_imap);
-        assert(!imap);
-        return new_imap;
+        pos = imap ? (int)(imap - map->entries) + 1 : (int)map->used;
+        pos = ymap_insert_at(map, pos, key, data, hash);
+        return ymap_entry(map, pos);
     }
     return NULL;
 }
@@ -430,11 +626,12 @@ void *ymap_data(ymap_iter *imap)
 }
 
 // return xth ymap_iter (index) from the ymap.
+// The deleted entries are compacted in place (O(n)) before the positional access.
 ymap_iter *ymap_index(ymap *map, int index)
 {
-    ylist_iter *ilist;
-    if (!map)
+    if (!map || index < 0 || index >= (int)map->size)
         return NULL;
-    ilist = ylist_index(map->list, index);
-    return ylist_data(ilist);
+    if (map->used != map->size)
+        ymap_squeeze(map);
+    return &map->entries[index];
 }
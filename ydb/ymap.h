@@ -1,10 +1,16 @@
 #ifndef __YMAP__
 #define __YMAP__
 
-// YMAP is the ordered map (hash) constructed by YLIST and YTREE in order to support YAML ordered map.
+// YMAP is the insertion-ordered hash map in order to support YAML ordered map.
 // - the data inserted is ordered by the insert sequence.
 // - each data is unique by the key in the structure.
-// - Supports O(logn) search, insertion and deletion time like as YTREE.
+// - the entries are kept in a dense array indexed by a compact hash table.
+// - Supports O(1) search, append and deletion.
+// - ymap_index is O(1) if no entry is deleted after the last compaction,
+//   otherwise it compacts the deleted entries in place first (O(n)).
+// - ymap_insert_front and ymap_insert are O(n) and ymap_search_nearby scans all entries.
+// - ymap_iter is valid until the ymap is changed (including the compaction
+//   by ymap_index) except ymap_remove that returns the valid previous ymap_iter.
 
 #include "ytree.h"
 #include "ylist.h"
@@ -18,8 +24,14 @@ typedef struct _ymap ymap;
 // ymap_iter is the iterator to loop each map entry and access them.
 typedef struct _ymap_iter ymap_iter;
 
+// hash function of the ymap key
+typedef unsigned int (*ymap_hash)(void *key);
+
 // create a ymap
+// The keys are hashed as strings if comp is set, otherwise as pointers.
 ymap *ymap_create(ytree_cmp comp, user_free kfree);
+// create a ymap with the hash function of the keys.
+ymap *ymap_create_hash(ymap_hash hash, ytree_cmp comp, user_free kfree);
 // destroy the ymap with deleting all entries.
 void ymap_destroy_custom(ymap *map, user_free ufree);
 void ymap_destroy(ymap *map);
@@ -37,11 +49,11 @@ void *ymap_insert_back(ymap *map, void *key, void *data);
 void *ymap_insert_front(ymap *map, void *key, void *data);
 
 // pop the key and data from the head of the ymap 
-// return data or NULL if no entry.
+// return data or NULL if no entry. The key is not freed.
 void *ymap_pop_front(ymap *map, void **key, void **data);
 
 // pop the key and data from the tail of the ymap 
-// return data or NULL if no entry.
+// return data or NULL if no entry. The key is not freed.
 void *ymap_pop_tail(ymap *map, void **key, void **data);
 
 // delete the key from the ymap return the data.
@@ -89,6 +101,7 @@ void *ymap_key(ymap_iter *imap);
 // return the data of the ymap_iter
 void *ymap_data(ymap_iter *imap);
 // return xth ymap_iter (index) from the ymap.
+// The deleted entries are compacted first, so the other ymap_iters are invalid after it.
 ymap_iter *ymap_index(ymap *map, int index);
 
 #ifdef __cplusplus
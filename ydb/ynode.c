@@ -7,9 +7,12 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
 #include <yaml.h>
 
 #include "utf8.h"
+#include "base64.h"
 #include "ylog.h"
 #include "ystr.h"
 #include "ylist.h"
@@ -39,16 +42,142 @@ struct _yhook
         yhook_suppressed_func3 agg_func3;
         yhook_suppressed_func4 agg_func4;
         yhook_suppressed_func5 agg_func5;
+        yhook_batch_func batch_func;
     };
     unsigned int flags;
+    unsigned long epoch;      // the epoch of the pool (yhook_pool) where the hook is pending
+    int slot;                 // the index of the hook in the pending hooks of the pool
+    unsigned long matched;    // the last change matched to the pattern hook
+    struct _ypattern *pattern; // the pattern hooks registered to the node
     int user_num;
     void *user[];
 };
 typedef struct _yhook yhook;
 
+// The pattern hooks of a node are kept in a trie keyed by the path segments
+// relative to the node. A node having only the pattern hooks has the hook
+// without func.
+typedef struct _ypattern
+{
+    char *seg;                // the path segment ("*": any segment, "**": zero or more segments)
+    struct _ypattern *child;  // the first child
+    struct _ypattern *next;   // the next sibling
+    yhook *hook;              // the hook of the pattern ending at the segment
+    unsigned long change;     // the last change matched to the pattern hooks (the root only)
+} ypattern;
+
+#define YHOOK_POOL_SIZE 16
+
+// The pending hooks, the changes for the batch hooks and the nodes to be freed
+// collected during a merge (ynode_control). A hook is pending in the pool
+// if its epoch is the epoch of the pool.
+typedef struct _yhook_pool
+{
+    unsigned long epoch;
+    int num;
+    int max;
+    yhook **hooks;
+    yhook *hooks_prealloc[YHOOK_POOL_SIZE];
+    int batchmax;
+    struct yhook_batch
+    {
+        int num;
+        int max;
+        yhook_change *changes;
+    } * batches; // the changes of the batch hooks indexed by the slot of the hook
+    int freenum;
+    int freemax;
+    ynode **frees; // the replaced or deleted nodes freed after the hooks
+} yhook_pool;
+
 // ynode flags
 #define YNODE_FLAG_HASH 0x1
 #define YNODE_FLAG_LIST 0x2
+#define YNODE_FLAG_BLOB 0x4 // the value is the binary data (yblob).
+
+// The binary data of a value node (!!binary).
+// It is encoded to base64 only when the node is printed to YAML
+// or read as the string (ynode_value).
+typedef struct _yblob
+{
+    size_t len;
+    char *base64;        // the base64 string read until the next change of the tree
+    ynode *top;          // the top of the tree where the base64 string is read
+    ylist_iter *cached;  // the entry of yblob_cached
+    unsigned char data[];
+} yblob;
+
+// The binary leaves having the base64 string read by ynode_value.
+// The strings are freed by the next change of the tree (ynode_control)
+// not to keep the encoded copy (4/3 of the data) with the raw data.
+static pthread_mutex_t yblob_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static ylist *yblob_cached;
+static int yblob_cached_num;
+
+// free the base64 string of the binary leaf.
+static void yblob_cache_free(yblob *blob)
+{
+    if (!__atomic_load_n(&blob->base64, __ATOMIC_ACQUIRE))
+        return;
+    pthread_mutex_lock(&yblob_cache_lock);
+    if (blob->cached)
+    {
+        ylist_erase(yblob_cached, blob->cached, NULL);
+        __atomic_sub_fetch(&yblob_cached_num, 1, __ATOMIC_RELEASE);
+    }
+    free(blob->base64);
+    blob->base64 = NULL;
+    blob->cached = NULL;
+    blob->top = NULL;
+    pthread_mutex_unlock(&yblob_cache_lock);
+}
+
+// free the base64 strings read from the tree of the top.
+static void yblob_cache_release(ynode *top)
+{
+    ylist_iter *iter;
+    if (__atomic_load_n(&yblob_cached_num, __ATOMIC_ACQUIRE) <= 0)
+        return;
+    pthread_mutex_lock(&yblob_cache_lock);
+    iter = ylist_first(yblob_cached);
+    while (!ylist_done(yblob_cached, iter))
+    {
+        yblob *blob = ylist_data(iter);
+        if (blob->top != top)
+        {
+            iter = ylist_next(yblob_cached, iter);
+            continue;
+        }
+        iter = ylist_erase(yblob_cached, iter, NULL);
+        __atomic_sub_fetch(&yblob_cached_num, 1, __ATOMIC_RELEASE);
+        free(blob->base64);
+        blob->base64 = NULL;
+        blob->cached = NULL;
+        blob->top = NULL;
+    }
+    pthread_mutex_unlock(&yblob_cache_lock);
+}
+
+#define YNODE_BINARY_TAG "!!binary"
+
+#define YNODE_FLAG_INT 0x8    // the value is the integer (ynum).
+#define YNODE_FLAG_FLOAT 0x10 // the value is the float (ynum).
+#define YNODE_FLAG_NUM (YNODE_FLAG_INT | YNODE_FLAG_FLOAT)
+#define YNODE_FLAG_DIRTY 0x20 // the counter changed but not logged yet.
+
+// The number of a value node (!!int, !!float).
+// The string is formatted when the number is changed, not when it is read.
+typedef struct _ynum
+{
+    union {
+        long long i;
+        double f;
+    };
+    char str[32];
+} ynum;
+
+#define YNODE_INT_TAG "!!int"
+#define YNODE_FLOAT_TAG "!!float"
 
 struct _ynode
 {
@@ -56,7 +185,7 @@ struct _ynode
         // const char *key;
         // ylist_iter *iter;
         ylist_iter *ilist;
-        ymap_iter *imap;
+        const char *okey; // the key in the parent omap
         ytree_iter *itree;
         void *nkey;
     };
@@ -65,6 +194,8 @@ struct _ynode
         ytree *map;
         ymap *omap;
         const char *value;
+        yblob *blob;
+        ynum *num;
         void *nval;
     };
     node_type type;
@@ -74,6 +205,8 @@ struct _ynode
     struct _ynode *meta; // for meta data
     struct _yhook *hook;
     const char *tag;
+    unsigned long gen; // the latest change generation of the node and its descendants
+    uint64_t digest;   // the digest of the node and its descendants (0: not computed)
 };
 
 static char *ynode_type_str[] = {
@@ -102,6 +235,30 @@ static char *ynode_type_debug_str[] = {
 
 static void yhook_delete(ynode *cur);
 
+// return the generation for the next change of the tree having the node.
+// The top ynode has the latest generation of the tree (datablock)
+// because the generation of each change is stamped up to the top.
+static unsigned long ynode_gen_next(ynode *node)
+{
+    node = ynode_top(node);
+    return node ? node->gen + 1 : 1;
+}
+
+// stamp the generation on the node and propagate it to the ancestors.
+static void ynode_gen_stamp(ynode *node, unsigned long gen)
+{
+    for (; node && node->gen < gen; node = node->parent)
+        node->gen = gen;
+}
+
+// invalidate the digests of the node and its ancestors.
+// The ancestors of a node not having the digest don't have it either.
+static void ynode_digest_invalidate(ynode *node)
+{
+    for (; node && node->digest; node = node->parent)
+        node->digest = 0;
+}
+
 // delete ynode regardless of the detachment of the parent
 static void ynode_free(ynode *node)
 {
@@ -110,7 +267,14 @@ static void ynode_free(ynode *node)
     switch (node->type)
     {
     case YNODE_TYPE_VAL:
-        if (node->value)
+        if (IS_SET(node->flags, YNODE_FLAG_BLOB))
+        {
+            yblob_cache_free(node->blob);
+            free(node->blob);
+        }
+        else if (IS_SET(node->flags, YNODE_FLAG_NUM))
+            free(node->num);
+        else if (node->value)
             yfree(node->value);
         break;
     case YNODE_TYPE_MAP:
@@ -135,12 +299,50 @@ static void ynode_free(ynode *node)
     free(node);
 }
 
-static int imap_cmp(char *a, char *b)
+// The key of the imap entry.
+// The integer is parsed once when the key is inserted (or searched)
+// so that the comparison of the keys doesn't parse them again.
+typedef struct _imap_key
 {
-    int res = atoi(a) - atoi(b);
-    if (res < 0 || res > 0)
-        return res;
-    return strcmp(a, b);
+    int num;
+    const char *str;
+} imap_key;
+
+static int imap_cmp(imap_key *a, imap_key *b)
+{
+    if (a->num != b->num)
+        return (a->num < b->num) ? -1 : 1;
+    if (a->str == b->str)
+        return 0;
+    return strcmp(a->str, b->str);
+}
+
+static imap_key *imap_key_new(const char *key)
+{
+    imap_key *ikey = malloc(sizeof(imap_key));
+    if (ikey)
+    {
+        ikey->num = atoi(key);
+        ikey->str = ystrdup((char *)key);
+    }
+    return ikey;
+}
+
+static void imap_key_free(imap_key *ikey)
+{
+    if (ikey)
+    {
+        yfree(ikey->str);
+        free(ikey);
+    }
+}
+
+// set the imap key (not allocated) for searching.
+static inline imap_key *imap_key_set(imap_key *ikey, const char *key)
+{
+    ikey->num = atoi(key);
+    ikey->str = key;
+    return ikey;
 }
 
 static void ynode_tag_ctrl(node_type *_type, const char **_tag)
@@ -187,9 +389,70 @@ static void ynode_tag_ctrl(node_type *_type, const char **_tag)
     *_tag = tag;
 }
 
+// decode the base64 value of a !!binary node.
+// return NULL if the value is not base64.
+static yblob *yblob_decode(const char *value)
+{
+    yblob *blob;
+    size_t len = value ? strlen(value) : 0;
+    blob = malloc(sizeof(yblob) + base64_decode_len(len));
+    if (!blob)
+        return NULL;
+    blob->len = 0;
+    blob->base64 = NULL;
+    blob->top = NULL;
+    blob->cached = NULL;
+    if (len > 0 && base64_decode_to((const unsigned char *)value, len, blob->data, &blob->len))
+    {
+        free(blob);
+        return NULL;
+    }
+    return blob;
+}
+
+// format the number to the string.
+static void ynum_format(ynum *num, bool is_float)
+{
+    if (!is_float)
+        snprintf(num->str, sizeof(num->str), "%lld", num->i);
+    else
+    {
+        // the shortest string to be parsed to the same number.
+        snprintf(num->str, sizeof(num->str), "%.15g", num->f);
+        if (strtod(num->str, NULL) != num->f)
+            snprintf(num->str, sizeof(num->str), "%.17g", num->f);
+    }
+}
+
+// parse the value of a !!int or !!float node.
+// return NULL if the value is not the number.
+static ynum *ynum_parse(const char *value, bool is_float)
+{
+    ynum *num;
+    char *end = NULL;
+    if (!value || !value[0] || isspace(value[0]))
+        return NULL;
+    num = malloc(sizeof(ynum));
+    if (!num)
+        return NULL;
+    errno = 0;
+    if (is_float)
+        num->f = strtod(value, &end);
+    else
+        num->i = strtoll(value, &end, 10);
+    if (errno || *end)
+    {
+        free(num);
+        return NULL;
+    }
+    ynum_format(num, is_float);
+    return num;
+}
+
 // create ynode
 static ynode *ynode_new(node_type type, const char *tag, const char *value, int origin)
 {
+    unsigned char flags = 0x0;
     ynode *node = malloc(sizeof(ynode));
     if (!node)
         return NULL;
@@ -198,6 +461,31 @@ static ynode *ynode_new(node_type type, const char *tag, const char *value, int
     switch (type)
     {
     case YNODE_TYPE_VAL:
+        // keep the !!binary value decoded.
+        if (tag && strcmp(tag, YNODE_BINARY_TAG) == 0)
+        {
+            node->blob = yblob_decode(value);
+            if (node->blob)
+            {
+                SET_FLAG(flags, YNODE_FLAG_BLOB);
+                break;
+            }
+        }
+        // keep the !!int and !!float value as the number
+        // only if the number is printed to the same text (e.g. not 007, 1.50, 1e3).
+        if (tag && (strcmp(tag, YNODE_INT_TAG) == 0 || strcmp(tag, YNODE_FLOAT_TAG) == 0))
+        {
+            bool is_float = (strcmp(tag, YNODE_FLOAT_TAG) == 0);
+            node->num = ynum_parse(value, is_float);
+            if (node->num && strcmp(node->num->str, value) == 0)
+            {
+                SET_FLAG(flags, is_float ? YNODE_FLAG_FLOAT : YNODE_FLAG_INT);
+                break;
+            }
+            if (node->num)
+                free(node->num);
+            node->num = NULL;
+        }
         node->value = ystrdup((char *)value);
         break;
     case YNODE_TYPE_MAP:
@@ -205,7 +493,7 @@ static ynode *ynode_new(node_type type, const char *tag, const char *value, int
         node->map = ytree_create((ytree_cmp)strcmp, (user_free)yfree);
         break;
     case YNODE_TYPE_IMAP:
-        node->map = ytree_create((ytree_cmp)imap_cmp, (user_free)yfree);
+        node->map = ytree_create((ytree_cmp)imap_cmp, (user_free)imap_key_free);
         break;
     case YNODE_TYPE_OMAP:
         node->omap = ymap_create((ytree_cmp)strcmp, (user_free)yfree);
@@ -220,7 +508,7 @@ static ynode *ynode_new(node_type type, const char *tag, const char *value, int
         goto _error;
     node->type = type;
     node->origin = origin;
-    node->flags = 0x0;
+    node->flags = flags;
     if (tag)
         node->tag = ystrdup((char *)tag);
     return node;
@@ -229,6 +517,78 @@ _error:
     return NULL;
 }
 
+// create a value ynode having the binary data.
+static ynode *ynode_new_blob(const void *data, size_t len, int origin)
+{
+    ynode *node = malloc(sizeof(ynode));
+    if (!node)
+        return NULL;
+    memset(node, 0x0, sizeof(ynode));
+    node->blob = malloc(sizeof(yblob) + len);
+    if (!node->blob)
+    {
+        free(node);
+        return NULL;
+    }
+    node->blob->len = len;
+    node->blob->base64 = NULL;
+    node->blob->top = NULL;
+    node->blob->cached = NULL;
+    if (len > 0)
+        memcpy(node->blob->data, data, len);
+    node->type = YNODE_TYPE_VAL;
+    node->origin = origin;
+    node->flags = YNODE_FLAG_BLOB;
+    node->tag = ystrdup(YNODE_BINARY_TAG);
+    return node;
+}
+
+// create a value ynode having the number.
+static ynode *ynode_new_num(const ynum *num, bool is_float, const char *tag, int origin)
+{
+    ynode *node = malloc(sizeof(ynode));
+    if (!node)
+        return NULL;
+    memset(node, 0x0, sizeof(ynode));
+    node->num = malloc(sizeof(ynum));
+    if (!node->num)
+    {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->num, num, sizeof(ynum));
+    node->type = YNODE_TYPE_VAL;
+    node->origin = origin;
+    node->flags = is_float ? YNODE_FLAG_FLOAT : YNODE_FLAG_INT;
+    node->tag = ystrdup((char *)tag);
+    return node;
+}
+
+// create a ynode having the same type, tag and value of src.
+static ynode *ynode_new_from(ynode *src)
+{
+    if (IS_SET(src->flags, YNODE_FLAG_BLOB))
+        return ynode_new_blob(src->blob->data, src->blob->len, src->origin);
+    if (IS_SET(src->flags, YNODE_FLAG_NUM))
+        return ynode_new_num(src->num, IS_SET(src->flags, YNODE_FLAG_FLOAT),
+                             src->tag, src->origin);
+    return ynode_new(src->type, src->tag, src->value, src->origin);
+}
+
+// return the value string to be printed to YAML.
+// The binary data is encoded to base64 here.
+static char *ynode_value_to_yaml(ynode *node, int indent, int *is_new)
+{
+    if (IS_SET(node->flags, YNODE_FLAG_BLOB))
+    {
+        *is_new = 1;
+        return (char *)base64_encode(node->blob->data, node->blob->len, NULL);
+    }
+    if (IS_SET(node->flags, YNODE_FLAG_NUM))
+        return to_yaml(node->num->str, indent, is_new, 0);
+    return to_yaml(node->value, indent, is_new, 0);
+}
+
 // return parent after remove the node from the parent node.
 static ynode *ynode_detach(ynode *node)
 {
@@ -251,7 +611,7 @@ static ynode *ynode_detach(ynode *node)
         assert(searched_node == node && YDB_E_INVALID_PARENT);
         break;
     case YNODE_TYPE_OMAP:
-        searched_node = ymap_delete(parent->omap, ymap_key(node->imap));
+        searched_node = ymap_delete(parent->omap, (void *)node->okey);
         UNSET_FLAG(node->flags, YNODE_FLAG_HASH);
         UNSET_FLAG(node->flags, YNODE_FLAG_LIST);
         assert(searched_node && YDB_E_NO_ENTRY);
@@ -267,6 +627,7 @@ static ynode *ynode_detach(ynode *node)
     }
     node->parent = NULL;
     node->nkey = NULL;
+    ynode_digest_invalidate(parent);
     return parent;
 }
 
@@ -285,19 +646,24 @@ static ynode *ynode_attach(ynode *node, ynode *parent, const char *key)
     {
     case YNODE_TYPE_MAP:
     case YNODE_TYPE_SET:
-    case YNODE_TYPE_IMAP:
         ykey = (char *)ystrdup((char *)key);
         SET_FLAG(node->flags, YNODE_FLAG_HASH);
         node->itree = ytree_push(parent->map, ykey, node, (void **)&old);
         assert(node->itree);
         break;
+    case YNODE_TYPE_IMAP:
+        ykey = (char *)imap_key_new(key);
+        SET_FLAG(node->flags, YNODE_FLAG_HASH);
+        node->itree = ytree_push(parent->map, ykey, node, (void **)&old);
+        assert(node->itree);
+        break;
     case YNODE_TYPE_OMAP:
         ykey = (char *)ystrdup((char *)key);
         SET_FLAG(node->flags, YNODE_FLAG_HASH);
         SET_FLAG(node->flags, YNODE_FLAG_LIST);
         old = ymap_insert_back(parent->omap, ykey, node);
-        node->imap = ymap_find(parent->omap, ykey);
-        assert(node->imap);
+        node->okey = ykey;
+        assert(node->okey);
         break;
     case YNODE_TYPE_LIST:
         // ignore key.
@@ -310,6 +676,7 @@ static ynode *ynode_attach(ynode *node, ynode *parent, const char *key)
         assert(!YDB_E_TYPE_ERR);
     }
     node->parent = parent;
+    ynode_digest_invalidate(parent);
     return old;
 }
 
@@ -330,10 +697,37 @@ void ynode_move_child(ynode *dest, ynode *src)
     }
 }
 
-// register the hook func to the target ynode.
-ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int user_num, void *user[])
+static void yhook_set(yhook *hook, ynode *node, unsigned int flags, yhook_func func, int user_num, void *user[])
+{
+    hook->flags = 0x0;
+    if (IS_SET(flags, YNODE_VAL_ONLY))
+        SET_FLAG(hook->flags, YNODE_VAL_ONLY);
+    else
+        UNSET_FLAG(hook->flags, YNODE_VAL_ONLY);
+
+    if (IS_SET(flags, YNODE_SUPPRESS_HOOK))
+        SET_FLAG(hook->flags, YNODE_SUPPRESS_HOOK);
+    else
+        UNSET_FLAG(hook->flags, YNODE_SUPPRESS_HOOK);
+
+    if (IS_SET(flags, YNODE_BATCH_HOOK))
+    {
+        SET_FLAG(hook->flags, YNODE_BATCH_HOOK);
+        UNSET_FLAG(hook->flags, YNODE_SUPPRESS_HOOK);
+    }
+    else
+        UNSET_FLAG(hook->flags, YNODE_BATCH_HOOK);
+
+    hook->node = node;
+    hook->epoch = 0;
+    hook->func = func;
+    hook->user_num = user_num;
+    if (user_num > 0)
+        memcpy(hook->user, user, sizeof(void *) * user_num);
+}
+
+static ydb_res yhook_check(ynode *node, unsigned int flags, yhook_func func, int user_num, void *user[])
 {
-    yhook *hook;
     if (!node || !func)
         return YDB_E_INVALID_ARGS;
     if (IS_SET(flags, YNODE_LEAF_ONLY))
@@ -342,6 +736,17 @@ ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int use
         return YDB_E_INVALID_ARGS;
     if (!user && user_num > 0)
         return YDB_E_INVALID_ARGS;
+    return YDB_OK;
+}
+
+// register the hook func to the target ynode.
+ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int user_num, void *user[])
+{
+    yhook *hook;
+    ypattern *pattern = NULL;
+    ydb_res res = yhook_check(node, flags, func, user_num, user);
+    if (res)
+        return res;
 
     hook = NULL;
     if (node->hook)
@@ -349,7 +754,12 @@ ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int use
         if (node->hook->user_num == user_num)
             hook = node->hook;
         else
-            yhook_unregister(node);
+        {
+            // keep the pattern hooks of the node.
+            pattern = node->hook->pattern;
+            node->hook->pattern = NULL;
+            yhook_delete(node);
+        }
     }
 
     if (!hook)
@@ -360,23 +770,9 @@ ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int use
     }
     if (!hook)
         return YDB_E_NO_ENTRY;
-
-    hook->flags = 0x0;
-    if (IS_SET(flags, YNODE_VAL_ONLY))
-        SET_FLAG(hook->flags, YNODE_VAL_ONLY);
-    else
-        UNSET_FLAG(hook->flags, YNODE_VAL_ONLY);
-
-    if (IS_SET(flags, YNODE_SUPPRESS_HOOK))
-        SET_FLAG(hook->flags, YNODE_SUPPRESS_HOOK);
-    else
-        UNSET_FLAG(hook->flags, YNODE_SUPPRESS_HOOK);
-
-    hook->node = node;
-    hook->func = func;
-    hook->user_num = user_num;
-    if (user_num > 0)
-        memcpy(hook->user, user, sizeof(void *) * user_num);
+    if (pattern)
+        hook->pattern = pattern;
+    yhook_set(hook, node, flags, func, user_num, user);
     node->hook = hook;
     if (YLOG_SEVERITY_INFO)
     {
@@ -405,22 +801,151 @@ void yhook_unregister(ynode *node)
             free(path);
         }
     }
+    if (node->hook && node->hook->pattern)
+    {
+        // keep the hook for the pattern hooks.
+        node->hook->func = NULL;
+        node->hook->flags = 0x0;
+        node->hook->epoch = 0;
+        return;
+    }
     yhook_delete(node);
 }
 
-static void yhook_func_exec(yhook *hook, char op, ynode *cur, ynode *_new)
+static void ypattern_free(ypattern *p)
 {
-    assert(hook->func);
-    if (YLOG_SEVERITY_INFO)
+    while (p)
     {
-        int pathlen = 0;
-        char *path = ynode_path(hook->node, YDB_LEVEL_MAX, &pathlen);
-        if (path)
+        ypattern *next = p->next;
+        ypattern_free(p->child);
+        if (p->hook)
+            free(p->hook);
+        if (p->seg)
+            free(p->seg);
+        free(p);
+        p = next;
+    }
+}
+
+// move the pattern hooks to the node.
+static void ypattern_rebase(ypattern *p, ynode *node)
+{
+    for (; p; p = p->next)
+    {
+        if (p->hook)
+            p->hook->node = node;
+        ypattern_rebase(p->child, node);
+    }
+}
+
+// find the trie node of the pattern. The trie nodes are created if create is set.
+static ypattern *ypattern_find(ypattern *root, char *pattern, bool create)
+{
+    ypattern *p = root;
+    char *s = pattern;
+    while (*s)
+    {
+        ypattern *c;
+        char *e = s;
+        int depth = 0;
+        while (*e && (*e != '/' || depth > 0))
         {
-            ylog_info("write hook (%s) %s\n", path, hook ? "found" : "not found");
-            free(path);
+            if (*e == '[')
+                depth++;
+            else if (*e == ']')
+                depth--;
+            e++;
         }
+        if (e > s)
+        {
+            for (c = p->child; c; c = c->next)
+            {
+                if (strncmp(c->seg, s, e - s) == 0 && c->seg[e - s] == 0)
+                    break;
+            }
+            if (!c)
+            {
+                if (!create)
+                    return NULL;
+                c = malloc(sizeof(ypattern));
+                if (!c)
+                    return NULL;
+                memset(c, 0x0, sizeof(ypattern));
+                c->seg = strndup(s, e - s);
+                if (!c->seg)
+                {
+                    free(c);
+                    return NULL;
+                }
+                c->next = p->child;
+                p->child = c;
+            }
+            p = c;
+        }
+        s = (*e) ? e + 1 : e;
+    }
+    return p;
+}
+
+// register the hook func to the nodes matched to the pattern under the target ynode.
+ydb_res yhook_register_pattern(ynode *node, char *pattern, unsigned int flags, yhook_func func, int user_num, void *user[])
+{
+    yhook *hook;
+    ypattern *p;
+    ydb_res res = yhook_check(node, flags, func, user_num, user);
+    if (res)
+        return res;
+    if (!pattern)
+        return YDB_E_INVALID_ARGS;
+    if (!node->hook)
+    {
+        node->hook = malloc(sizeof(yhook));
+        if (!node->hook)
+            return YDB_E_MEM_ALLOC;
+        memset(node->hook, 0x0, sizeof(yhook));
+        node->hook->node = node;
+    }
+    if (!node->hook->pattern)
+    {
+        node->hook->pattern = malloc(sizeof(ypattern));
+        if (!node->hook->pattern)
+            return YDB_E_MEM_ALLOC;
+        memset(node->hook->pattern, 0x0, sizeof(ypattern));
     }
+    p = ypattern_find(node->hook->pattern, pattern, true);
+    if (!p)
+        return YDB_E_MEM_ALLOC;
+    hook = malloc(sizeof(yhook) + sizeof(void *) * user_num);
+    if (!hook)
+        return YDB_E_MEM_ALLOC;
+    memset(hook, 0x0, sizeof(yhook) + sizeof(void *) * user_num);
+    yhook_set(hook, node, flags, func, user_num, user);
+    if (p->hook)
+        free(p->hook);
+    p->hook = hook;
+    ylog_info("write hook (%p) added to the pattern %s\n", func, pattern);
+    return YDB_OK;
+}
+
+// unregister the hook func of the pattern from the target ynode.
+void yhook_unregister_pattern(ynode *node, char *pattern)
+{
+    ypattern *p;
+    if (!node || !pattern || !node->hook || !node->hook->pattern)
+        return;
+    p = ypattern_find(node->hook->pattern, pattern, false);
+    if (!p || !p->hook)
+        return;
+    ylog_info("write hook (%p) deleted from the pattern %s\n", p->hook->func, pattern);
+    free(p->hook);
+    p->hook = NULL;
+}
+
+static void yhook_func_exec(yhook *hook, char op, ynode *cur, ynode *_new)
+{
+    assert(hook->func);
+    ylog_info("write hook (%p) %s %s\n", hook->func, yhook_op_str(op),
+              ynode_key(hook->node) ? ynode_key(hook->node) : "top");
     if (IS_SET(hook->flags, YNODE_SUPPRESS_HOOK))
     {
         switch (hook->user_num)
@@ -475,34 +1000,266 @@ static void yhook_func_exec(yhook *hook, char op, ynode *cur, ynode *_new)
     }
 }
 
-static void yhook_push_for_pending(yhook *hook, ytree **hook_pool)
+static void *yhook_pool_grow(void *vec, int *max, size_t size)
 {
-    if (!hook_pool)
+    int newmax = (*max > 0) ? (*max * 2) : YHOOK_POOL_SIZE;
+    void *newvec = realloc(vec, newmax * size);
+    if (newvec)
+        *max = newmax;
+    return newvec;
+}
+
+static void yhook_pool_init(yhook_pool *pool, unsigned long epoch)
+{
+    memset(pool, 0x0, sizeof(yhook_pool));
+    pool->epoch = epoch;
+    pool->max = YHOOK_POOL_SIZE;
+    pool->hooks = pool->hooks_prealloc;
+}
+
+// push the hook to the pending hooks of the pool once.
+static void yhook_pool_push(yhook_pool *pool, yhook *hook)
+{
+    if (hook->epoch == pool->epoch && hook->slot < pool->num && pool->hooks[hook->slot] == hook)
+        return;
+    if (pool->num >= pool->max)
+    {
+        yhook **hooks;
+        if (pool->hooks == pool->hooks_prealloc)
+        {
+            hooks = malloc(sizeof(yhook *) * pool->max * 2);
+            if (!hooks)
+                return;
+            memcpy(hooks, pool->hooks_prealloc, sizeof(yhook *) * pool->max);
+            pool->max = pool->max * 2;
+        }
+        else
+        {
+            hooks = yhook_pool_grow(pool->hooks, &pool->max, sizeof(yhook *));
+            if (!hooks)
+                return;
+        }
+        pool->hooks = hooks;
+    }
+    hook->epoch = pool->epoch;
+    hook->slot = pool->num;
+    pool->hooks[pool->num] = hook;
+    pool->num++;
+}
+
+// keep the change for the batch hook in the bucket of its slot until the hook is executed.
+static void yhook_pool_push_change(yhook_pool *pool, yhook *hook, char op, ynode *cur, ynode *new)
+{
+    struct yhook_batch *batch;
+    yhook_pool_push(pool, hook);
+    if (hook->epoch != pool->epoch || hook->slot >= pool->num || pool->hooks[hook->slot] != hook)
+        return;
+    while (hook->slot >= pool->batchmax)
+    {
+        int i = pool->batchmax;
+        batch = yhook_pool_grow(pool->batches, &pool->batchmax, sizeof(struct yhook_batch));
+        if (!batch)
+            return;
+        pool->batches = batch;
+        memset(&batch[i], 0x0, sizeof(struct yhook_batch) * (pool->batchmax - i));
+    }
+    batch = &pool->batches[hook->slot];
+    if (batch->num >= batch->max)
+    {
+        yhook_change *changes = yhook_pool_grow(batch->changes, &batch->max, sizeof(yhook_change));
+        if (!changes)
+            return;
+        batch->changes = changes;
+    }
+    batch->changes[batch->num].op = op;
+    batch->changes[batch->num].cur = cur;
+    batch->changes[batch->num]._new = new;
+    batch->num++;
+}
+
+// free the node after the pending hooks are executed.
+static void yhook_pool_free(yhook_pool *pool, ynode *node)
+{
+    if (pool->num > 0)
+    {
+        if (pool->freenum < pool->freemax)
+        {
+            pool->frees[pool->freenum] = node;
+            pool->freenum++;
+            return;
+        }
+        else
+        {
+            ynode **frees = yhook_pool_grow(pool->frees, &pool->freemax, sizeof(ynode *));
+            if (frees)
+            {
+                pool->frees = frees;
+                pool->frees[pool->freenum] = node;
+                pool->freenum++;
+                return;
+            }
+        }
+    }
+    ynode_free(node);
+}
+
+// execute the batch hook with the changes kept in the bucket of its slot.
+static void yhook_batch_exec(yhook_pool *pool, yhook *hook, int slot)
+{
+    struct yhook_batch *batch;
+    if (slot >= pool->batchmax)
+        return;
+    batch = &pool->batches[slot];
+    ylog_info("write hook (%p) batch %d changes\n", hook->func, batch->num);
+    if (batch->num > 0)
+        hook->batch_func(hook->user_num > 0 ? hook->user[0] : NULL, hook->node, batch->changes, batch->num,
+                         hook->user_num > 1 ? hook->user[1] : NULL);
+    batch->num = 0;
+}
+
+// execute the hook if it is pending in the pool.
+static void yhook_pool_run(yhook_pool *pool, yhook *hook, char op)
+{
+    if (!hook || hook->epoch != pool->epoch)
+        return;
+    if (hook->slot >= pool->num || pool->hooks[hook->slot] != hook)
+        return;
+    pool->hooks[hook->slot] = NULL;
+    hook->epoch = 0;
+    if (IS_SET(hook->flags, YNODE_BATCH_HOOK))
+        yhook_batch_exec(pool, hook, hook->slot);
+    else
+        yhook_func_exec(hook, op, NULL, NULL);
+}
+
+// execute all pending hooks and release the pool.
+static void yhook_pool_flush(yhook_pool *pool, char op)
+{
+    int i;
+    for (i = 0; i < pool->num; i++)
+        yhook_pool_run(pool, pool->hooks[i], op);
+    for (i = 0; i < pool->freenum; i++)
+        ynode_free(pool->frees[i]);
+    if (pool->hooks != pool->hooks_prealloc)
+        free(pool->hooks);
+    for (i = 0; i < pool->batchmax; i++)
+    {
+        if (pool->batches[i].changes)
+            free(pool->batches[i].changes);
+    }
+    if (pool->batches)
+        free(pool->batches);
+    if (pool->frees)
+        free(pool->frees);
+    pool->hooks = pool->hooks_prealloc;
+    pool->batches = NULL;
+    pool->frees = NULL;
+    pool->num = pool->freenum = 0;
+    pool->max = YHOOK_POOL_SIZE;
+    pool->batchmax = pool->freemax = 0;
+}
+
+// run the hook found for the change or make it pending.
+static void yhook_dispatch(yhook_pool *pool, yhook *hook, char op, ynode *cur, ynode *new)
+{
+    if (IS_SET(hook->flags, YNODE_SUPPRESS_HOOK))
+    {
+        yhook_pool_push(pool, hook);
         return;
-    if (!(*hook_pool))
-        *hook_pool = ytree_create(NULL, NULL);
-    if (*hook_pool)
-        ytree_insert(*hook_pool, hook->node, hook);
+    }
+    if ((cur && cur->type == YNODE_TYPE_VAL) ||
+        (new && new->type == YNODE_TYPE_VAL) ||
+        !IS_SET(hook->flags, YNODE_VAL_ONLY))
+    {
+        if (IS_SET(hook->flags, YNODE_BATCH_HOOK))
+            yhook_pool_push_change(pool, hook, op, cur, new);
+        else
+            yhook_func_exec(hook, op, cur, new);
+    }
+}
+
+struct ypattern_match
+{
+    char op;
+    ynode *cur;
+    ynode *new;
+    yhook_pool *pool;
+    ynode **nodes; // the nodes from the node having the pattern hooks to the changed node
+    int num;
+    unsigned long change; // the change counted by the root of the pattern hooks
+};
+
+static void ypattern_match(struct ypattern_match *m, ypattern *p, int i)
+{
+    ypattern *c;
+    if (i >= m->num && p->hook && p->hook->matched != m->change)
+    {
+        p->hook->matched = m->change;
+        yhook_dispatch(m->pool, p->hook, m->op, m->cur, m->new);
+    }
+    for (c = p->child; c; c = c->next)
+    {
+        if (strcmp(c->seg, "**") == 0)
+        {
+            int j;
+            for (j = i; j <= m->num; j++)
+                ypattern_match(m, c, j);
+        }
+        else if (i < m->num)
+        {
+            const char *key = ynode_key(m->nodes[i]);
+            if (strcmp(c->seg, "*") == 0 || (key && strcmp(c->seg, key) == 0))
+                ypattern_match(m, c, i + 1);
+        }
+    }
+}
+
+// run the pattern hooks of the ancestors matched to the changed node.
+static void ypattern_run(char op, ynode *node, ynode *cur, ynode *new, yhook_pool *pool)
+{
+    ynode *nodes[YNODE_LEVEL_MAX];
+    struct ypattern_match m;
+    int n = 0;
+    m.op = op;
+    m.cur = cur;
+    m.new = new;
+    m.pool = pool;
+    for (; node; node = node->parent)
+    {
+        if (node->hook && node->hook->pattern)
+        {
+            m.nodes = &nodes[YNODE_LEVEL_MAX - n];
+            m.num = n;
+            // A pattern hook is matched once for a change even if
+            // it is matched through several "**" segments.
+            m.change = ++node->hook->pattern->change;
+            ypattern_match(&m, node->hook->pattern, 0);
+        }
+        if (n >= YNODE_LEVEL_MAX)
+            break;
+        n++;
+        nodes[YNODE_LEVEL_MAX - n] = node;
+    }
 }
 
-static int yhook_pre_run_for_delete(ynode *cur, ytree **hook_pool);
+static int yhook_pre_run_for_delete(ynode *cur, yhook_pool *pool);
 static int yhook_pre_run_for_delete_dict(void *key, void *data, void *addition)
 {
     ynode *cur = data;
-    ytree **hook_pool = addition;
+    yhook_pool *pool = addition;
     key = (void *)key;
-    return yhook_pre_run_for_delete(cur, hook_pool);
+    return yhook_pre_run_for_delete(cur, pool);
 }
 
 static int yhook_pre_run_for_delete_list(void *data, void *addition)
 {
     ynode *cur = data;
-    ytree **hook_pool = addition;
-    return yhook_pre_run_for_delete(cur, hook_pool);
+    yhook_pool *pool = addition;
+    return yhook_pre_run_for_delete(cur, pool);
 }
 
 // call the pre / post hook for deleting cur ynode.
-static int yhook_pre_run_for_delete(ynode *cur, ytree **hook_pool)
+static int yhook_pre_run_for_delete(ynode *cur, yhook_pool *pool)
 {
     ydb_res res = YDB_OK;
     ynode *node;
@@ -513,13 +1270,13 @@ static int yhook_pre_run_for_delete(ynode *cur, ytree **hook_pool)
     case YNODE_TYPE_MAP:
     case YNODE_TYPE_SET:
     case YNODE_TYPE_IMAP:
-        res = ytree_traverse(cur->map, yhook_pre_run_for_delete_dict, hook_pool);
+        res = ytree_traverse(cur->map, yhook_pre_run_for_delete_dict, pool);
         break;
     case YNODE_TYPE_OMAP:
-        res = ymap_traverse_order(cur->omap, yhook_pre_run_for_delete_dict, hook_pool);
+        res = ymap_traverse_order(cur->omap, yhook_pre_run_for_delete_dict, pool);
         break;
     case YNODE_TYPE_LIST:
-        res = ylist_traverse(cur->list, yhook_pre_run_for_delete_list, hook_pool);
+        res = ylist_traverse(cur->list, yhook_pre_run_for_delete_list, pool);
         break;
     case YNODE_TYPE_VAL:
         res = YDB_OK;
@@ -531,64 +1288,44 @@ static int yhook_pre_run_for_delete(ynode *cur, ytree **hook_pool)
     while (node)
     {
         yhook *hook = node->hook;
-        if (hook)
+        if (hook && hook->func)
         {
-            if (IS_SET(hook->flags, YNODE_SUPPRESS_HOOK))
-            {
-                yhook_push_for_pending(hook, hook_pool);
-                break;
-            }
-            if (cur->type == YNODE_TYPE_VAL || !IS_SET(hook->flags, YNODE_VAL_ONLY))
-                yhook_func_exec(hook, YHOOK_OP_DELETE, cur, NULL);
+            yhook_dispatch(pool, hook, YHOOK_OP_DELETE, cur, NULL);
             break;
         }
         node = node->parent;
     }
+    ypattern_run(YHOOK_OP_DELETE, cur, cur, NULL, pool);
 
     return res;
 }
 
-static yhook *yhook_pre_run(char op, ynode *parent, ynode *cur, ynode *new)
+static void yhook_pre_run(char op, ynode *parent, ynode *cur, ynode *new, yhook_pool *pool)
 {
     yhook *hook;
     if (op != YHOOK_OP_CREATE && op != YHOOK_OP_REPLACE)
-        return NULL;
-    if (new)
+        return;
+    ypattern_run(op, new, cur, new, pool);
+    if (new && new->hook && new->hook->func)
     {
-        hook = new->hook;
-        if (hook)
-        {
-            if (IS_SET(hook->flags, YNODE_SUPPRESS_HOOK))
-                return hook;
-            if ((cur && cur->type == YNODE_TYPE_VAL) ||
-                (new && new->type == YNODE_TYPE_VAL) ||
-                !IS_SET(hook->flags, YNODE_VAL_ONLY))
-                yhook_func_exec(hook, op, cur, new);
-            return NULL;
-        }
+        yhook_dispatch(pool, new->hook, op, cur, new);
+        return;
     }
     while (parent)
     {
         hook = parent->hook;
-        if (hook)
+        if (hook && hook->func)
         {
-            if (IS_SET(hook->flags, YNODE_SUPPRESS_HOOK))
-                return hook;
-            if ((cur && cur->type == YNODE_TYPE_VAL) ||
-                (new && new->type == YNODE_TYPE_VAL) ||
-                !IS_SET(hook->flags, YNODE_VAL_ONLY))
-                yhook_func_exec(hook, op, cur, new);
+            yhook_dispatch(pool, hook, op, cur, new);
             break;
         }
         parent = parent->parent;
     }
-    return NULL;
 }
 
-static void yhook_post_run(char op, ynode *cur, bool end_of_run, ytree **hook_pool)
+static void yhook_post_run(char op, ynode *cur, bool end_of_run, yhook_pool *pool)
 {
-    yhook *hook;
-    if (!hook_pool || !(*hook_pool))
+    if (pool->num <= 0)
         return;
     if (op != YHOOK_OP_DELETE)
     {
@@ -596,40 +1333,22 @@ static void yhook_post_run(char op, ynode *cur, bool end_of_run, ytree **hook_po
         {
             while (cur)
             {
-                hook = ytree_delete(*hook_pool, (void *)cur);
-                if (hook)
-                    yhook_func_exec(hook, op, NULL, NULL);
+                yhook_pool_run(pool, cur->hook, op);
                 cur = cur->parent;
             }
         }
         else
-        {
-            hook = ytree_delete(*hook_pool, (void *)cur);
-            if (hook)
-                yhook_func_exec(hook, op, NULL, NULL);
-        }
+            yhook_pool_run(pool, cur->hook, op);
     }
-
     if (end_of_run)
-    {
-        ytree_iter *iter = ytree_top(*hook_pool);
-        while (iter)
-        {
-            hook = ytree_data(iter);
-            if (hook)
-                yhook_func_exec(hook, op, NULL, NULL);
-            ytree_remove(*hook_pool, iter, NULL);
-            iter = ytree_top(*hook_pool);
-        }
-        ytree_destroy(*hook_pool);
-        *hook_pool = NULL;
-    }
+        yhook_pool_flush(pool, op);
 }
 
 static void yhook_delete(ynode *cur)
 {
     if (!cur || !cur->hook)
         return;
+    ypattern_free(cur->hook->pattern);
     free(cur->hook);
     cur->hook = NULL;
 }
@@ -648,6 +1367,10 @@ static void yhook_copy(ynode *dest, ynode *src)
     memcpy(hook, src->hook, sizeof(yhook) + sizeof(void *) * src->hook->user_num);
     dest->hook = hook;
     hook->node = dest;
+    hook->epoch = 0;
+    // the pattern hooks are moved to the new node.
+    src->hook->pattern = NULL;
+    ypattern_rebase(hook->pattern, dest);
 }
 
 struct _ynode_record
@@ -790,7 +1513,7 @@ static int _ynode_record_debug_ynode(struct _ynode_record *record, ynode *node)
     case YNODE_TYPE_VAL:
     {
         int is_new;
-        char *value = to_yaml(node->value, -1, &is_new, 0);
+        char *value = ynode_value_to_yaml(node, -1, &is_new);
         res = _ynode_record_print(record, " value: %s,", value);
         if (is_new)
             free(value);
@@ -870,7 +1593,7 @@ static int _ynode_record_print_ynode(struct _ynode_record *record, ynode *node)
     if (node->type == YNODE_TYPE_VAL)
     {
         int is_new;
-        char *value = to_yaml(node->value, indent, &is_new, 0);
+        char *value = ynode_value_to_yaml(node, indent, &is_new);
         res = _ynode_record_print(record, "%s%s%s%s\n",
                                   only_val ? "" : " ",
                                   node->tag ? node->tag : "",
@@ -889,22 +1612,6 @@ static int _ynode_record_print_ynode(struct _ynode_record *record, ynode *node)
     return res;
 }
 
-static int _ynode_record_dump_childen(struct _ynode_record *record, ynode *node);
-static int _ynode_record_traverse_dict(void *key, void *data, void *addition)
-{
-    struct _ynode_record *record = addition;
-    ynode *node = data;
-    key = (void *)key;
-    return _ynode_record_dump_childen(record, node);
-}
-
-static int _ynode_record_traverse_list(void *data, void *addition)
-{
-    struct _ynode_record *record = addition;
-    ynode *node = data;
-    return _ynode_record_dump_childen(record, node);
-}
-
 static int _ynode_record_dump_parent(struct _ynode_record *record, ynode *node)
 {
     ydb_res res = YDB_OK;
@@ -935,49 +1642,37 @@ static int _ynode_record_dump_parent(struct _ynode_record *record, ynode *node)
     record->start_level = (record->start_level < 0) ? 0 : record->start_level;
     ylist_destroy(parents);
     return res;
-}
-
-static int _ynode_record_dump_childen(struct _ynode_record *record, ynode *node)
-{
-    ydb_res res = YDB_OK;
-    if (record->end_level < 0)
-        return res;
-    record->end_level--;
-    // printf("record->start_level %d, record->level %d\n", record->start_level, record->level);
-    if (record->start_level <= record->level)
-    {
-        if (IS_SET(record->flags, DUMP_FLAG_DEBUG))
-            res = _ynode_record_debug_ynode(record, node);
-        else
-            res = _ynode_record_print_ynode(record, node);
-        if (res)
-            return res;
-        record->indent++;
-    }
-
-    record->level++;
-    switch (node->type)
-    {
-    case YNODE_TYPE_MAP:
-    case YNODE_TYPE_SET:
-    case YNODE_TYPE_IMAP:
-        res = ytree_traverse(node->map, _ynode_record_traverse_dict, record);
-        break;
-    case YNODE_TYPE_OMAP:
-        res = ymap_traverse_order(node->omap, _ynode_record_traverse_dict, record);
-        break;
-    case YNODE_TYPE_LIST:
-        res = ylist_traverse(node->list, _ynode_record_traverse_list, record);
-        break;
-    case YNODE_TYPE_VAL:
-        break;
-    default:
-        assert(!YDB_E_TYPE_ERR);
+}
+
+static int _ynode_record_dump_childen(struct _ynode_record *record, ynode *node)
+{
+    ydb_res res = YDB_OK;
+    ynode_iter iter;
+    ynode *cur;
+    int indent = record->indent;
+    int level = record->level;
+    // the level from which the nodes are printed and indented.
+    int print_level = (record->start_level > level) ? record->start_level : level;
+    if (record->end_level < 0)
+        return res;
+    for (cur = ynode_iter_begin(&iter, node, YNODE_NO_FLAG); cur; cur = ynode_iter_next(&iter))
+    {
+        // the descendants under the end_level are not printed.
+        if (iter.level >= record->end_level)
+            ynode_iter_skip(&iter);
+        record->level = level + iter.level;
+        if (record->start_level > record->level)
+            continue;
+        record->indent = indent + record->level - print_level;
+        if (IS_SET(record->flags, DUMP_FLAG_DEBUG))
+            res = _ynode_record_debug_ynode(record, cur);
+        else
+            res = _ynode_record_print_ynode(record, cur);
+        if (res)
+            break;
     }
-    record->level--;
-    if (record->start_level <= record->level)
-        record->indent--;
-    record->end_level++;
+    record->level = level;
+    record->indent = indent;
     return res;
 }
 
@@ -1264,7 +1959,7 @@ node_print:
         if (n->type == YNODE_TYPE_VAL)
         {
             int is_new;
-            char *value = to_yaml(n->value, indent, &is_new, 0);
+            char *value = ynode_value_to_yaml(n, indent, &is_new);
             fprintf(log->fp, "%s%s%s%s\n",
                     only_val ? "" : " ",
                     n->tag ? n->tag : "",
@@ -2108,8 +2803,14 @@ ynode *ynode_find_child(ynode *node, const char *key)
     {
     case YNODE_TYPE_MAP:
     case YNODE_TYPE_SET:
-    case YNODE_TYPE_IMAP:
         return ytree_search(node->map, (char *)key);
+    case YNODE_TYPE_IMAP:
+    {
+        imap_key ikey;
+        if (!key)
+            return NULL;
+        return ytree_search(node->map, imap_key_set(&ikey, key));
+    }
     case YNODE_TYPE_OMAP:
         return ymap_search(node->omap, (char *)key);
     case YNODE_TYPE_LIST:
@@ -2151,8 +2852,16 @@ ynode *ynode_find_nearby(ynode *node, const char *key, int lower)
     case YNODE_TYPE_SET:
     case YNODE_TYPE_IMAP:
     {
+        imap_key ikey;
         ytree_iter *nearby;
-        nearby = ytree_find_nearby(node->map, (char *)key, lower);
+        void *search_key = (char *)key;
+        if (node->type == YNODE_TYPE_IMAP)
+        {
+            if (!key)
+                return NULL;
+            search_key = imap_key_set(&ikey, key);
+        }
+        nearby = ytree_find_nearby(node->map, search_key, lower);
         if (nearby != NULL) {
             return ytree_data(nearby);
         }
@@ -2445,13 +3154,75 @@ int ynode_size(ynode *node)
 }
 
 // return ynodes' value if that is a leaf.
+// return the base64 string of the binary leaf.
+// The string is encoded once until the next change of the tree
+// and published under the lock so that the concurrent readers don't race on it.
+static const char *yblob_base64(ynode *node)
+{
+    yblob *blob = node->blob;
+    char *b64 = __atomic_load_n(&blob->base64, __ATOMIC_ACQUIRE);
+    if (b64)
+        return b64;
+    b64 = (char *)base64_encode(blob->data, blob->len, NULL);
+    if (!b64)
+        return NULL;
+    pthread_mutex_lock(&yblob_cache_lock);
+    if (blob->base64)
+    {
+        free(b64);
+        b64 = blob->base64;
+    }
+    else
+    {
+        if (!yblob_cached)
+            yblob_cached = ylist_create();
+        if (yblob_cached)
+            blob->cached = ylist_push_back(yblob_cached, blob);
+        if (blob->cached)
+            __atomic_add_fetch(&yblob_cached_num, 1, __ATOMIC_RELEASE);
+        blob->top = ynode_top(node);
+        __atomic_store_n(&blob->base64, b64, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&yblob_cache_lock);
+    return b64;
+}
+
 const char *ynode_value(ynode *node)
 {
     if (node && node->type == YNODE_TYPE_VAL)
+    {
+        if (IS_SET(node->flags, YNODE_FLAG_BLOB))
+            return yblob_base64(node);
+        if (IS_SET(node->flags, YNODE_FLAG_NUM))
+            return node->num->str;
         return node->value;
+    }
+    return NULL;
+}
+
+// return ynodes' binary data and the length if that is a binary leaf.
+const void *ynode_blob(ynode *node, size_t *len)
+{
+    if (node && IS_SET(node->flags, YNODE_FLAG_BLOB))
+    {
+        if (len)
+            *len = node->blob->len;
+        return node->blob->data;
+    }
     return NULL;
 }
 
+// print ynodes' value. The binary data is printed as !!binary.
+int ynode_fprintf_value(FILE *fp, ynode *node)
+{
+    if (!fp || !node || node->type != YNODE_TYPE_VAL)
+        return 0;
+    if (IS_SET(node->flags, YNODE_FLAG_BLOB))
+        return fprintf(fp, YNODE_BINARY_TAG " ") +
+               (int)base64_encode_fp(fp, node->blob->data, node->blob->len, 0);
+    return fprintf(fp, "%s", ynode_value(node));
+}
+
 // return ynodes' key if that has a hash key.
 const char *ynode_key(ynode *node)
 {
@@ -2462,9 +3233,11 @@ const char *ynode_key(ynode *node)
     switch (type)
     {
     case YNODE_FLAG_HASH:
+        if (node->parent && node->parent->type == YNODE_TYPE_IMAP)
+            return ((imap_key *)ytree_key(node->itree))->str;
         return ytree_key(node->itree);
     case (YNODE_FLAG_HASH | YNODE_FLAG_LIST):
-        return ymap_key(node->imap);
+        return node->okey;
     case YNODE_FLAG_LIST:
     default:
         return NULL;
@@ -2554,7 +3327,7 @@ ynode *ynode_prev(ynode *node)
     case YNODE_TYPE_IMAP:
         return ytree_data(ytree_prev(node->parent->map, node->itree));
     case YNODE_TYPE_OMAP:
-        return ymap_data(ymap_prev(node->parent->omap, node->imap));
+        return ymap_data(ymap_prev(node->parent->omap, ymap_find(node->parent->omap, (void *)node->okey)));
     case YNODE_TYPE_LIST:
         return ylist_data(ylist_prev(node->parent->list, node->ilist));
     case YNODE_TYPE_VAL:
@@ -2576,7 +3349,7 @@ ynode *ynode_next(ynode *node)
     case YNODE_TYPE_IMAP:
         return ytree_data(ytree_next(node->parent->map, node->itree));
     case YNODE_TYPE_OMAP:
-        return ymap_data(ymap_next(node->parent->omap, node->imap));
+        return ymap_data(ymap_next(node->parent->omap, ymap_find(node->parent->omap, (void *)node->okey)));
     case YNODE_TYPE_LIST:
         return ylist_data(ylist_next(node->parent->list, node->ilist));
     case YNODE_TYPE_VAL:
@@ -2749,8 +3522,13 @@ char *ynode_path_and_val(ynode *node, int level, int *pathlen)
         return NULL;
     fp = open_memstream(&buf, &buflen);
     ynode_path_fprintf(fp, node, level);
-    if (node->type == YNODE_TYPE_VAL)
-        fprintf(fp, "=%s", node->value);
+    if (IS_SET(node->flags, YNODE_FLAG_BLOB))
+    {
+        fputc('=', fp);
+        base64_encode_fp(fp, node->blob->data, node->blob->len, 0);
+    }
+    else if (node->type == YNODE_TYPE_VAL)
+        fprintf(fp, "=%s", ynode_value(node));
     if (fp)
         fclose(fp);
     if (buf && buflen > 0)
@@ -2781,6 +3559,20 @@ static char ynode_op_get(ynode *cur, ynode *new)
         {
             if (cur->type == YNODE_TYPE_VAL)
             {
+                if (IS_SET(cur->flags, YNODE_FLAG_BLOB) || IS_SET(new->flags, YNODE_FLAG_BLOB))
+                {
+                    if (IS_SET(cur->flags, YNODE_FLAG_BLOB) && IS_SET(new->flags, YNODE_FLAG_BLOB) &&
+                        cur->blob->len == new->blob->len &&
+                        memcmp(cur->blob->data, new->blob->data, cur->blob->len) == 0)
+                        return YHOOK_OP_NONE;
+                    return YHOOK_OP_REPLACE;
+                }
+                if (IS_SET(cur->flags, YNODE_FLAG_NUM) || IS_SET(new->flags, YNODE_FLAG_NUM))
+                {
+                    if (strcmp(ynode_value(cur), ynode_value(new)) == 0)
+                        return YHOOK_OP_NONE;
+                    return YHOOK_OP_REPLACE;
+                }
                 if (strcmp(cur->value, new->value) == 0)
                     return YHOOK_OP_NONE;
                 return YHOOK_OP_REPLACE;
@@ -2814,10 +3606,9 @@ char *yhook_op_str(char op)
     }
 }
 
-static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *key, ytree **hook_pool, ynode_log *log)
+static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *key, yhook_pool *hook_pool, ynode_log *log)
 {
-    yhook *hook;
-    ytree *hpool = NULL;
+    yhook_pool hpool;
     ynode *new = NULL;
     bool start_point = false;
     char op;
@@ -2832,10 +3623,13 @@ static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *k
             break;
         case YNODE_TYPE_MAP:
         case YNODE_TYPE_SET:
-        case YNODE_TYPE_IMAP:
             if (!cur && key)
                 cur = ytree_search(parent->map, (void *)key);
             break;
+        case YNODE_TYPE_IMAP:
+            if (!cur && key)
+                cur = ynode_find_child(parent, key);
+            break;
         case YNODE_TYPE_OMAP:
             if (!cur && key)
                 cur = ymap_search(parent->omap, (void *)key);
@@ -2851,7 +3645,7 @@ static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *k
 
     if (op == YHOOK_OP_CREATE || op == YHOOK_OP_REPLACE)
     {
-        new = ynode_new(src->type, src->tag, src->value, src->origin);
+        new = ynode_new_from(src);
         if (!new)
             return NULL;
         yhook_copy(new, cur);
@@ -2893,25 +3687,28 @@ static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *k
     {
         hook_pool = &hpool;
         start_point = true;
+        // The generation of the change is used as the epoch of the hook pool.
+        yhook_pool_init(hook_pool, ynode_gen_next(parent ? parent : cur));
+        // The base64 strings read from the tree are released by the change.
+        yblob_cache_release(ynode_top(parent ? parent : cur));
     }
 
     switch (op)
     {
     case YHOOK_OP_CREATE:
         ynode_attach(new, parent, key);
-        hook = yhook_pre_run(op, parent, cur, new);
-        if (hook)
-            yhook_push_for_pending(hook, hook_pool);
+        ynode_gen_stamp(new, hook_pool->epoch);
+        yhook_pre_run(op, parent, cur, new, hook_pool);
         ynode_log_print(log, false, cur, new);
         break;
     case YHOOK_OP_REPLACE:
         ynode_attach(new, parent, key);
-        hook = yhook_pre_run(op, parent, cur, new);
-        if (hook)
-            yhook_push_for_pending(hook, hook_pool);
+        ynode_gen_stamp(new, hook_pool->epoch);
+        yhook_pre_run(op, parent, cur, new, hook_pool);
         ynode_log_print(log, false, cur, new);
         break;
     case YHOOK_OP_DELETE:
+        ynode_gen_stamp(cur->parent, hook_pool->epoch);
         yhook_pre_run_for_delete(cur, hook_pool);
         ynode_log_print(log, true, cur, new);
         break;
@@ -2974,12 +3771,12 @@ static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *k
         break;
     case YHOOK_OP_REPLACE:
         yhook_post_run(YHOOK_OP_MERGE, new, start_point, hook_pool);
-        ynode_free(cur);
+        yhook_pool_free(hook_pool, cur);
         break;
     case YHOOK_OP_DELETE:
         yhook_post_run(YHOOK_OP_DELETE, cur, start_point, hook_pool);
         ynode_detach(cur);
-        ynode_free(cur);
+        yhook_pool_free(hook_pool, cur);
         break;
     case YHOOK_OP_NONE:
         yhook_post_run(YHOOK_OP_MERGE, cur, start_point, hook_pool);
@@ -2995,57 +3792,20 @@ static ynode *ynode_control(ynode *cur, ynode *src, ynode *parent, const char *k
 int ynode_get_with_origin(ynode *src, int origin, ynode_log *log)
 {
     int n = 0;
+    ynode *node;
+    ynode_iter iter;
     if (!src)
         return 0;
-    if (src->type == YNODE_TYPE_VAL)
-    {
-        // doesn't print the value according to origin.
-        if (src->origin != origin && origin >= 0)
-            return 0;
-        n += 1;
-    }
-
-    ynode_log_print(log, false, src, NULL);
-    switch (src->type)
-    {
-    case YNODE_TYPE_MAP:
-    case YNODE_TYPE_SET:
-    case YNODE_TYPE_IMAP:
-    {
-        ytree_iter *iter = ytree_first(src->map);
-        for (; iter != NULL; iter = ytree_next(src->map, iter))
-        {
-            ynode *src_child = ytree_data(iter);
-            n += ynode_get_with_origin(src_child, origin, log);
-        }
-        break;
-    }
-    case YNODE_TYPE_OMAP:
-    {
-        ymap_iter *iter = ymap_first(src->omap);
-        for (; iter != NULL; iter = ymap_next(src->omap, iter))
-        {
-            ynode *src_child = ymap_data(iter);
-            n += ynode_get_with_origin(src_child, origin, log);
-        }
-        break;
-    }
-    case YNODE_TYPE_LIST:
+    for (node = ynode_iter_begin(&iter, src, YNODE_NO_FLAG); node; node = ynode_iter_next(&iter))
     {
-        ylist_iter *iter;
-        for (iter = ylist_first(src->list);
-             !ylist_done(src->list, iter);
-             iter = ylist_next(src->list, iter))
+        if (node->type == YNODE_TYPE_VAL)
         {
-            ynode *src_child = ylist_data(iter);
-            n += ynode_get_with_origin(src_child, origin, log);
+            // doesn't print the value according to origin.
+            if (node->origin != origin && origin >= 0)
+                continue;
+            n += 1;
         }
-        break;
-    }
-    case YNODE_TYPE_VAL:
-        break;
-    default:
-        assert(!YDB_E_TYPE_ERR);
+        ynode_log_print(log, false, node, NULL);
     }
     return n;
 }
@@ -3162,13 +3922,90 @@ failed:
     return NULL;
 }
 
+// create new ynodes using path and replace the last with the leaf.
+// return the leaf or NULL with the leaf freed.
+static ynode *ynode_create_path_leaf(char *path, ynode *leaf)
+{
+    ynode *last, *parent;
+    const char *key;
+    if (!leaf)
+        return NULL;
+    last = ynode_create_path(path, NULL, NULL);
+    if (!last)
+        goto failed;
+    parent = last->parent;
+    if (!parent)
+    {
+        ynode_free(last);
+        goto failed;
+    }
+    key = ystrdup((char *)ynode_key(last));
+    ynode_free(ynode_attach(leaf, parent, key));
+    yfree(key);
+    return leaf;
+failed:
+    ynode_free(leaf);
+    return NULL;
+}
+
+// create new ynodes using path and attach the binary leaf to the last.
+// return the binary leaf created.
+ynode *ynode_create_blob(char *path, const void *data, size_t len)
+{
+    return ynode_create_path_leaf(path, ynode_new_blob(data, len, 0));
+}
+
+// create new ynodes using path and attach the integer leaf to the last.
+// return the integer leaf created.
+ynode *ynode_create_int(char *path, long long value)
+{
+    ynum num;
+    num.i = value;
+    ynum_format(&num, false);
+    return ynode_create_path_leaf(path, ynode_new_num(&num, false, YNODE_INT_TAG, 0));
+}
+
+// add delta to the number of the leaf in place.
+// A string leaf having an integer is converted to the integer leaf.
+// The change is not logged until ynode_counter_flush().
+ydb_res ynode_counter_add(ynode *node, long long delta)
+{
+    if (!node || node->type != YNODE_TYPE_VAL || IS_SET(node->flags, YNODE_FLAG_BLOB))
+        return YDB_E_TYPE_ERR;
+    if (!IS_SET(node->flags, YNODE_FLAG_NUM))
+    {
+        // the string leaf (untagged, !!int or !!float) having the number.
+        ynum *num;
+        bool is_float = (node->tag && strcmp(node->tag, YNODE_FLOAT_TAG) == 0);
+        if (node->tag && !is_float && strcmp(node->tag, YNODE_INT_TAG) != 0)
+            return YDB_E_TYPE_ERR;
+        num = ynum_parse(node->value, is_float);
+        if (!num)
+            return YDB_E_TYPE_ERR;
+        yfree(node->value);
+        node->num = num;
+        if (!node->tag)
+            node->tag = ystrdup(YNODE_INT_TAG);
+        SET_FLAG(node->flags, is_float ? YNODE_FLAG_FLOAT : YNODE_FLAG_INT);
+    }
+    if (IS_SET(node->flags, YNODE_FLAG_FLOAT))
+        node->num->f += delta;
+    else
+        node->num->i += delta;
+    ynum_format(node->num, IS_SET(node->flags, YNODE_FLAG_FLOAT));
+    SET_FLAG(node->flags, YNODE_FLAG_DIRTY);
+    ynode_gen_stamp(node, ynode_gen_next(node));
+    ynode_digest_invalidate(node);
+    return YDB_OK;
+}
+
 // copy src ynodes (including all sub ynodes)
 ynode *ynode_copy(ynode *src)
 {
     ynode *dest;
     if (!src)
         return NULL;
-    dest = ynode_new(src->type, src->tag, src->value, src->origin);
+    dest = ynode_new_from(src);
     if (!dest)
         return NULL;
 
@@ -3269,11 +4106,11 @@ ynode *ynode_merge_new(ynode *dest, ynode *src)
     if (fp)
     {
         if (dest->type == YNODE_TYPE_VAL)
-            fprintf(fp, "%s", dest->value);
+            ynode_fprintf_value(fp, dest);
         else
             ynode_printf_to_fp(fp, dest, 0, YNODE_LEVEL_MAX);
         if (src->type == YNODE_TYPE_VAL)
-            fprintf(fp, "%s", src->value);
+            ynode_fprintf_value(fp, src);
         else
             ynode_printf_to_fp(fp, src, 0, YNODE_LEVEL_MAX);
         fclose(fp);
@@ -3291,143 +4128,286 @@ void ynode_delete(ynode *cur, ynode_log *log)
         ynode_control(cur, NULL, cur->parent, ynode_key(cur), NULL, log);
 }
 
-struct ynode_traverse_data
-{
-    ynode_callback cb;
-    void *addition;
-    unsigned int flags;
-};
-
-static ydb_res ynode_traverse_sub(ynode *cur, struct ynode_traverse_data *tdata);
-static int ynode_traverse_map(void *key, void *data, void *addition)
+// ynode_iter_matched --
+// Return true if the node is selected by the traverse flags.
+int ynode_iter_matched(ynode *node, unsigned int flags)
 {
-    ynode *cur = data;
-    struct ynode_traverse_data *tdata = addition;
-    key = (void *)key;
-    return ynode_traverse_sub(cur, tdata);
+    if (IS_SET(flags, YNODE_LEAF_ONLY)) // no child
+    {
+        switch (node->type)
+        {
+        case YNODE_TYPE_MAP:
+        case YNODE_TYPE_SET:
+        case YNODE_TYPE_IMAP:
+            return ytree_size(node->map) <= 0;
+        case YNODE_TYPE_OMAP:
+            return ymap_size(node->omap) <= 0;
+        case YNODE_TYPE_LIST:
+            return ylist_empty(node->list);
+        case YNODE_TYPE_VAL:
+            return true;
+        default:
+            return false;
+        }
+    }
+    else if (node->type == YNODE_TYPE_VAL)
+        return true;
+    return !IS_SET(flags, YNODE_VAL_ONLY);
 }
 
-static int ynode_traverse_list(void *data, void *addition)
+// return the first node to be visited in the leaf-first order.
+static ynode *ynode_iter_first_leaf(ynode_iter *iter, ynode *node, int level)
 {
-    ynode *cur = data;
-    struct ynode_traverse_data *tdata = addition;
-    return ynode_traverse_sub(cur, tdata);
+    ynode *child = ynode_down(node);
+    while (child)
+    {
+        node = child;
+        level++;
+        child = ynode_down(node);
+    }
+    iter->next_level = level;
+    return node;
 }
 
-static ydb_res ynode_traverse_sub(ynode *cur, struct ynode_traverse_data *tdata)
+// ynode_iter_advance --
+// Return the node next to the node in the traverse order.
+// The parent links of the nodes are used as the stack of the traversal.
+// iter->next_level is set to the level of the returned node.
+static ynode *ynode_iter_advance(ynode_iter *iter, ynode *node, int level, int descend)
 {
-    ydb_res res = YDB_OK;
-    if (!IS_SET(tdata->flags, YNODE_LEAF_FIRST))
+    ynode *next;
+    if (IS_SET(iter->flags, YNODE_LEAF_FIRST))
     {
-        if (IS_SET(tdata->flags, YNODE_LEAF_ONLY)) // no child
+        if (node == iter->top)
+            return NULL;
+        next = ynode_next(node);
+        if (next)
+            return ynode_iter_first_leaf(iter, next, level);
+        iter->next_level = level - 1;
+        return node->parent;
+    }
+    if (descend)
+    {
+        next = ynode_down(node);
+        if (next)
         {
-            switch (cur->type)
-            {
-            case YNODE_TYPE_MAP:
-            case YNODE_TYPE_SET:
-            case YNODE_TYPE_IMAP:
-                if (ytree_size(cur->map) <= 0)
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_OMAP:
-                if (ymap_size(cur->omap) <= 0)
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_LIST:
-                if (ylist_empty(cur->list))
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_VAL:
-                res = tdata->cb(cur, tdata->addition);
-                break;
-            default:
-                break;
-            }
+            iter->next_level = level + 1;
+            return next;
+        }
+    }
+    for (; node && node != iter->top; node = node->parent, level--)
+    {
+        next = ynode_next(node);
+        if (next)
+        {
+            iter->next_level = level;
+            return next;
         }
-        else if (cur->type == YNODE_TYPE_VAL)
+    }
+    return NULL;
+}
+
+ynode *ynode_iter_begin(ynode_iter *iter, ynode *top, unsigned int flags)
+{
+    if (!iter)
+        return NULL;
+    iter->top = top;
+    iter->cur = NULL;
+    iter->next = NULL;
+    iter->flags = flags;
+    iter->level = 0;
+    iter->next_level = 0;
+    iter->skip = 0;
+    if (!top)
+        return NULL;
+    if (IS_SET(flags, YNODE_LEAF_FIRST))
+        iter->next = ynode_iter_first_leaf(iter, top, 0);
+    else
+        iter->next = top;
+    return ynode_iter_next(iter);
+}
+
+ynode *ynode_iter_next(ynode_iter *iter)
+{
+    int level;
+    ynode *node;
+    if (!iter)
+        return NULL;
+    if (iter->cur && !IS_SET(iter->flags, YNODE_LEAF_FIRST))
+    {
+        // The children are fetched after the node is handled by the caller.
+        iter->next = ynode_iter_advance(iter, iter->cur, iter->level, !iter->skip);
+    }
+    iter->cur = NULL;
+    iter->skip = 0;
+    while (iter->next)
+    {
+        node = iter->next;
+        level = iter->next_level;
+        if (IS_SET(iter->flags, YNODE_LEAF_FIRST))
         {
-            res = tdata->cb(cur, tdata->addition);
+            // The next node is fetched ahead so that the returned node
+            // can be removed by the caller.
+            iter->next = ynode_iter_advance(iter, node, level, 1);
         }
         else
+            iter->next = NULL;
+        if (ynode_iter_matched(node, iter->flags))
         {
-            if (!IS_SET(tdata->flags, YNODE_VAL_ONLY))
-                res = tdata->cb(cur, tdata->addition);
+            iter->cur = node;
+            iter->level = level;
+            return node;
         }
+        if (!IS_SET(iter->flags, YNODE_LEAF_FIRST))
+            iter->next = ynode_iter_advance(iter, node, level, 1);
     }
-    if (res)
-        return res;
+    return NULL;
+}
 
-    switch (cur->type)
+void ynode_iter_skip(ynode_iter *iter)
+{
+    if (iter && iter->cur && !IS_SET(iter->flags, YNODE_LEAF_FIRST))
+        iter->skip = 1;
+}
+
+unsigned long ynode_generation(ynode *node)
+{
+    if (!node)
+        return 0;
+    return node->gen;
+}
+
+#define YNODE_FNV_OFFSET 0xcbf29ce484222325ULL
+#define YNODE_FNV_PRIME 0x100000001b3ULL
+
+static uint64_t ynode_fnv(uint64_t h, const void *data, size_t len)
+{
+    size_t i;
+    const unsigned char *p = data;
+    for (i = 0; i < len; i++)
     {
-    case YNODE_TYPE_MAP:
-    case YNODE_TYPE_SET:
-    case YNODE_TYPE_IMAP:
-        res = ytree_traverse(cur->map, ynode_traverse_map, tdata);
-        break;
-    case YNODE_TYPE_OMAP:
-        res = ymap_traverse_order(cur->omap, ynode_traverse_map, tdata);
-        break;
-    case YNODE_TYPE_LIST:
-        res = ylist_traverse(cur->list, ynode_traverse_list, tdata);
-        break;
-    case YNODE_TYPE_VAL:
-        res = YDB_OK;
-        break;
-    default:
-        assert(!YDB_E_TYPE_ERR);
+        h ^= p[i];
+        h *= YNODE_FNV_PRIME;
     }
-    if (res)
-        return res;
+    return h;
+}
 
-    if (IS_SET(tdata->flags, YNODE_LEAF_FIRST))
+unsigned long long ynode_digest(ynode *node)
+{
+    uint64_t h, d;
+    ynode *child;
+    const char *key;
+    if (!node)
+        return 0;
+    if (node->digest)
+        return node->digest;
+    h = ynode_fnv(YNODE_FNV_OFFSET, &node->type, sizeof(node->type));
+    if (IS_SET(node->flags, YNODE_FLAG_BLOB))
     {
-        if (IS_SET(tdata->flags, YNODE_LEAF_ONLY)) // no child
-        {
-            switch (cur->type)
-            {
-            case YNODE_TYPE_MAP:
-            case YNODE_TYPE_SET:
-            case YNODE_TYPE_IMAP:
-                if (ytree_size(cur->map) <= 0)
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_OMAP:
-                if (ymap_size(cur->omap) <= 0)
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_LIST:
-                if (ylist_empty(cur->list))
-                    res = tdata->cb(cur, tdata->addition);
-                break;
-            case YNODE_TYPE_VAL:
-                res = tdata->cb(cur, tdata->addition);
-                break;
-            default:
-                break;
-            }
-        }
-        else if (cur->type == YNODE_TYPE_VAL)
+        h = ynode_fnv(h, &node->blob->len, sizeof(node->blob->len));
+        h = ynode_fnv(h, node->blob->data, node->blob->len);
+    }
+    else if (node->type == YNODE_TYPE_VAL)
+    {
+        // the number is hashed as the string to be the same with the string leaf.
+        const char *value = ynode_value(node);
+        if (value)
+            h = ynode_fnv(h, value, strlen(value) + 1);
+    }
+    else
+    {
+        for (child = ynode_down(node); child; child = ynode_next(child))
         {
-            res = tdata->cb(cur, tdata->addition);
+            key = ynode_key(child);
+            if (key)
+                h = ynode_fnv(h, key, strlen(key) + 1);
+            d = ynode_digest(child);
+            h = ynode_fnv(h, &d, sizeof(d));
         }
-        else
+    }
+    // 0 is reserved for the digest not computed.
+    node->digest = h ? h : 1;
+    return node->digest;
+}
+
+// return the first sibling changed after the generation.
+static ynode *ynode_changed_sibling(ynode *node, unsigned long gen)
+{
+    while (node && node->gen <= gen)
+        node = ynode_next(node);
+    return node;
+}
+
+ydb_res ynode_traverse_changed(ynode *cur, unsigned long gen, ynode_callback cb, void *addition, unsigned int flags)
+{
+    ydb_res res;
+    ynode *node, *next;
+    if (!cur || !cb)
+        return YDB_E_INVALID_ARGS;
+    node = (cur->gen > gen) ? cur : NULL;
+    while (node)
+    {
+        if (ynode_iter_matched(node, flags))
         {
-            if (!IS_SET(tdata->flags, YNODE_VAL_ONLY))
-                res = tdata->cb(cur, tdata->addition);
+            res = cb(node, addition);
+            if (res)
+                return res;
         }
+        // The unchanged subtrees are skipped.
+        next = ynode_changed_sibling(ynode_down(node), gen);
+        for (; !next && node != cur; node = node->parent)
+            next = ynode_changed_sibling(ynode_next(node), gen);
+        node = next;
+    }
+    return YDB_OK;
+}
+
+struct ynode_counter_flush_data
+{
+    ynode_log *log;
+    yhook_pool pool;
+};
+
+static ydb_res ynode_counter_flush_sub(ynode *cur, void *addition)
+{
+    struct ynode_counter_flush_data *data = addition;
+    if (IS_SET(cur->flags, YNODE_FLAG_DIRTY))
+    {
+        UNSET_FLAG(cur->flags, YNODE_FLAG_DIRTY);
+        // the counter is replaced in place (cur and new are the same).
+        yhook_pre_run(YHOOK_OP_REPLACE, cur->parent, cur, cur, &data->pool);
+        ynode_log_print(data->log, false, cur, NULL);
     }
+    return YDB_OK;
+}
+
+// log the counters changed by ynode_counter_add() after the generation
+// and run the write hooks of the counters.
+ydb_res ynode_counter_flush(ynode *top, unsigned long gen, ynode_log *log)
+{
+    ydb_res res;
+    struct ynode_counter_flush_data data;
+    data.log = log;
+    yhook_pool_init(&data.pool, ynode_gen_next(top));
+    res = ynode_traverse_changed(top, gen, ynode_counter_flush_sub, &data, YNODE_VAL_ONLY);
+    yhook_pool_flush(&data.pool, YHOOK_OP_MERGE);
     return res;
 }
 
 ydb_res ynode_traverse(ynode *cur, ynode_callback cb, void *addition, unsigned int flags)
 {
-    struct ynode_traverse_data tdata;
+    ydb_res res;
+    ynode_iter iter;
+    ynode *node;
     if (!cur || !cb)
         return YDB_E_INVALID_ARGS;
-    tdata.cb = cb;
-    tdata.addition = addition;
-    tdata.flags = flags;
-    return ynode_traverse_sub(cur, &tdata);
+    for (node = ynode_iter_begin(&iter, cur, flags); node; node = ynode_iter_next(&iter))
+    {
+        res = cb(node, addition);
+        if (res)
+            return res;
+    }
+    return YDB_OK;
 }
 
 // find the ref ynode in target ynode tree.
@@ -3592,10 +4572,21 @@ ydb_res ynode_traverse_to_read(ynode *cur, void *addition)
             sscanf(ynode_value(n), &(value[4]), p);
 #else
             int len = strlen(value);
-            if (value[len - 1] == 's')
-                strcpy(p, ynode_value(n));
+            const void *blob;
+            size_t bloblen = 0;
+            const char *nval;
+            // the binary leaf is encoded into the buffer without the cache.
+            blob = ynode_blob(n, &bloblen);
+            if (blob && value[len - 1] == 's')
+                base64_encode_to(blob, bloblen, (unsigned char *)p, 0);
             else
-                sscanf(ynode_value(n), &(value[4]), p);
+            {
+                nval = ynode_value(n);
+                if (value[len - 1] == 's')
+                    strcpy(p, nval ? nval : "");
+                else if (nval)
+                    sscanf(nval, &(value[4]), p);
+            }
 #endif
             data->varnum++;
         }
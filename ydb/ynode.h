@@ -43,6 +43,14 @@ ynode *ynode_create_copy(ynode *src, ynode *parent, const char *key, ynode_log *
 // return the last created ynode.
 ynode *ynode_create_path(char *path, ynode *parent, ynode_log *log);
 
+// create new ynodes using path and attach the binary leaf to the last.
+// return the binary leaf created.
+ynode *ynode_create_blob(char *path, const void *data, size_t len);
+
+// create new ynodes using path and attach the integer leaf (!!int) to the last.
+// return the integer leaf created.
+ynode *ynode_create_int(char *path, long long value);
+
 // copy src ynodes (including all sub ynodes).
 ynode *ynode_copy(ynode *src);
 
@@ -114,7 +122,13 @@ int ynode_empty(ynode *node);
 int ynode_size(ynode *node);
 
 // return ynodes' value if that is a leaf.
+// The number leaf (!!int, !!float) is formatted to the string when it is changed.
+// The base64 string of the binary leaf (!!binary) is kept until the next change of the tree.
 const char *ynode_value(ynode *node);
+// return ynodes' binary data and the length if that is a binary leaf (!!binary).
+const void *ynode_blob(ynode *node, size_t *len);
+// print ynodes' value. The binary leaf is printed as !!binary with base64.
+int ynode_fprintf_value(FILE *fp, ynode *node);
 // return ynodes' key if that has a hash key.
 const char *ynode_key(ynode *node);
 // return ynodes' index if the nodes' parent is a list.
@@ -176,6 +190,7 @@ char *yhook_op_str(char op);
 #define YNODE_VAL_ONLY 0x2
 #define YNODE_LEAF_ONLY 0x4
 #define YNODE_SUPPRESS_HOOK 0x8
+#define YNODE_BATCH_HOOK 0x10
 
 typedef void (*yhook_func0)(          char op, ynode *base, ynode *cur, ynode *_new);
 typedef void (*yhook_func1)(void *U0, char op, ynode *base, ynode *cur, ynode *_new);
@@ -192,6 +207,11 @@ typedef void (*yhook_suppressed_func5)(void *U0, char op, ynode *base, void *U1,
 
 typedef yhook_func2 yhook_func;
 
+// The batch hook (YNODE_BATCH_HOOK) receives all changes under the hooked node
+// in a merge at once. The changed nodes are valid only within the hook.
+typedef ydb_write_change yhook_change;
+typedef void (*yhook_batch_func)(void *U0, ynode *base, yhook_change *changes, int num, void *U1);
+
 // register the hook func to the target ynode.
 ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int user_num, void *user[]);
 
@@ -199,9 +219,62 @@ ydb_res yhook_register(ynode *node, unsigned int flags, yhook_func func, int use
 // return user data registered with the hook.
 void yhook_unregister(ynode *node);
 
+// register the hook func to the nodes matched to the pattern under the target ynode.
+// The pattern is the path relative to the target ynode having the wildcards.
+//  - "*": any single path segment
+//  - "**": zero or more path segments
+// e.g. yhook_register_pattern(interfaces, "*/state/oper-status", ...)
+ydb_res yhook_register_pattern(ynode *node, char *pattern, unsigned int flags, yhook_func func, int user_num, void *user[]);
+
+// unregister the hook func of the pattern from the target ynode.
+void yhook_unregister_pattern(ynode *node, char *pattern);
+
 typedef ydb_res (*ynode_callback)(ynode *cur, void *user);
 ydb_res ynode_traverse(ynode *cur, ynode_callback cb, void *user, unsigned int flags);
 
+// ynode iterator for the traversal without the callback.
+// The traversal can be paused and resumed by keeping the iterator.
+// The node returned in YNODE_LEAF_FIRST order can be deleted before ynode_iter_next().
+typedef struct _ynode_iter
+{
+    ynode *top;
+    ynode *cur;
+    ynode *next;
+    unsigned int flags;
+    int level; // the level of the current node from the top (0)
+    int next_level;
+    int skip;
+} ynode_iter;
+
+// return the first ynode to be visited with the traverse flags (YNODE_LEAF_FIRST, YNODE_VAL_ONLY, YNODE_LEAF_ONLY).
+// e.g. for (n = ynode_iter_begin(&iter, top, flags); n; n = ynode_iter_next(&iter))
+ynode *ynode_iter_begin(ynode_iter *iter, ynode *top, unsigned int flags);
+// return the next ynode or NULL at the end of the traversal.
+ynode *ynode_iter_next(ynode_iter *iter);
+// skip the descendants of the current ynode. (not available in YNODE_LEAF_FIRST order)
+void ynode_iter_skip(ynode_iter *iter);
+// return true if the ynode is selected by the traverse flags.
+int ynode_iter_matched(ynode *node, unsigned int flags);
+
+// return the generation of the latest change of the ynode and its descendants.
+// The generation is increased by each change and propagated to the ancestors.
+unsigned long ynode_generation(ynode *node);
+// traverse the ynodes changed after the generation in the parent-first order.
+// The parent of a deleted ynode is traversed as a changed ynode.
+ydb_res ynode_traverse_changed(ynode *cur, unsigned long gen, ynode_callback cb, void *user, unsigned int flags);
+
+// add delta to the number of the leaf (!!int, !!float) in place.
+// A string leaf having an integer is converted to the integer leaf.
+// The change is not logged until ynode_counter_flush().
+ydb_res ynode_counter_add(ynode *node, long long delta);
+// log the counters changed by ynode_counter_add() after the generation
+// and run the write hooks of the counters.
+ydb_res ynode_counter_flush(ynode *top, unsigned long gen, ynode_log *log);
+
+// return the digest of the ynode and its descendants (the types, keys and values).
+// The digest is computed on demand and invalidated up to the top by any change.
+unsigned long long ynode_digest(ynode *node);
+
 #ifdef __cplusplus
 } // closing brace for extern "C"
 #endif
@@ -65,7 +65,8 @@ const char *ystrndup(char *src, int srclen)
     pthread_mutex_lock(&lock);
     if (!ystr_pool)
     {
-        ystr_pool = ytrie_create();
+        // the ystr data is used as the key of the trie.
+        ystr_pool = ytrie_create_opt(YTRIE_POOL | YTRIE_KEY_REF);
         assert(ystr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("ystr_pool created\n");
@@ -74,7 +75,7 @@ const char *ystrndup(char *src, int srclen)
 
     if (!yptr_pool)
     {
-        yptr_pool = ytree_create(NULL, NULL);
+        yptr_pool = ytree_create_opt(NULL, NULL, YTREE_BTREE);
         assert(yptr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("yptr_pool created\n");
@@ -134,7 +135,7 @@ const char *ystrnew(const char *format, ...)
     pthread_mutex_lock(&lock);
     if (!ystr_pool)
     {
-        ystr_pool = ytrie_create();
+        ystr_pool = ytrie_create_opt(YTRIE_POOL | YTRIE_KEY_REF);
         assert(ystr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("ystr_pool created\n");
@@ -143,7 +144,7 @@ const char *ystrnew(const char *format, ...)
 
     if (!yptr_pool)
     {
-        yptr_pool = ytree_create(NULL, NULL);
+        yptr_pool = ytree_create_opt(NULL, NULL, YTREE_BTREE);
         assert(yptr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("yptr_pool created\n");
@@ -199,7 +200,7 @@ const void *ydatadup(void *src, int srclen)
     pthread_mutex_lock(&lock);
     if (!ystr_pool)
     {
-        ystr_pool = ytrie_create();
+        ystr_pool = ytrie_create_opt(YTRIE_POOL | YTRIE_KEY_REF);
         assert(ystr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("ystr_pool created\n");
@@ -208,7 +209,7 @@ const void *ydatadup(void *src, int srclen)
 
     if (!yptr_pool)
     {
-        yptr_pool = ytree_create(NULL, NULL);
+        yptr_pool = ytree_create_opt(NULL, NULL, YTREE_BTREE);
         assert(yptr_pool);
 #ifdef YALLOC_DEBUG
         ylog_debug("yptr_pool created\n");
@@ -205,7 +205,7 @@ ytimer *ytimer_create(void)
     timer->timers = ytree_create((ytree_cmp)timer_cb_cmp, NULL);
     timer->timer_ids = ytree_create((ytree_cmp)timer_id_cmp, NULL);
     timer->dtimers = ylist_create();
-    timer->timerfd = timerfd_create(CLOCK_MONOTONIC, 0x0);
+    timer->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
     if (timer->timers == NULL || timer->timer_ids == NULL ||
         timer->dtimers == NULL || timer->timerfd < 0)
     {
@@ -399,10 +399,9 @@ int ytimer_serve(ytimer *timer)
     if (ytree_size(timer->timers) <= 0)
         return 0;
     
-    ssize_t len = recv(timer->timerfd, &num_of_expires, sizeof(uint64_t), MSG_DONTWAIT);
-    // Changed read() to recv() to avoid blocking on read().
-    // ssize_t len = read(timer->timerfd, &num_of_expires, sizeof(uint64_t));
-    if (len < 0)
+    // The timerfd is non-blocking. (recv() is not available for the timerfd.)
+    ssize_t len = read(timer->timerfd, &num_of_expires, sizeof(uint64_t));
+    if (len < 0 && errno != EAGAIN)
     {
         ylog_error("ytimer[fd=%d]: read blocking avoided...\n", timer->timerfd);
     }
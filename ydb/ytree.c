@@ -15,9 +15,13 @@
 
 typedef struct _ytree *Tree;
 typedef struct _ytree_node *Node;
+typedef struct _ybtree_node *BNode;
+typedef struct _ybtree_entry *BEntry;
 struct _ytree
 {
     Node root;
+    BNode broot; // the root of the B+tree (YTREE_BTREE)
+    int btree;
     ytree_cmp comp;
     user_free key_free;
     user_free data_free;
@@ -25,14 +29,41 @@ struct _ytree
     size_t size;
 };
 
+// The key and data must be the first members of both the AVL node
+// and the B+tree entry for ytree_key() and ytree_data().
 struct _ytree_node
 {
+    void *key;
+    void *data;
     Node parent;
     Node left;
     Node right;
+    int balance;
+};
+
+#define BTREE_ORDER 16
+#define BTREE_MIN (BTREE_ORDER / 2)
+#define BTREE_DEPTH 32
+
+struct _ybtree_entry
+{
     void *key;
     void *data;
-    int balance;
+    BNode leaf;
+};
+
+// The keys and entries (or children) have a spare slot for the split.
+struct _ybtree_node
+{
+    int leaf;
+    int num; // the number of keys
+    BNode prev; // the linked leaves
+    BNode next;
+    void *keys[BTREE_ORDER + 1];
+    union {
+        BNode child[BTREE_ORDER + 2];
+        BEntry entry[BTREE_ORDER + 1];
+    } u;
 };
 
 struct trunk
@@ -56,6 +87,550 @@ Node Node_New(void *key, void *data, Node parent);
 
 void print_tree(Tree t, Node n, struct trunk *prev, int is_left);
 
+//----------------------------------------------------------------------------
+//
+// B+tree (YTREE_BTREE)
+//
+// The keys are kept in the arrays of the nodes to reduce the cache misses
+// of the search and the leaves are linked for the in-order iteration.
+// Each entry (BEntry) is allocated per key and referred by a leaf so that
+// the ytree_iter is kept during insertion and deletion like the AVL node.
+// The separator keys of the internal nodes are the pointers of the smallest
+// keys of their right subtrees.
+//
+
+// B+tree path from the root to a leaf.
+struct btree_path
+{
+    BNode node[BTREE_DEPTH];
+    int index[BTREE_DEPTH];
+    int depth;
+};
+
+static BNode BNode_New(int leaf)
+{
+    BNode n = malloc(sizeof(struct _ybtree_node));
+    if (n)
+    {
+        n->leaf = leaf;
+        n->num = 0;
+        n->prev = NULL;
+        n->next = NULL;
+    }
+    return n;
+}
+
+// BNode_Child --
+//
+//     Returns the index of the child including the key.
+//
+static int BNode_Child(Tree t, BNode n, void *key)
+{
+    int lo = 0, hi = n->num;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if ((t->comp)(key, n->keys[mid]) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+// BNode_Lower --
+//
+//     Returns the index of the first key not less than the key in the leaf.
+//
+static int BNode_Lower(Tree t, BNode n, void *key, int *found)
+{
+    int lo = 0, hi = n->num;
+    *found = 0;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        int res = (t->comp)(key, n->keys[mid]);
+        if (res < 0)
+            hi = mid;
+        else if (res > 0)
+            lo = mid + 1;
+        else
+        {
+            *found = 1;
+            return mid;
+        }
+    }
+    return lo;
+}
+
+static int BNode_Index(BNode leaf, BEntry e)
+{
+    int i;
+    for (i = 0; i < leaf->num; i++)
+    {
+        if (leaf->u.entry[i] == e)
+            return i;
+    }
+    assert(0);
+    return -1;
+}
+
+// BTree_Leaf --
+//
+//     Returns the leaf including the key and records the path to the leaf.
+//
+static BNode BTree_Leaf(Tree t, void *key, struct btree_path *path)
+{
+    BNode n = t->broot;
+    if (path)
+        path->depth = 0;
+    while (n && !n->leaf)
+    {
+        int i = BNode_Child(t, n, key);
+        if (path)
+        {
+            assert(path->depth < BTREE_DEPTH);
+            path->node[path->depth] = n;
+            path->index[path->depth] = i;
+            path->depth++;
+        }
+        n = n->u.child[i];
+    }
+    return n;
+}
+
+// BTree_ReplaceSeparator --
+//
+//     Replaces the separator of the smallest key of the leaf at the end of the path.
+//     The separator is placed in the deepest node having the leaf in the non-first child.
+//
+static void BTree_ReplaceSeparator(struct btree_path *path, void *old, void *key)
+{
+    int d;
+    for (d = path->depth - 1; d >= 0; d--)
+    {
+        int i = path->index[d];
+        if (i > 0)
+        {
+            if (path->node[d]->keys[i - 1] == old)
+                path->node[d]->keys[i - 1] = key;
+            return;
+        }
+    }
+}
+
+static void BTree_Split(Tree t, BNode n, struct btree_path *path)
+{
+    while (n->num > BTREE_ORDER)
+    {
+        BNode parent;
+        BNode right = BNode_New(n->leaf);
+        int mid = n->num / 2, i;
+        void *sep;
+        if (n->leaf)
+        {
+            right->num = n->num - mid;
+            memcpy(right->keys, &n->keys[mid], right->num * sizeof(void *));
+            memcpy(right->u.entry, &n->u.entry[mid], right->num * sizeof(BEntry));
+            for (i = 0; i < right->num; i++)
+                right->u.entry[i]->leaf = right;
+            n->num = mid;
+            right->next = n->next;
+            if (right->next)
+                right->next->prev = right;
+            right->prev = n;
+            n->next = right;
+            sep = right->keys[0];
+        }
+        else
+        {
+            sep = n->keys[mid];
+            right->num = n->num - mid - 1;
+            memcpy(right->keys, &n->keys[mid + 1], right->num * sizeof(void *));
+            memcpy(right->u.child, &n->u.child[mid + 1], (right->num + 1) * sizeof(BNode));
+            n->num = mid;
+        }
+        if (path->depth == 0)
+        {
+            BNode root = BNode_New(0);
+            root->num = 1;
+            root->keys[0] = sep;
+            root->u.child[0] = n;
+            root->u.child[1] = right;
+            t->broot = root;
+            return;
+        }
+        path->depth--;
+        parent = path->node[path->depth];
+        i = path->index[path->depth];
+        memmove(&parent->keys[i + 1], &parent->keys[i], (parent->num - i) * sizeof(void *));
+        memmove(&parent->u.child[i + 2], &parent->u.child[i + 1], (parent->num - i) * sizeof(BNode));
+        parent->keys[i] = sep;
+        parent->u.child[i + 1] = right;
+        parent->num++;
+        n = parent;
+    }
+}
+
+// BNode_Merge --
+//
+//     Merges the k+1th child into the kth child of the node.
+//
+static void BNode_Merge(BNode p, int k)
+{
+    BNode l = p->u.child[k];
+    BNode r = p->u.child[k + 1];
+    int i;
+    if (l->leaf)
+    {
+        memcpy(&l->keys[l->num], r->keys, r->num * sizeof(void *));
+        memcpy(&l->u.entry[l->num], r->u.entry, r->num * sizeof(BEntry));
+        for (i = 0; i < r->num; i++)
+            r->u.entry[i]->leaf = l;
+        l->num += r->num;
+        l->next = r->next;
+        if (l->next)
+            l->next->prev = l;
+    }
+    else
+    {
+        l->keys[l->num] = p->keys[k];
+        memcpy(&l->keys[l->num + 1], r->keys, r->num * sizeof(void *));
+        memcpy(&l->u.child[l->num + 1], r->u.child, (r->num + 1) * sizeof(BNode));
+        l->num += r->num + 1;
+    }
+    free(r);
+    memmove(&p->keys[k], &p->keys[k + 1], (p->num - k - 1) * sizeof(void *));
+    memmove(&p->u.child[k + 1], &p->u.child[k + 2], (p->num - k - 1) * sizeof(BNode));
+    p->num--;
+}
+
+// BNode_BorrowLeft --
+//
+//     Moves the last entry (or child) of the left sibling to the ci-th child.
+//
+static void BNode_BorrowLeft(BNode p, int ci)
+{
+    BNode n = p->u.child[ci];
+    BNode sib = p->u.child[ci - 1];
+    memmove(&n->keys[1], &n->keys[0], n->num * sizeof(void *));
+    if (n->leaf)
+    {
+        memmove(&n->u.entry[1], &n->u.entry[0], n->num * sizeof(BEntry));
+        n->keys[0] = sib->keys[sib->num - 1];
+        n->u.entry[0] = sib->u.entry[sib->num - 1];
+        n->u.entry[0]->leaf = n;
+        p->keys[ci - 1] = n->keys[0];
+    }
+    else
+    {
+        memmove(&n->u.child[1], &n->u.child[0], (n->num + 1) * sizeof(BNode));
+        n->keys[0] = p->keys[ci - 1];
+        n->u.child[0] = sib->u.child[sib->num];
+        p->keys[ci - 1] = sib->keys[sib->num - 1];
+    }
+    sib->num--;
+    n->num++;
+}
+
+// BNode_BorrowRight --
+//
+//     Moves the first entry (or child) of the right sibling to the ci-th child.
+//
+static void BNode_BorrowRight(BNode p, int ci)
+{
+    BNode n = p->u.child[ci];
+    BNode sib = p->u.child[ci + 1];
+    if (n->leaf)
+    {
+        n->keys[n->num] = sib->keys[0];
+        n->u.entry[n->num] = sib->u.entry[0];
+        n->u.entry[n->num]->leaf = n;
+        memmove(&sib->keys[0], &sib->keys[1], (sib->num - 1) * sizeof(void *));
+        memmove(&sib->u.entry[0], &sib->u.entry[1], (sib->num - 1) * sizeof(BEntry));
+        p->keys[ci] = sib->keys[0];
+    }
+    else
+    {
+        n->keys[n->num] = p->keys[ci];
+        n->u.child[n->num + 1] = sib->u.child[0];
+        p->keys[ci] = sib->keys[0];
+        memmove(&sib->keys[0], &sib->keys[1], (sib->num - 1) * sizeof(void *));
+        memmove(&sib->u.child[0], &sib->u.child[1], sib->num * sizeof(BNode));
+    }
+    sib->num--;
+    n->num++;
+}
+
+static void BTree_Rebalance(Tree t, BNode n, struct btree_path *path)
+{
+    while (path->depth > 0)
+    {
+        BNode p;
+        int ci;
+        if (n->num >= BTREE_MIN)
+            return;
+        path->depth--;
+        p = path->node[path->depth];
+        ci = path->index[path->depth];
+        if (ci > 0 && p->u.child[ci - 1]->num > BTREE_MIN)
+        {
+            BNode_BorrowLeft(p, ci);
+            return;
+        }
+        if (ci < p->num && p->u.child[ci + 1]->num > BTREE_MIN)
+        {
+            BNode_BorrowRight(p, ci);
+            return;
+        }
+        BNode_Merge(p, (ci > 0) ? ci - 1 : ci);
+        n = p;
+    }
+    // root
+    if (n->num == 0)
+    {
+        t->broot = n->leaf ? NULL : n->u.child[0];
+        free(n);
+    }
+}
+
+static Node BTree_Insert(Tree t, void *key, void *data, int del, Node *_new)
+{
+    struct btree_path path;
+    BNode leaf;
+    BEntry e;
+    int idx, found;
+    if (!t->broot)
+    {
+        t->broot = BNode_New(1);
+        if (!t->broot)
+            return NULL;
+    }
+    leaf = BTree_Leaf(t, key, &path);
+    idx = BNode_Lower(t, leaf, key, &found);
+    if (found)
+    {
+        e = leaf->u.entry[idx];
+        if (del)
+        {
+            void *okey = e->key;
+            void *odata = e->data;
+            leaf->keys[idx] = key;
+            if (idx == 0)
+                BTree_ReplaceSeparator(&path, okey, key);
+            e->key = key;
+            e->data = data;
+            if (t->key_free && okey)
+                t->key_free(okey);
+            if (t->data_free && odata)
+                t->data_free(odata);
+            return NULL;
+        }
+        return (Node)e;
+    }
+    e = malloc(sizeof(struct _ybtree_entry));
+    if (!e)
+        return NULL;
+    e->key = key;
+    e->data = data;
+    e->leaf = leaf;
+    memmove(&leaf->keys[idx + 1], &leaf->keys[idx], (leaf->num - idx) * sizeof(void *));
+    memmove(&leaf->u.entry[idx + 1], &leaf->u.entry[idx], (leaf->num - idx) * sizeof(BEntry));
+    leaf->keys[idx] = key;
+    leaf->u.entry[idx] = e;
+    leaf->num++;
+    t->size++;
+    if (_new)
+        *_new = (Node)e;
+    if (leaf->num > BTREE_ORDER)
+        BTree_Split(t, leaf, &path);
+    return NULL;
+}
+
+static void BTree_DeleteAt(Tree t, BNode leaf, int idx, struct btree_path *path)
+{
+    BEntry e = leaf->u.entry[idx];
+    memmove(&leaf->keys[idx], &leaf->keys[idx + 1], (leaf->num - idx - 1) * sizeof(void *));
+    memmove(&leaf->u.entry[idx], &leaf->u.entry[idx + 1], (leaf->num - idx - 1) * sizeof(BEntry));
+    leaf->num--;
+    if (idx == 0 && leaf->num > 0)
+        BTree_ReplaceSeparator(path, e->key, leaf->keys[0]);
+    free(e);
+    t->size--;
+    BTree_Rebalance(t, leaf, path);
+}
+
+static void BTree_Delete(Tree t, BEntry e)
+{
+    struct btree_path path;
+    BNode leaf = BTree_Leaf(t, e->key, &path);
+    assert(leaf == e->leaf);
+    BTree_DeleteAt(t, leaf, BNode_Index(leaf, e), &path);
+}
+
+// BTree_DeleteKey --
+//
+//     Deletes the entry of the key in a single descent.
+//     Returns 1 with the key and data of the deleted entry if found.
+//
+static int BTree_DeleteKey(Tree t, void *key, void **rkey, void **rdata)
+{
+    struct btree_path path;
+    int idx, found;
+    BNode leaf = BTree_Leaf(t, key, &path);
+    if (!leaf)
+        return 0;
+    idx = BNode_Lower(t, leaf, key, &found);
+    if (!found)
+        return 0;
+    *rkey = leaf->u.entry[idx]->key;
+    *rdata = leaf->u.entry[idx]->data;
+    BTree_DeleteAt(t, leaf, idx, &path);
+    return 1;
+}
+
+// BTree_Traverse --
+//
+//     Iterates the entries along the linked leaves.
+//
+static int BTree_Traverse(Tree t, ytree_callback cb, void *user_data, int reverse)
+{
+    BNode leaf = t->broot;
+    int i, res;
+    while (leaf && !leaf->leaf)
+        leaf = leaf->u.child[reverse ? leaf->num : 0];
+    for (; leaf; leaf = reverse ? leaf->prev : leaf->next)
+    {
+        for (i = 0; i < leaf->num; i++)
+        {
+            BEntry e = leaf->u.entry[reverse ? leaf->num - 1 - i : i];
+            res = cb(e->key, e->data, user_data);
+            if (res != 0)
+                return res;
+        }
+    }
+    return 0;
+}
+
+// BTree_SetKey --
+//
+//     Replaces the key of the entry with the same (equal) key.
+//
+static void BTree_SetKey(Tree t, BEntry e, void *key)
+{
+    struct btree_path path;
+    BNode leaf = BTree_Leaf(t, e->key, &path);
+    int idx = BNode_Index(leaf, e);
+    leaf->keys[idx] = key;
+    if (idx == 0)
+        BTree_ReplaceSeparator(&path, e->key, key);
+    e->key = key;
+}
+
+static Node BTree_Search(Tree t, void *key)
+{
+    int idx, found;
+    BNode leaf = BTree_Leaf(t, key, NULL);
+    if (!leaf)
+        return NULL;
+    idx = BNode_Lower(t, leaf, key, &found);
+    if (found)
+        return (Node)leaf->u.entry[idx];
+    return NULL;
+}
+
+// BTree_LowerBound --
+//
+//     Returns the first entry not less than the key.
+//
+static Node BTree_LowerBound(Tree t, void *key)
+{
+    int idx, found;
+    BNode leaf = BTree_Leaf(t, key, NULL);
+    if (!leaf)
+        return NULL;
+    idx = BNode_Lower(t, leaf, key, &found);
+    if (idx < leaf->num)
+        return (Node)leaf->u.entry[idx];
+    leaf = leaf->next;
+    return leaf ? (Node)leaf->u.entry[0] : NULL;
+}
+
+static Node BTree_First(Tree t)
+{
+    BNode n = t->broot;
+    while (n && !n->leaf)
+        n = n->u.child[0];
+    return n ? (Node)n->u.entry[0] : NULL;
+}
+
+static Node BTree_Last(Tree t)
+{
+    BNode n = t->broot;
+    while (n && !n->leaf)
+        n = n->u.child[n->num];
+    return n ? (Node)n->u.entry[n->num - 1] : NULL;
+}
+
+static Node BTree_Next(BEntry e)
+{
+    BNode leaf = e->leaf;
+    int idx = BNode_Index(leaf, e);
+    if (idx + 1 < leaf->num)
+        return (Node)leaf->u.entry[idx + 1];
+    leaf = leaf->next;
+    return leaf ? (Node)leaf->u.entry[0] : NULL;
+}
+
+static Node BTree_Prev(BEntry e)
+{
+    BNode leaf = e->leaf;
+    int idx = BNode_Index(leaf, e);
+    if (idx > 0)
+        return (Node)leaf->u.entry[idx - 1];
+    leaf = leaf->prev;
+    return leaf ? (Node)leaf->u.entry[leaf->num - 1] : NULL;
+}
+
+static void BTree_Destroy(Tree t, BNode n, user_free data_free)
+{
+    int i;
+    if (!n)
+        return;
+    if (n->leaf)
+    {
+        for (i = 0; i < n->num; i++)
+        {
+            BEntry e = n->u.entry[i];
+            if (t->key_free && e->key)
+                t->key_free(e->key);
+            if (data_free && e->data)
+                data_free(e->data);
+            else if (t->data_free && e->data)
+                t->data_free(e->data);
+            free(e);
+        }
+    }
+    else
+    {
+        for (i = 0; i <= n->num; i++)
+            BTree_Destroy(t, n->u.child[i], data_free);
+    }
+    free(n);
+}
+
+// Tree_SetKey --
+//
+//     Replaces the key of the node with the same (equal) key.
+//
+static void Tree_SetKey(Tree t, Node node, void *key)
+{
+    if (t->btree)
+        BTree_SetKey(t, (BEntry)node, key);
+    else
+        node->key = key;
+}
+
 //----------------------------------------------------------------------------
 
 // Tree_Insert --
@@ -67,6 +642,8 @@ Node Tree_Insert(Tree t, void *key, void *data, int del, Node *_new)
 {
     if (t == NULL)
         return NULL;
+    if (t->btree)
+        return BTree_Insert(t, key, data, del, _new);
     if (t->root == NULL)
     {
         t->root = Node_New(key, data, NULL);
@@ -144,6 +721,11 @@ void Tree_DeleteNode(Tree t, Node node)
 {
     if (t == NULL)
         return;
+    if (t->btree)
+    {
+        BTree_Delete(t, (BEntry)node);
+        return;
+    }
     Node left = node->left;
     Node right = node->right;
     Node toDelete = node;
@@ -280,6 +862,8 @@ Node Tree_SearchNode(Tree t, void *key)
     Node node;
     if (t == NULL)
         return NULL;
+    if (t->btree)
+        return BTree_Search(t, key);
     node = t->root;
     while (node != NULL)
     {
@@ -306,6 +890,17 @@ Node Tree_SearchNode(Tree t, void *key)
 //
 void Tree_Print(Tree t)
 {
+    if (t->btree)
+    {
+        Node node;
+        for (node = BTree_First(t); node; node = BTree_Next((BEntry)node))
+        {
+            (t->print)(node->key);
+            printf("\n");
+        }
+        fflush(stdout);
+        return;
+    }
     print_tree(t, t->root, 0, 0);
     fflush(stdout);
 }
@@ -317,6 +912,8 @@ void Tree_Print(Tree t)
 Node Tree_TopNode(Tree t)
 {
     Node node = t ? t->root : NULL;
+    if (t && t->btree)
+        return BTree_First(t);
     return node;
 }
 
@@ -327,6 +924,8 @@ Node Tree_TopNode(Tree t)
 Node Tree_FirstNode(Tree t)
 {
     Node node = t ? t->root : NULL;
+    if (t && t->btree)
+        return BTree_First(t);
 
     while ((node != NULL) && (node->left != NULL))
     {
@@ -343,6 +942,8 @@ Node Tree_FirstNode(Tree t)
 Node Tree_LastNode(Tree t)
 {
     Node node = t ? t->root : NULL;
+    if (t && t->btree)
+        return BTree_Last(t);
 
     while ((node != NULL) && (node->right != NULL))
     {
@@ -361,6 +962,8 @@ Node Tree_PrevNode(Tree t, Node n)
     Node nTemp;
     if (t == NULL)
         return NULL;
+    if (t->btree)
+        return BTree_Prev((BEntry)n);
 
     if (n->left != NULL)
     {
@@ -392,6 +995,8 @@ Node Tree_NextNode(Tree t, Node n)
     Node nTemp;
     if (t == NULL)
         return NULL;
+    if (t->btree)
+        return BTree_Next((BEntry)n);
 
     if (n->right != NULL)
     {
@@ -810,6 +1415,12 @@ int default_cmp(void *a1, void *a2)
 
 // create ytree with compare, key and data free functions.
 ytree *ytree_create(ytree_cmp comp, user_free key_free)
+{
+    return ytree_create_opt(comp, key_free, 0);
+}
+
+// create ytree with the options (YTREE_BTREE).
+ytree *ytree_create_opt(ytree_cmp comp, user_free key_free, unsigned int opt)
 {
     struct _ytree *tree = NULL;
     if (!comp)
@@ -823,6 +1434,7 @@ ytree *ytree_create(ytree_cmp comp, user_free key_free)
         tree->key_free = key_free;
         tree->data_free = NULL;
         tree->print = default_print;
+        tree->btree = (opt & YTREE_BTREE) ? 1 : 0;
     }
     return tree;
 }
@@ -832,6 +1444,12 @@ void ytree_destroy_custom(ytree *tree, user_free data_free)
 {
     if (!tree)
         return;
+    if (tree->btree)
+    {
+        BTree_Destroy(tree, tree->broot, data_free);
+        free(tree);
+        return;
+    }
     Node node = Tree_TopNode(tree);
     while (node != NULL)
     {
@@ -867,11 +1485,11 @@ void *ytree_insert(ytree *tree, void *key, void *data)
     Node node = Tree_Insert(tree, key, data, 0, NULL);
     if (node)
     {
+        void *rkey = node->key;
         void *rdata = node->data;
-        if (tree->key_free && node->key)
-            tree->key_free(node->key);
-        rdata = node->data;
-        node->key = key;
+        Tree_SetKey(tree, node, key);
+        if (tree->key_free && rkey)
+            tree->key_free(rkey);
         node->data = data;
         return rdata;
     }
@@ -894,6 +1512,15 @@ void ytree_insert_custom(ytree *tree, void *key, void *data, user_free data_free
 // delete the key and then return the found data, otherwise return NULL
 void *ytree_delete(ytree *tree, void *key)
 {
+    if (tree && tree->btree)
+    {
+        void *rkey, *rdata;
+        if (!BTree_DeleteKey(tree, key, &rkey, &rdata))
+            return NULL;
+        if (tree->key_free && rkey)
+            tree->key_free(rkey);
+        return rdata;
+    }
     Node node = Tree_SearchNode(tree, key);
     if (node)
     {
@@ -910,6 +1537,17 @@ void *ytree_delete(ytree *tree, void *key)
 // delete data using user_free
 void ytree_delete_custom(ytree *tree, void *key, user_free data_free)
 {
+    if (tree && tree->btree)
+    {
+        void *rkey, *rdata;
+        if (!BTree_DeleteKey(tree, key, &rkey, &rdata))
+            return;
+        if (tree->key_free && rkey)
+            tree->key_free(rkey);
+        if (data_free && rdata)
+            data_free(rdata);
+        return;
+    }
     Node node = Tree_SearchNode(tree, key);
     if (node)
     {
@@ -945,6 +1583,8 @@ int ytree_exist(ytree *tree, void *key)
 // Iterates through entries in the tree
 int ytree_traverse(ytree *tree, ytree_callback cb, void *user_data)
 {
+    if (tree && tree->btree)
+        return BTree_Traverse(tree, cb, user_data, 0);
     Node node = Tree_FirstNode(tree);
     while (node != NULL)
     {
@@ -961,6 +1601,8 @@ int ytree_traverse(ytree *tree, ytree_callback cb, void *user_data)
 // Iterates through entries in the tree in reverse direction
 int ytree_traverse_reverse(ytree *tree, ytree_callback cb, void *user_data)
 {
+    if (tree && tree->btree)
+        return BTree_Traverse(tree, cb, user_data, 1);
     Node node = Tree_LastNode(tree);
     while (node != NULL)
     {
@@ -1010,6 +1652,22 @@ int ytree_traverse_in_range(ytree *tree, void *lower_boundary, void *higher_boun
     if (!tree)
         return -1;
     cmp = tree->comp;
+    if (tree->btree)
+    {
+        // the entries are iterated from the lower boundary in order.
+        if (!tree->broot)
+            return -1;
+        node = BTree_LowerBound(tree, lower_boundary);
+        for (; node != NULL; node = BTree_Next((BEntry)node))
+        {
+            if (cmp(node->key, higher_boundary) > 0)
+                break;
+            res = cb(node->key, node->data, user_data);
+            if (res != 0)
+                return res;
+        }
+        return 0;
+    }
     base = ytree_find_nearest(tree, lower_boundary);
     if (!base)
         return -1;
@@ -1050,6 +1708,18 @@ ytree_iter *ytree_find_nearby(ytree *tree, void *key, int lower)
     ytree_iter *nearest;
     if (!tree)
         return NULL;
+    if (tree->btree)
+    {
+        node = BTree_LowerBound(tree, key);
+        if (node && (tree->comp)(key, node->key) == 0)
+            return node;
+        if (lower)
+        {
+            nearest = node ? BTree_Prev((BEntry)node) : BTree_Last(tree);
+            return nearest ? nearest : node;
+        }
+        return node ? node : BTree_Last(tree);
+    }
     node = tree->root;
     nearest = node;
     while (node != NULL)
@@ -1088,7 +1758,7 @@ ytree_iter *ytree_find_nearby(ytree *tree, void *key, int lower)
             int res = (tree->comp)(node->key, key);
             if (res > 0)
                 return node;
-            node = Tree_PrevNode(tree, node);
+            node = Tree_NextNode(tree, node);
         }
     }
     return nearest;
@@ -1140,11 +1810,11 @@ ytree_iter *ytree_push(ytree *tree, void *key, void *data, void **old_data)
     Node node = Tree_Insert(tree, key, data, 0, &_new);
     if (node)
     {
+        void *rkey = node->key;
         void *rdata = node->data;
-        if (tree->key_free && node->key)
-            tree->key_free(node->key);
-        rdata = node->data;
-        node->key = key;
+        Tree_SetKey(tree, node, key);
+        if (tree->key_free && rkey)
+            tree->key_free(rkey);
         node->data = data;
         if (old_data)
             *old_data = rdata;
@@ -1161,14 +1831,16 @@ ytree_iter *ytree_push(ytree *tree, void *key, void *data, void **old_data)
 ytree_iter *ytree_remove(ytree *tree, ytree_iter *n, void **data)
 {
     void *udata;
+    void *ukey;
     ytree_iter *i;
     if (!tree || !n)
         return NULL;
     udata = n->data;
+    ukey = n->key;
     i = Tree_PrevNode(tree, n);
-    if (tree->key_free && n->key)
-        tree->key_free(n->key);
     Tree_DeleteNode(tree, n);
+    if (tree->key_free && ukey)
+        tree->key_free(ukey);
     if (data)
         *data = udata;
     return i;
@@ -1182,14 +1854,16 @@ ytree_iter *ytree_remove(ytree *tree, ytree_iter *n, void **data)
 ytree_iter *ytree_remove_reverse(ytree *tree, ytree_iter *n, void **data)
 {
     void *udata;
+    void *ukey;
     ytree_iter *i;
     if (!tree || !n)
         return NULL;
     i = Tree_NextNode(tree, n);
     udata = n->data;
-    if (tree->key_free && n->key)
-        tree->key_free(n->key);
+    ukey = n->key;
     Tree_DeleteNode(tree, n);
+    if (tree->key_free && ukey)
+        tree->key_free(ukey);
     if (data)
         *data = udata;
     return i;
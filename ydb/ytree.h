@@ -4,6 +4,8 @@
 // YTREE is a AVL tree that supports O(logn) search, insertion and deletion time.
 // YTREE originated from the AVL tree implementation in https://rosettacode.org/wiki/AVL_tree/C.
 // And tree node iteration and range search functions are added to the YTREE for convenient use.
+// YTREE can be created as a B+tree (YTREE_BTREE) having 16 keys per node and
+// linked leaves for the cache-friendly search and iteration of large trees.
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,6 +31,11 @@ typedef struct _ytree_node ytree_iter;
 // create ytree with compare, key and data free functions.
 ytree *ytree_create(ytree_cmp comp, user_free key_free);
 
+// ytree options
+//  - YTREE_BTREE: use the B+tree instead of the AVL tree.
+#define YTREE_BTREE 0x1
+ytree *ytree_create_opt(ytree_cmp comp, user_free key_free, unsigned int opt);
+
 // destroy the tree with deleting all entries.
 void ytree_destroy(ytree *tree);
 void ytree_destroy_custom(ytree *tree, user_free data_free);
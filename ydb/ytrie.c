@@ -6,12 +6,26 @@
 #include "ylist.h"
 
 ytrie *ytrie_create(void)
+{
+    return ytrie_create_opt(0);
+}
+
+ytrie *ytrie_create_opt(unsigned int opt)
 {
     art_tree *art;
+    int options = 0;
     art = malloc(sizeof(art_tree));
     if(art)
     {
-        art_tree_init(art);
+        if (opt & YTRIE_POOL)
+            options |= ART_POOL;
+        if (opt & YTRIE_KEY_REF)
+            options |= ART_KEY_REF;
+        if (art_tree_init_opt(art, options))
+        {
+            free(art);
+            return NULL;
+        }
     }
     return (ytrie *) art;
 }
@@ -96,3 +110,32 @@ ylist* ytrie_search_range(ytrie *trie, const void *key, int key_len)
     return list;
 }
 
+// return the value of the first key matching the prefix, otherwise return NULL
+void *ytrie_iter_prefix_begin(ytrie *trie, ytrie_iter *iter, const void *prefix, int prefix_len)
+{
+    art_leaf *leaf;
+    art_iterator *it = (art_iterator *) iter;
+    leaf = art_iter_prefix_begin((art_tree *) trie, it, (const unsigned char *)prefix, prefix_len);
+    return leaf ? leaf->value : NULL;
+}
+
+// return the value of the next key matching the prefix, otherwise return NULL
+void *ytrie_iter_prefix_next(ytrie *trie, ytrie_iter *iter)
+{
+    art_leaf *leaf;
+    art_iterator *it = (art_iterator *) iter;
+    leaf = art_iter_prefix_next((art_tree *) trie, it);
+    return leaf ? leaf->value : NULL;
+}
+
+// return the key of the current entry of the iterator
+const void *ytrie_iter_key(ytrie_iter *iter, int *key_len)
+{
+    art_leaf *leaf = iter->leaf;
+    if (!leaf)
+        return NULL;
+    if (key_len)
+        *key_len = leaf->key_len;
+    return leaf->key;
+}
+
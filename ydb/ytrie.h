@@ -22,6 +22,14 @@ typedef struct _ytree ytrie;
 
 ytrie *ytrie_create(void);
 
+// ytrie options
+//  - YTRIE_POOL: allocate the trie nodes and leaves from the pool of the trie.
+//  - YTRIE_KEY_REF: refer to the inserted key instead of copying it.
+//    The key must be kept with a trailing zero byte until it is deleted.
+#define YTRIE_POOL    0x1
+#define YTRIE_KEY_REF 0x2
+ytrie *ytrie_create_opt(unsigned int opt);
+
 void ytrie_destroy(ytrie *trie);
 
 void ytrie_destroy_custom(ytrie *trie, user_free);
@@ -52,6 +60,33 @@ int ytrie_traverse_prefix_match(ytrie *trie, const void *key, int key_len, ytrie
 #include "ylist.h"
 ylist* ytrie_search_range(ytrie *trie, const void *key, int key_len);
 
+#define YTRIE_ITER_DEPTH_MAX 64
+
+// The cursor of the prefix iteration without allocation.
+// It keeps the path to the current entry (the same layout as art_iterator).
+// The trie must not be changed during the iteration.
+typedef struct _ytrie_iter
+{
+    const void *prefix;
+    int prefix_len;
+    void *leaf;
+    int depth;
+    struct
+    {
+        void *node;
+        unsigned char key;
+    } stack[YTRIE_ITER_DEPTH_MAX];
+} ytrie_iter;
+
+// return the value of the first key matching the prefix, otherwise return NULL
+void *ytrie_iter_prefix_begin(ytrie *trie, ytrie_iter *iter, const void *prefix, int prefix_len);
+
+// return the value of the next key matching the prefix, otherwise return NULL
+void *ytrie_iter_prefix_next(ytrie *trie, ytrie_iter *iter);
+
+// return the key of the current entry of the iterator
+const void *ytrie_iter_key(ytrie_iter *iter, int *key_len);
+
 #ifdef __cplusplus
 } // closing brace for extern "C"
 #endif